@@ -0,0 +1,381 @@
+/*
+ * bench.c - Microbenchmarks for vector.h
+ * Copyright (C) 2025 Stefan Froberg <stefan.froberg@protonmail.com>
+ *
+ * Overview:
+ * Measures every public vector operation at several element sizes and lengths
+ * and compares each one against an unlocked baseline (the *_internal functions
+ * without vector_rdlock/vector_wrlock) and a plain C array doing the same work.
+ * A second group measures shared-vector throughput as the thread count grows.
+ *
+ * With --perf, each single-threaded record also carries hardware counters
+ * (cycles, instructions, L1D/LLC/dTLB read misses, branch misses) read with
+ * perf_event_open and normalized per operation, which for the bulk benchmarks
+ * is per element processed.
+ *
+ * Output:
+ *   One JSON document on stdout (or --out FILE) with one record per
+ *   (benchmark, variant, element size, length, threads) combination. Timings
+ *   are reported as the minimum and median nanoseconds per operation over
+ *   --reps repetitions.
+ *
+ * Usage:
+ *   ./bench [--quick] [--reps N] [--threads N] [--filter NAME] [--perf]
+ *           [--out FILE]
+ */
+#include "vector.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include "perf_counters.h"
+
+/* Element types of 4, 16 and 64 bytes */
+typedef struct { uint32_t v[1]; } elem4;
+typedef struct { uint32_t v[4]; } elem16;
+typedef struct { uint32_t v[16]; } elem64;
+
+/* Benchmark configuration */
+typedef struct {
+    size_t lengths[4];   /* Vector lengths to measure */
+    size_t num_lengths;  /* Number of entries in lengths */
+    size_t reps;         /* Repetitions per measurement */
+    size_t max_threads;  /* Upper bound for thread scaling */
+    const char* filter;  /* Only run benchmarks whose name contains this */
+    int perf;            /* Hardware counters opened (--perf) */
+    FILE* out;           /* JSON destination */
+} bench_config;
+
+static bench_config cfg;
+static size_t result_count;
+static volatile uint64_t bench_sink; /* Defeats dead-code elimination */
+
+/* Returns monotonic time in nanoseconds */
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* Starts a timed region; returns its start time */
+static uint64_t bench_start(void)
+{
+    if (cfg.perf)
+        perf_counters_start();
+    return now_ns();
+}
+
+/* Ends a timed region started at t0, adding hardware counters to pc */
+/* Returns: elapsed nanoseconds */
+static uint64_t bench_stop(uint64_t t0, perf_counts* pc)
+{
+    uint64_t elapsed = now_ns() - t0;
+    if (cfg.perf)
+        perf_counters_stop(pc);
+    return elapsed;
+}
+
+/* Small deterministic PRNG (xorshift64) */
+static uint64_t rng_next(uint64_t* state)
+{
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+/* Sorts timing samples for median selection */
+static int compare_u64(const void* a, const void* b)
+{
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+/* Checks whether a benchmark passes the --filter option */
+static int bench_enabled(const char* name)
+{
+    return !cfg.filter || strstr(name, cfg.filter) != NULL;
+}
+
+/* Emits one JSON result record */
+/* Args: name - benchmark, variant - vector/unlocked/raw, elem_size, length, */
+/*       threads, ops - operations per sample, samples - per-rep nanoseconds, */
+/*       pc - accumulated hardware counters or NULL */
+static void report(const char* name, const char* variant, size_t elem_size,
+                   size_t length, size_t threads, size_t ops,
+                   uint64_t* samples, size_t count, const perf_counts* pc)
+{
+    qsort(samples, count, sizeof(uint64_t), compare_u64);
+    double min = (double)samples[0] / (double)(ops ? ops : 1);
+    double median = (double)samples[count / 2] / (double)(ops ? ops : 1);
+    fprintf(cfg.out,
+            "%s    {\"name\": \"%s\", \"variant\": \"%s\", \"elem_size\": %zu, "
+            "\"length\": %zu, \"threads\": %zu, \"ops\": %zu, "
+            "\"ns_per_op_min\": %.3f, \"ns_per_op_median\": %.3f",
+            result_count ? ",\n" : "", name, variant, elem_size, length,
+            threads, ops, min, median);
+    if (cfg.perf && pc && pc->samples)
+    {
+        /* Counts are summed over all reps; normalize per operation */
+        double per = (double)pc->samples * (double)(ops ? ops : 1);
+        fprintf(cfg.out, ", \"perf\": {");
+        for (int i = 0; i < PERF_NUM_COUNTERS; ++i)
+        {
+            fprintf(cfg.out, "%s\"%s_per_op\": ", i ? ", " : "",
+                    perf_counter_names[i]);
+            if (perf_counter_available(i))
+                fprintf(cfg.out, "%.4f", (double)pc->value[i] / per);
+            else
+                fprintf(cfg.out, "null");
+        }
+        if (perf_counter_available(PERF_CYCLES) &&
+            perf_counter_available(PERF_INSTRUCTIONS) && pc->value[PERF_CYCLES])
+            fprintf(cfg.out, ", \"ipc\": %.3f",
+                    (double)pc->value[PERF_INSTRUCTIONS] /
+                    (double)pc->value[PERF_CYCLES]);
+        fprintf(cfg.out, "}");
+    }
+    fprintf(cfg.out, "}");
+    result_count++;
+    fflush(cfg.out);
+}
+
+/* Growth policy of _vector_append_internal, for the raw baselines */
+static size_t raw_grow(size_t capacity, size_t needed)
+{
+    size_t new_capacity = capacity + capacity / 2;
+    return new_capacity < needed ? needed : new_capacity;
+}
+
+/* Byte-wise ascending comparison matching compare_asc, for raw qsort */
+static size_t raw_sort_size;
+static int raw_compare_asc(const void* a, const void* b)
+{
+    const char* pa = (const char*)a;
+    const char* pb = (const char*)b;
+    for (size_t i = 0; i < raw_sort_size; ++i)
+    {
+        if (pa[i] < pb[i])
+            return -1;
+        if (pa[i] > pb[i])
+            return 1;
+    }
+    return 0;
+}
+
+/* Instantiate the single-threaded suite for each element type */
+#define BENCH_TYPE elem4
+#include "bench_suite.h"
+#undef BENCH_TYPE
+
+#define BENCH_TYPE elem16
+#include "bench_suite.h"
+#undef BENCH_TYPE
+
+#define BENCH_TYPE elem64
+#include "bench_suite.h"
+#undef BENCH_TYPE
+
+/* Out-of-bounds vector_at misses with callbacks silenced, i.e. the cost of */
+/* recording the thread-local error code */
+static void bench_at_miss(size_t n)
+{
+    uint64_t samples[cfg.reps];
+    perf_counts pc;
+    memset(&pc, 0, sizeof(pc));
+    vector* vec = vector_create(elem16, 1, (elem16){{0}});
+    vector_set_error_callback(VECTOR_ERROR_SILENT);
+    for (size_t r = 0; r < cfg.reps; ++r)
+    {
+        uint64_t misses = 0, t0 = bench_start();
+        for (size_t i = 0; i < n; ++i)
+            misses += vector_at(elem16, vec, i + 1) == NULL;
+        samples[r] = bench_stop(t0, &pc);
+        bench_sink += misses;
+    }
+    vector_set_error_callback(NULL);
+    vector_free(vec);
+    report("at_miss", "vector", sizeof(elem16), n, 1, n, samples, cfg.reps, &pc);
+}
+
+/* Thread scaling */
+
+typedef struct {
+    vector* vec;          /* Shared vector */
+    size_t ops;           /* Operations per thread */
+    pthread_barrier_t* start;
+    uint64_t seed;
+    uint64_t t_start;     /* Set by the worker after the barrier */
+    uint64_t t_end;       /* Set by the worker when done */
+} mt_arg;
+
+/* Reader thread: random vector_at calls on a shared vector */
+static void* mt_at_worker(void* p)
+{
+    mt_arg* arg = (mt_arg*)p;
+    uint64_t state = arg->seed, sum = 0;
+    size_t length = vector_length(arg->vec);
+    pthread_barrier_wait(arg->start);
+    arg->t_start = now_ns();
+    for (size_t i = 0; i < arg->ops; ++i)
+    {
+        elem16* e = vector_at(elem16, arg->vec, rng_next(&state) % length);
+        sum += e->v[0];
+    }
+    arg->t_end = now_ns();
+    bench_sink += sum;
+    return NULL;
+}
+
+/* Writer thread: appends to a shared vector */
+static void* mt_append_worker(void* p)
+{
+    mt_arg* arg = (mt_arg*)p;
+    elem16 e = {{(uint32_t)arg->seed}};
+    pthread_barrier_wait(arg->start);
+    arg->t_start = now_ns();
+    for (size_t i = 0; i < arg->ops; ++i)
+        vector_append(arg->vec, elem16, e);
+    arg->t_end = now_ns();
+    return NULL;
+}
+
+/* Runs one multi-threaded sample and returns the nanoseconds from the first */
+/* worker starting to the last worker finishing */
+static uint64_t mt_run(vector* vec, size_t threads, size_t ops,
+                       void* (*worker)(void*))
+{
+    pthread_t tids[threads];
+    mt_arg args[threads];
+    pthread_barrier_t start;
+    pthread_barrier_init(&start, NULL, (unsigned)threads + 1);
+    for (size_t t = 0; t < threads; ++t)
+    {
+        args[t] = (mt_arg){vec, ops, &start, 0x9E3779B97F4A7C15ull * (t + 1), 0, 0};
+        pthread_create(&tids[t], NULL, worker, &args[t]);
+    }
+    pthread_barrier_wait(&start);
+    uint64_t first = UINT64_MAX, last = 0;
+    for (size_t t = 0; t < threads; ++t)
+    {
+        pthread_join(tids[t], NULL);
+        if (args[t].t_start < first)
+            first = args[t].t_start;
+        if (args[t].t_end > last)
+            last = args[t].t_end;
+    }
+    pthread_barrier_destroy(&start);
+    return last - first;
+}
+
+/* Measures aggregate ns/op for shared reads and appends at 1..max_threads */
+static void bench_thread_scaling(size_t length)
+{
+    uint64_t samples[cfg.reps];
+    for (size_t threads = 1; threads <= cfg.max_threads; threads *= 2)
+    {
+        size_t ops = length;
+        if (bench_enabled("mt_at"))
+        {
+            vector* vec = vector_create(elem16, length, (elem16){{0}});
+            for (size_t r = 0; r < cfg.reps; ++r)
+                samples[r] = mt_run(vec, threads, ops, mt_at_worker);
+            report("mt_at", "vector", sizeof(elem16), length, threads,
+                   ops * threads, samples, cfg.reps, NULL);
+            vector_free(vec);
+        }
+        if (bench_enabled("mt_append"))
+        {
+            for (size_t r = 0; r < cfg.reps; ++r)
+            {
+                vector* vec = vector_create(elem16, 0, (elem16){{0}});
+                samples[r] = mt_run(vec, threads, ops, mt_append_worker);
+                vector_free(vec);
+            }
+            report("mt_append", "vector", sizeof(elem16), length, threads,
+                   ops * threads, samples, cfg.reps, NULL);
+        }
+    }
+}
+
+static void usage(const char* prog)
+{
+    fprintf(stderr,
+            "Usage: %s [--quick] [--reps N] [--threads N] [--filter NAME] "
+            "[--perf] [--out FILE]\n", prog);
+}
+
+int main(int argc, char** argv)
+{
+    cfg = (bench_config){{1024, 65536, 1048576}, 3, 5, 8, NULL, 0, stdout};
+    const char* out_path = NULL;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "--quick"))
+        {
+            cfg.lengths[0] = 256;
+            cfg.lengths[1] = 4096;
+            cfg.num_lengths = 2;
+            cfg.reps = 3;
+            cfg.max_threads = 4;
+        }
+        else if (!strcmp(argv[i], "--reps") && i + 1 < argc)
+            cfg.reps = strtoul(argv[++i], NULL, 10);
+        else if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+            cfg.max_threads = strtoul(argv[++i], NULL, 10);
+        else if (!strcmp(argv[i], "--filter") && i + 1 < argc)
+            cfg.filter = argv[++i];
+        else if (!strcmp(argv[i], "--perf"))
+            cfg.perf = 1;
+        else if (!strcmp(argv[i], "--out") && i + 1 < argc)
+            out_path = argv[++i];
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (cfg.reps == 0)
+        cfg.reps = 1;
+    if (cfg.max_threads == 0)
+        cfg.max_threads = 1;
+    if (out_path && !(cfg.out = fopen(out_path, "w")))
+    {
+        perror(out_path);
+        return 1;
+    }
+    if (cfg.perf && perf_counters_open() < 0)
+    {
+        /* Typically perf_event_paranoid > 2 or no PMU in a VM */
+        fprintf(stderr, "bench: hardware counters unavailable, "
+                "continuing without --perf\n");
+        cfg.perf = 0;
+    }
+
+    fprintf(cfg.out, "{\n  \"library\": \"vector.h\",\n"
+            "  \"reps\": %zu,\n  \"max_threads\": %zu,\n  \"perf\": %s,\n"
+            "  \"results\": [\n",
+            cfg.reps, cfg.max_threads, cfg.perf ? "true" : "false");
+    for (size_t i = 0; i < cfg.num_lengths; ++i)
+    {
+        bench_suite_elem4(cfg.lengths[i]);
+        bench_suite_elem16(cfg.lengths[i]);
+        bench_suite_elem64(cfg.lengths[i]);
+        if (bench_enabled("at_miss"))
+            bench_at_miss(cfg.lengths[i]);
+    }
+    bench_thread_scaling(cfg.lengths[cfg.num_lengths > 1 ? 1 : 0]);
+    fprintf(cfg.out, "\n  ]\n}\n");
+
+    if (cfg.perf)
+        perf_counters_close();
+    if (cfg.out != stdout)
+        fclose(cfg.out);
+    return 0;
+}
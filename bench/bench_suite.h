@@ -0,0 +1,457 @@
+/*
+ * bench_suite.h - Per-element-type benchmark bodies for bench.c
+ *
+ * Included once per element type with BENCH_TYPE defined. Each benchmark
+ * measures the public (locked) API, the unlocked *_internal baseline and a
+ * plain C array doing the same work, and reports all three.
+ */
+#ifndef BENCH_TYPE
+#error "Define BENCH_TYPE before including bench_suite.h"
+#endif
+
+#define BENCH_CAT_(a, b) a##b
+#define BENCH_CAT(a, b) BENCH_CAT_(a, b)
+#define BENCH_FN(name) BENCH_CAT(name##_, BENCH_TYPE)
+#define T BENCH_TYPE
+
+/* Builds an element whose first word is x */
+static T BENCH_FN(make)(uint64_t x)
+{
+    T e;
+    memset(&e, 0, sizeof(e));
+    e.v[0] = (uint32_t)x;
+    return e;
+}
+
+/* Creates a vector of length n filled with pseudo-random elements */
+static vector* BENCH_FN(filled)(size_t n, uint64_t seed)
+{
+    vector* vec = vector_create(T, n, BENCH_FN(make)(0));
+    uint64_t state = seed | 1;
+    for (size_t i = 0; i < n; ++i)
+        *vector_at_ptr(T, vec, i) = BENCH_FN(make)(rng_next(&state));
+    return vec;
+}
+
+/* Number of middle inserts/removes per sample, bounded to ~64 MiB of memmove */
+static size_t BENCH_FN(shift_ops)(size_t n)
+{
+    size_t bytes = n * sizeof(T) / 2 + 1;
+    size_t ops = ((size_t)64 << 20) / bytes;
+    return ops < 1 ? 1 : ops > 256 ? 256 : ops;
+}
+
+static void BENCH_FN(bench_append)(size_t n)
+{
+    uint64_t s[3][cfg.reps];
+    perf_counts pc[3];
+    memset(pc, 0, sizeof(pc));
+    T e = BENCH_FN(make)(42);
+    for (size_t r = 0; r < cfg.reps; ++r)
+    {
+        vector* vec = vector_create(T, 0, BENCH_FN(make)(0));
+        uint64_t t0 = bench_start();
+        for (size_t i = 0; i < n; ++i)
+            vector_append(vec, T, e);
+        s[0][r] = bench_stop(t0, &pc[0]);
+        vector_free(vec);
+
+        vec = vector_create(T, 0, BENCH_FN(make)(0));
+        t0 = bench_start();
+        for (size_t i = 0; i < n; ++i)
+            _vector_append_internal(vec, 1, &e);
+        s[1][r] = bench_stop(t0, &pc[1]);
+        vector_free(vec);
+
+        T* arr = NULL;
+        size_t len = 0, cap = 0;
+        t0 = bench_start();
+        for (size_t i = 0; i < n; ++i)
+        {
+            if (len == cap)
+            {
+                cap = raw_grow(cap, len + 1);
+                arr = realloc(arr, cap * sizeof(T));
+            }
+            arr[len++] = e;
+        }
+        s[2][r] = bench_stop(t0, &pc[2]);
+        bench_sink += arr[len - 1].v[0];
+        free(arr);
+    }
+    report("append", "vector", sizeof(T), n, 1, n, s[0], cfg.reps, &pc[0]);
+    report("append", "unlocked", sizeof(T), n, 1, n, s[1], cfg.reps, &pc[1]);
+    report("append", "raw", sizeof(T), n, 1, n, s[2], cfg.reps, &pc[2]);
+}
+
+static void BENCH_FN(bench_at)(size_t n)
+{
+    uint64_t s[3][cfg.reps];
+    perf_counts pc[3];
+    memset(pc, 0, sizeof(pc));
+    vector* vec = BENCH_FN(filled)(n, 1);
+    T* arr = vec->data;
+    for (size_t r = 0; r < cfg.reps; ++r)
+    {
+        uint64_t sum = 0, t0 = bench_start();
+        for (size_t i = 0; i < n; ++i)
+            sum += vector_at(T, vec, i)->v[0];
+        s[0][r] = bench_stop(t0, &pc[0]);
+
+        t0 = bench_start();
+        for (size_t i = 0; i < n; ++i)
+            sum += vector_at_ptr(T, vec, i)->v[0];
+        s[1][r] = bench_stop(t0, &pc[1]);
+
+        t0 = bench_start();
+        for (size_t i = 0; i < n; ++i)
+            sum += arr[i].v[0];
+        s[2][r] = bench_stop(t0, &pc[2]);
+        bench_sink += sum;
+    }
+    vector_free(vec);
+    report("at", "vector", sizeof(T), n, 1, n, s[0], cfg.reps, &pc[0]);
+    report("at", "unlocked", sizeof(T), n, 1, n, s[1], cfg.reps, &pc[1]);
+    report("at", "raw", sizeof(T), n, 1, n, s[2], cfg.reps, &pc[2]);
+}
+
+static void BENCH_FN(bench_set)(size_t n)
+{
+    uint64_t s[3][cfg.reps];
+    perf_counts pc[3];
+    memset(pc, 0, sizeof(pc));
+    vector* vec = vector_create(T, n, BENCH_FN(make)(0));
+    T* arr = vec->data;
+    T e = BENCH_FN(make)(7);
+    for (size_t r = 0; r < cfg.reps; ++r)
+    {
+        uint64_t t0 = bench_start();
+        for (size_t i = 0; i < n; ++i)
+            vector_set(T, vec, i, e);
+        s[0][r] = bench_stop(t0, &pc[0]);
+
+        t0 = bench_start();
+        for (size_t i = 0; i < n; ++i)
+            *vector_at_ptr(T, vec, i) = e;
+        s[1][r] = bench_stop(t0, &pc[1]);
+
+        t0 = bench_start();
+        for (size_t i = 0; i < n; ++i)
+            arr[i] = e;
+        s[2][r] = bench_stop(t0, &pc[2]);
+        bench_sink += arr[n - 1].v[0];
+    }
+    vector_free(vec);
+    report("set", "vector", sizeof(T), n, 1, n, s[0], cfg.reps, &pc[0]);
+    report("set", "unlocked", sizeof(T), n, 1, n, s[1], cfg.reps, &pc[1]);
+    report("set", "raw", sizeof(T), n, 1, n, s[2], cfg.reps, &pc[2]);
+}
+
+/* Shared body for insert (middle) and prepend (index 0) */
+static void BENCH_FN(bench_shift_insert)(const char* name, size_t n, int front)
+{
+    uint64_t s[3][cfg.reps];
+    perf_counts pc[3];
+    memset(pc, 0, sizeof(pc));
+    size_t ops = BENCH_FN(shift_ops)(n);
+    T e = BENCH_FN(make)(9);
+    for (size_t r = 0; r < cfg.reps; ++r)
+    {
+        vector* vec = BENCH_FN(filled)(n, r + 1);
+        uint64_t t0 = bench_start();
+        for (size_t i = 0; i < ops; ++i)
+        {
+            if (front)
+                vector_prepend(vec, T, e);
+            else
+                vector_insert(vec, T, vector_length(vec) / 2, e);
+        }
+        s[0][r] = bench_stop(t0, &pc[0]);
+        vector_free(vec);
+
+        vec = BENCH_FN(filled)(n, r + 1);
+        t0 = bench_start();
+        for (size_t i = 0; i < ops; ++i)
+            _vector_insert_internal(vec, front ? 0 : vec->length / 2, 1, &e);
+        s[1][r] = bench_stop(t0, &pc[1]);
+        vector_free(vec);
+
+        size_t len = n, cap = n;
+        T* arr = malloc(cap * sizeof(T));
+        memset(arr, 0, cap * sizeof(T));
+        t0 = bench_start();
+        for (size_t i = 0; i < ops; ++i)
+        {
+            size_t idx = front ? 0 : len / 2;
+            if (len == cap)
+            {
+                cap = raw_grow(cap, len + 1);
+                arr = realloc(arr, cap * sizeof(T));
+            }
+            memmove(arr + idx + 1, arr + idx, (len - idx) * sizeof(T));
+            arr[idx] = e;
+            len++;
+        }
+        s[2][r] = bench_stop(t0, &pc[2]);
+        bench_sink += arr[0].v[0];
+        free(arr);
+    }
+    report(name, "vector", sizeof(T), n, 1, ops, s[0], cfg.reps, &pc[0]);
+    report(name, "unlocked", sizeof(T), n, 1, ops, s[1], cfg.reps, &pc[1]);
+    report(name, "raw", sizeof(T), n, 1, ops, s[2], cfg.reps, &pc[2]);
+}
+
+static void BENCH_FN(bench_remove)(size_t n)
+{
+    uint64_t s[3][cfg.reps];
+    perf_counts pc[3];
+    memset(pc, 0, sizeof(pc));
+    size_t ops = BENCH_FN(shift_ops)(n);
+    for (size_t r = 0; r < cfg.reps; ++r)
+    {
+        vector* vec = BENCH_FN(filled)(n + ops, r + 1);
+        uint64_t t0 = bench_start();
+        for (size_t i = 0; i < ops; ++i)
+            vector_remove(vec, vector_length(vec) / 2, 1);
+        s[0][r] = bench_stop(t0, &pc[0]);
+        vector_free(vec);
+
+        vec = BENCH_FN(filled)(n + ops, r + 1);
+        t0 = bench_start();
+        for (size_t i = 0; i < ops; ++i)
+            _vector_remove_internal(vec, vec->length / 2, 1);
+        s[1][r] = bench_stop(t0, &pc[1]);
+        vector_free(vec);
+
+        size_t len = n + ops;
+        T* arr = calloc(len, sizeof(T));
+        t0 = bench_start();
+        for (size_t i = 0; i < ops; ++i)
+        {
+            size_t idx = len / 2;
+            memmove(arr + idx, arr + idx + 1, (len - idx - 1) * sizeof(T));
+            len--;
+        }
+        s[2][r] = bench_stop(t0, &pc[2]);
+        bench_sink += arr[0].v[0];
+        free(arr);
+    }
+    report("remove", "vector", sizeof(T), n, 1, ops, s[0], cfg.reps, &pc[0]);
+    report("remove", "unlocked", sizeof(T), n, 1, ops, s[1], cfg.reps, &pc[1]);
+    report("remove", "raw", sizeof(T), n, 1, ops, s[2], cfg.reps, &pc[2]);
+}
+
+static void BENCH_FN(bench_sort)(size_t n)
+{
+    uint64_t s[3][cfg.reps];
+    perf_counts pc[3];
+    memset(pc, 0, sizeof(pc));
+    for (size_t r = 0; r < cfg.reps; ++r)
+    {
+        vector* vec = BENCH_FN(filled)(n, r + 1);
+        uint64_t t0 = bench_start();
+        vector_sort(vec, T, compare_asc);
+        s[0][r] = bench_stop(t0, &pc[0]);
+        vector_free(vec);
+
+        vec = BENCH_FN(filled)(n, r + 1);
+        t0 = bench_start();
+        _vector_sort_internal(vec, compare_asc);
+        s[1][r] = bench_stop(t0, &pc[1]);
+
+        T* arr = malloc(n * sizeof(T));
+        uint64_t state = (r + 1) | 1;
+        for (size_t i = 0; i < n; ++i)
+            arr[i] = BENCH_FN(make)(rng_next(&state));
+        raw_sort_size = sizeof(T);
+        t0 = bench_start();
+        qsort(arr, n, sizeof(T), raw_compare_asc);
+        s[2][r] = bench_stop(t0, &pc[2]);
+        bench_sink += arr[0].v[0] + vector_at_ptr(T, vec, 0)->v[0];
+        free(arr);
+        vector_free(vec);
+    }
+    report("sort", "vector", sizeof(T), n, 1, n, s[0], cfg.reps, &pc[0]);
+    report("sort", "unlocked", sizeof(T), n, 1, n, s[1], cfg.reps, &pc[1]);
+    report("sort", "raw", sizeof(T), n, 1, n, s[2], cfg.reps, &pc[2]);
+}
+
+/* Full scan for an absent value, so ops == length */
+static void BENCH_FN(bench_find)(size_t n)
+{
+    uint64_t s[3][cfg.reps];
+    perf_counts pc[3];
+    memset(pc, 0, sizeof(pc));
+    vector* vec = vector_create(T, n, BENCH_FN(make)(0));
+    T* arr = vec->data;
+    T key = BENCH_FN(make)(1);
+    for (size_t r = 0; r < cfg.reps; ++r)
+    {
+        uint64_t t0 = bench_start();
+        ssize_t idx = _vector_find_internal(vec, &key, sizeof(T), compare_eq);
+        s[0][r] = bench_stop(t0, &pc[0]);
+        bench_sink += (uint64_t)idx;
+
+        t0 = bench_start();
+        idx = -1;
+        for (size_t i = 0; i < n; ++i)
+        {
+            if (compare_eq(vector_at_ptr(T, vec, i), &key, vec) == 0)
+            {
+                idx = (ssize_t)i;
+                break;
+            }
+        }
+        s[1][r] = bench_stop(t0, &pc[1]);
+        bench_sink += (uint64_t)idx;
+
+        t0 = bench_start();
+        idx = -1;
+        for (size_t i = 0; i < n; ++i)
+        {
+            if (memcmp(&arr[i], &key, sizeof(T)) == 0)
+            {
+                idx = (ssize_t)i;
+                break;
+            }
+        }
+        s[2][r] = bench_stop(t0, &pc[2]);
+        bench_sink += (uint64_t)idx;
+    }
+    vector_free(vec);
+    report("find", "vector", sizeof(T), n, 1, n, s[0], cfg.reps, &pc[0]);
+    report("find", "unlocked", sizeof(T), n, 1, n, s[1], cfg.reps, &pc[1]);
+    report("find", "raw", sizeof(T), n, 1, n, s[2], cfg.reps, &pc[2]);
+}
+
+static void BENCH_FN(bench_copy)(size_t n)
+{
+    uint64_t s[3][cfg.reps];
+    perf_counts pc[3];
+    memset(pc, 0, sizeof(pc));
+    vector* src = BENCH_FN(filled)(n, 3);
+    for (size_t r = 0; r < cfg.reps; ++r)
+    {
+        uint64_t t0 = bench_start();
+        vector* dst = vector_copy(src);
+        s[0][r] = bench_stop(t0, &pc[0]);
+        vector_free(dst);
+
+        t0 = bench_start();
+        dst = _vector_create_base(src->element_size, src->length);
+        memcpy(dst->data, src->data, src->length * src->element_size);
+        s[1][r] = bench_stop(t0, &pc[1]);
+        vector_free(dst);
+
+        t0 = bench_start();
+        T* arr = malloc(n * sizeof(T));
+        memcpy(arr, src->data, n * sizeof(T));
+        s[2][r] = bench_stop(t0, &pc[2]);
+        bench_sink += arr[0].v[0];
+        free(arr);
+    }
+    vector_free(src);
+    report("copy", "vector", sizeof(T), n, 1, n, s[0], cfg.reps, &pc[0]);
+    report("copy", "unlocked", sizeof(T), n, 1, n, s[1], cfg.reps, &pc[1]);
+    report("copy", "raw", sizeof(T), n, 1, n, s[2], cfg.reps, &pc[2]);
+}
+
+/* Serialize and deserialize against a tmpfile() living in the page cache */
+static void BENCH_FN(bench_serialize)(size_t n)
+{
+    uint64_t s[6][cfg.reps];
+    perf_counts pc[6];
+    memset(pc, 0, sizeof(pc));
+    vector* vec = BENCH_FN(filled)(n, 5);
+    FILE* fp = tmpfile();
+    if (!fp)
+    {
+        vector_free(vec);
+        return;
+    }
+    for (size_t r = 0; r < cfg.reps; ++r)
+    {
+        rewind(fp);
+        uint64_t t0 = bench_start();
+        vector_serialize(vec, fp);
+        fflush(fp);
+        s[0][r] = bench_stop(t0, &pc[0]);
+
+        rewind(fp);
+        t0 = bench_start();
+        _vector_serialize_internal(vec, fp);
+        fflush(fp);
+        s[1][r] = bench_stop(t0, &pc[1]);
+
+        rewind(fp);
+        size_t esize = sizeof(T);
+        t0 = bench_start();
+        fwrite(&n, sizeof(size_t), 1, fp);
+        fwrite(&esize, sizeof(size_t), 1, fp);
+        fwrite(vec->data, sizeof(T), n, fp);
+        fflush(fp);
+        s[2][r] = bench_stop(t0, &pc[2]);
+
+        rewind(fp);
+        t0 = bench_start();
+        vector* back = vector_deserialize(fp, sizeof(T));
+        s[3][r] = bench_stop(t0, &pc[3]);
+        vector_free(back);
+
+        rewind(fp);
+        t0 = bench_start();
+        back = _vector_deserialize_internal(fp, sizeof(T));
+        s[4][r] = bench_stop(t0, &pc[4]);
+        vector_free(back);
+
+        rewind(fp);
+        t0 = bench_start();
+        size_t len = 0;
+        if (fread(&len, sizeof(size_t), 1, fp) == 1 &&
+            fread(&esize, sizeof(size_t), 1, fp) == 1)
+        {
+            T* arr = malloc(len * sizeof(T));
+            bench_sink += fread(arr, sizeof(T), len, fp);
+            free(arr);
+        }
+        s[5][r] = bench_stop(t0, &pc[5]);
+    }
+    fclose(fp);
+    vector_free(vec);
+    report("serialize", "vector", sizeof(T), n, 1, n, s[0], cfg.reps, &pc[0]);
+    report("serialize", "unlocked", sizeof(T), n, 1, n, s[1], cfg.reps, &pc[1]);
+    report("serialize", "raw", sizeof(T), n, 1, n, s[2], cfg.reps, &pc[2]);
+    report("deserialize", "vector", sizeof(T), n, 1, n, s[3], cfg.reps, &pc[3]);
+    report("deserialize", "unlocked", sizeof(T), n, 1, n, s[4], cfg.reps, &pc[4]);
+    report("deserialize", "raw", sizeof(T), n, 1, n, s[5], cfg.reps, &pc[5]);
+}
+
+/* Runs every enabled benchmark for this element type at length n */
+static void BENCH_FN(bench_suite)(size_t n)
+{
+    if (bench_enabled("append"))
+        BENCH_FN(bench_append)(n);
+    if (bench_enabled("at"))
+        BENCH_FN(bench_at)(n);
+    if (bench_enabled("set"))
+        BENCH_FN(bench_set)(n);
+    if (bench_enabled("insert"))
+        BENCH_FN(bench_shift_insert)("insert", n, 0);
+    if (bench_enabled("prepend"))
+        BENCH_FN(bench_shift_insert)("prepend", n, 1);
+    if (bench_enabled("remove"))
+        BENCH_FN(bench_remove)(n);
+    if (bench_enabled("sort"))
+        BENCH_FN(bench_sort)(n);
+    if (bench_enabled("find"))
+        BENCH_FN(bench_find)(n);
+    if (bench_enabled("copy"))
+        BENCH_FN(bench_copy)(n);
+    if (bench_enabled("serialize") || bench_enabled("deserialize"))
+        BENCH_FN(bench_serialize)(n);
+}
+
+#undef T
+#undef BENCH_FN
+#undef BENCH_CAT
+#undef BENCH_CAT_
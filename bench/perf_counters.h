@@ -0,0 +1,160 @@
+/*
+ * perf_counters.h - Hardware performance counters for the vector.h benchmarks
+ *
+ * Wraps perf_event_open(2) as one counter group per process (calling thread
+ * only, user space only) so a benchmark can bracket a timed region with
+ * perf_counters_start/perf_counters_stop and accumulate the deltas.
+ *
+ * Counters that the CPU, kernel or virtualisation layer does not provide are
+ * skipped individually; if none can be opened perf_counters_open returns -1
+ * and the benchmarks run without counters. On non-Linux systems every call
+ * is a no-op.
+ */
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/* Counter indices */
+enum {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_DTLB_MISSES,
+    PERF_NUM_COUNTERS
+};
+
+static const char* const perf_counter_names[PERF_NUM_COUNTERS] = {
+    "cycles", "instructions", "l1d_misses", "llc_misses",
+    "branch_misses", "dtlb_misses"
+};
+
+/* Accumulated counter values for one benchmark variant */
+typedef struct {
+    uint64_t value[PERF_NUM_COUNTERS]; /* Scaled event counts */
+    uint64_t samples;                  /* Timed regions accumulated */
+} perf_counts;
+
+/* Process-wide counter group */
+static struct {
+    int fd[PERF_NUM_COUNTERS];  /* -1 when unavailable */
+    int slot[PERF_NUM_COUNTERS]; /* Position in the group read buffer */
+    int leader;                 /* Group leader fd, -1 when disabled */
+    int count;                  /* Counters in the group */
+} perf_group = {{-1, -1, -1, -1, -1, -1}, {0}, -1, 0};
+
+#ifdef __linux__
+/* Builds a PERF_TYPE_HW_CACHE config for read misses */
+#define PERF_CACHE_READ_MISS(cache) \
+    ((cache) | (PERF_COUNT_HW_CACHE_OP_READ << 8) | \
+     (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))
+
+static int perf_open_one(uint32_t type, uint64_t config, int group_fd)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = group_fd == -1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                       PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+#endif
+
+/* Opens the counter group for the calling thread */
+/* Returns: number of counters opened, -1 if none are available */
+static int perf_counters_open(void)
+{
+#ifdef __linux__
+    static const struct { uint32_t type; uint64_t config; } events[PERF_NUM_COUNTERS] = {
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {PERF_TYPE_HW_CACHE, PERF_CACHE_READ_MISS(PERF_COUNT_HW_CACHE_L1D)},
+        {PERF_TYPE_HW_CACHE, PERF_CACHE_READ_MISS(PERF_COUNT_HW_CACHE_LL)},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        {PERF_TYPE_HW_CACHE, PERF_CACHE_READ_MISS(PERF_COUNT_HW_CACHE_DTLB)},
+    };
+    for (int i = 0; i < PERF_NUM_COUNTERS; ++i)
+    {
+        int fd = perf_open_one(events[i].type, events[i].config, perf_group.leader);
+        if (fd < 0)
+            continue;
+        if (perf_group.leader == -1)
+            perf_group.leader = fd;
+        perf_group.fd[i] = fd;
+        perf_group.slot[i] = perf_group.count++;
+    }
+    return perf_group.count ? perf_group.count : -1;
+#else
+    return -1;
+#endif
+}
+
+/* Closes the counter group */
+static void perf_counters_close(void)
+{
+#ifdef __linux__
+    for (int i = 0; i < PERF_NUM_COUNTERS; ++i)
+    {
+        if (perf_group.fd[i] >= 0)
+            close(perf_group.fd[i]);
+        perf_group.fd[i] = -1;
+    }
+#endif
+    perf_group.leader = -1;
+    perf_group.count = 0;
+}
+
+/* Returns 1 if counter i was opened */
+static int perf_counter_available(int i)
+{
+    return perf_group.fd[i] >= 0;
+}
+
+/* Resets and enables the group; no-op when counters are closed */
+static void perf_counters_start(void)
+{
+#ifdef __linux__
+    if (perf_group.leader < 0)
+        return;
+    ioctl(perf_group.leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(perf_group.leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+}
+
+/* Disables the group and adds the counts since perf_counters_start to acc */
+/* Note: counts are scaled by enabled/running time if the kernel multiplexed */
+static void perf_counters_stop(perf_counts* acc)
+{
+#ifdef __linux__
+    if (perf_group.leader < 0 || !acc)
+        return;
+    ioctl(perf_group.leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    uint64_t buf[3 + PERF_NUM_COUNTERS];
+    if (read(perf_group.leader, buf, sizeof(buf)) < (ssize_t)(3 * sizeof(uint64_t)))
+        return;
+    double scale = buf[2] ? (double)buf[1] / (double)buf[2] : 1.0;
+    for (int i = 0; i < PERF_NUM_COUNTERS; ++i)
+        if (perf_group.fd[i] >= 0)
+            acc->value[i] += (uint64_t)((double)buf[3 + perf_group.slot[i]] * scale);
+    acc->samples++;
+#else
+    (void)acc;
+#endif
+}
+
+#endif /* PERF_COUNTERS_H */
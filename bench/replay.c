@@ -0,0 +1,537 @@
+/*
+ * replay.c - Replays a VECTOR_TRACE operation trace against vector.h
+ * Copyright (C) 2025 Stefan Froberg <stefan.froberg@protonmail.com>
+ *
+ * Overview:
+ * Reads a trace written by a program built with -DVECTOR_TRACE (see
+ * vector_trace_start) and re-executes every operation, in trace order and on
+ * a single thread, against the vector.h this tool is compiled with. Building
+ * replay from two trees and running it on the same trace compares library
+ * changes on a production access pattern.
+ *
+ * Operations go through the public API only, so each one takes the locks a
+ * caller's would. The trace format comes from vector_trace.h, not vector.h,
+ * so replay builds against trees without the recorder. Operations the target
+ * tree lacks are skipped and reported as unsupported: vector_fill and
+ * vector_assign_n are detected, older trees without vector_swap_contents,
+ * vector_move or vector_release_buffer build with -DREPLAY_NO_SWAP_CONTENTS,
+ * -DREPLAY_NO_MOVE or -DREPLAY_NO_RELEASE. Operations that need the element
+ * type (set, find, fill, assign) are replayed for the sizes in REPLAY_SIZES
+ * and reported as unsupported on vectors of any other size.
+ *
+ * Element contents are not recorded, so appended and inserted values come
+ * from a fixed pseudo-random pattern; sort and find timings therefore follow
+ * the recorded lengths and match positions rather than the original data.
+ * Records for vectors created before the trace started are skipped.
+ *
+ * Output:
+ *   One JSON document on stdout (or --out FILE) with the total replay time
+ *   and per-operation counts and latency percentiles.
+ *
+ * Usage:
+ *   ./replay TRACE [--repeat N] [--out FILE]
+ *   make replay CPPFLAGS="-I/path/to/other/tree -I."   (replay another tree)
+ */
+#include "vector.h"
+#include "vector_trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#if defined(VECTOR_TRACE_VERSION)
+_Static_assert(VECTOR_TRACE_VERSION == TRACE_VERSION &&
+               VECTOR_TRACE_OP_COUNT == (int)TRACE_OP_COUNT &&
+               sizeof(vector_trace_record) == sizeof(trace_record),
+               "bench/vector_trace.h is out of step with vector.h");
+#endif
+
+#if !defined(vector_fill)
+#define REPLAY_NO_FILL
+#endif
+#if !defined(vector_assign_n)
+#define REPLAY_NO_ASSIGN
+#endif
+
+/* Element sizes the typed operations are replayed at */
+#define REPLAY_SIZES(X) X(1) X(2) X(4) X(8) X(12) X(16) X(24) X(32) X(48) X(64)
+
+/* elemN is an N-byte element; the value macros (find, fill, assign) build */
+/* their argument as (type){(value)}, so they take boxedN and an elemN */
+#define REPLAY_ELEM(n) \
+    typedef struct { unsigned char b[n]; } elem##n; \
+    typedef struct { elem##n value; } boxed##n;
+REPLAY_SIZES(REPLAY_ELEM)
+#undef REPLAY_ELEM
+
+/* replay_one result for an operation the target build cannot replay */
+#define REPLAY_UNSUPPORTED 1
+
+static const char* const op_names[TRACE_OP_COUNT] = {
+    NULL, "create", "free", "append", "insert", "prepend", "remove", "pop",
+    "at", "set", "find", "sort", "clear", "copy", "reserve", "resize",
+    "shrink", "swap", "serialize", "deserialize", "release", "swap_contents",
+    "move", "fill", "assign"
+};
+
+/* Latency histogram: log-scale buckets, four per power of two */
+#define REPLAY_SUB_BITS 2
+#define REPLAY_BUCKETS ((64 - REPLAY_SUB_BITS + 1) << REPLAY_SUB_BITS)
+
+/* Per-operation replay results */
+typedef struct {
+    uint64_t count;
+    uint64_t failed;
+    uint64_t unsupported;
+    uint64_t total_ns;
+    uint64_t max_ns;
+    uint64_t buckets[REPLAY_BUCKETS];
+} op_result;
+
+static op_result results[TRACE_OP_COUNT];
+static vector** vectors;        /* Indexed by trace id */
+static size_t num_vectors;
+static unsigned char* scratch;  /* Source bytes for appended values */
+static size_t scratch_size;
+static FILE* serialize_fp;      /* Reused target for serialize records */
+static size_t find_target;      /* Position compare_position matches */
+static volatile uint64_t replay_sink;
+
+/* Returns monotonic time in nanoseconds */
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* Returns the histogram bucket for a latency */
+static size_t bucket_index(uint64_t ns)
+{
+    if (ns < (1u << REPLAY_SUB_BITS))
+        return (size_t)ns;
+    unsigned msb = 63u - (unsigned)__builtin_clzll(ns);
+    size_t sub = (size_t)(ns >> (msb - REPLAY_SUB_BITS)) & ((1u << REPLAY_SUB_BITS) - 1);
+    return ((size_t)(msb - REPLAY_SUB_BITS + 1) << REPLAY_SUB_BITS) + sub;
+}
+
+/* Returns the largest latency in a histogram bucket */
+static uint64_t bucket_upper(size_t index)
+{
+    if (index < (1u << REPLAY_SUB_BITS))
+        return index;
+    unsigned shift = (unsigned)(index >> REPLAY_SUB_BITS) - 1;
+    uint64_t sub = (index & ((1u << REPLAY_SUB_BITS) - 1)) | (1u << REPLAY_SUB_BITS);
+    return ((sub + 1) << shift) - 1;
+}
+
+/* Adds one latency sample */
+static void record_latency(op_result* res, uint64_t ns)
+{
+    res->buckets[bucket_index(ns)]++;
+    res->total_ns += ns;
+    if (ns > res->max_ns)
+        res->max_ns = ns;
+}
+
+/* Returns the upper bound of the bucket holding percentile p, capped at max */
+static uint64_t percentile(const op_result* res, double p)
+{
+    uint64_t samples = res->count - res->unsupported;
+    uint64_t rank = (uint64_t)((p / 100.0) * (double)samples + 0.5);
+    if (rank == 0)
+        rank = 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < REPLAY_BUCKETS; ++i)
+    {
+        seen += res->buckets[i];
+        if (seen >= rank)
+        {
+            uint64_t upper = bucket_upper(i);
+            return upper < res->max_ns ? upper : res->max_ns;
+        }
+    }
+    return res->max_ns;
+}
+
+/* Returns the vector for a trace id, NULL if unknown */
+static vector* lookup(uint32_t id)
+{
+    return id < num_vectors ? vectors[id] : NULL;
+}
+
+/* Maps a trace id to a vector, growing the table as needed */
+static void bind(uint32_t id, vector* vec)
+{
+    if (id >= num_vectors)
+    {
+        size_t n = num_vectors ? num_vectors : 64;
+        while (n <= id)
+            n *= 2;
+        vectors = realloc(vectors, n * sizeof(vector*));
+        memset(vectors + num_vectors, 0, (n - num_vectors) * sizeof(vector*));
+        num_vectors = n;
+    }
+    vectors[id] = vec;
+}
+
+/* Returns at least bytes of pseudo-random source data */
+static const void* values(size_t bytes)
+{
+    if (bytes > scratch_size)
+    {
+        scratch = realloc(scratch, bytes);
+        uint64_t state = 0x9E3779B97F4A7C15ull;
+        for (size_t i = scratch_size; i < bytes; ++i)
+        {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            scratch[i] = (unsigned char)state;
+        }
+        scratch_size = bytes;
+    }
+    return scratch;
+}
+
+/* Matches the element at find_target; context is the vector searched */
+static int compare_position(const void* elem, const void* target, void* context)
+{
+    const vector* vec = (const vector*)context;
+    (void)target;
+    size_t index = (size_t)((const char*)elem - (const char*)vec->data) /
+                   vec->element_size;
+    return index != find_target;
+}
+
+/* Creates a vector of count elements of element_size pattern bytes */
+static vector* create(size_t element_size, size_t count)
+{
+    void* data = NULL;
+    if (count)
+    {
+        data = malloc(element_size * count);
+        if (!data)
+            return NULL;
+        memcpy(data, values(element_size * count), element_size * count);
+    }
+    vector* vec = vector_from_buffer(data, count, count, element_size, NULL);
+    if (!vec)
+        free(data);
+    return vec;
+}
+
+/* Re-executes an operation that needs the element type */
+/* Returns: 0 on success, -1 if the library failed, REPLAY_UNSUPPORTED if */
+/*          the element size is not in REPLAY_SIZES or the op is missing */
+static int replay_typed(const trace_record* rec, vector* vec)
+{
+    size_t index = (size_t)rec->index, count = (size_t)rec->count;
+    (void)count;
+    switch (vec->element_size)
+    {
+#define REPLAY_CASE(n) \
+    case n: \
+        switch (rec->op) \
+        { \
+        case TRACE_SET: \
+        { \
+            int in_range = index < vector_length(vec); \
+            vector_set(elem##n, vec, index, *(const elem##n*)values(n)); \
+            return in_range ? 0 : -1; \
+        } \
+        case TRACE_FIND: \
+        { \
+            find_target = index; \
+            ssize_t found = vector_find(boxed##n, vec, *(const elem##n*)values(n), \
+                                        compare_position); \
+            return (found < 0) == (index == SIZE_MAX) ? 0 : -1; \
+        } \
+        REPLAY_FILL_CASE(n) \
+        REPLAY_ASSIGN_CASE(n) \
+        default: \
+            return REPLAY_UNSUPPORTED; \
+        }
+#if defined(REPLAY_NO_FILL)
+#define REPLAY_FILL_CASE(n)
+#else
+#define REPLAY_FILL_CASE(n) \
+        case TRACE_FILL: \
+            return vector_fill(vec, boxed##n, *(const elem##n*)values(n));
+#endif
+#if defined(REPLAY_NO_ASSIGN)
+#define REPLAY_ASSIGN_CASE(n)
+#else
+#define REPLAY_ASSIGN_CASE(n) \
+        case TRACE_ASSIGN: \
+            return vector_assign_n(vec, boxed##n, count, \
+                                   *(const elem##n*)values(n));
+#endif
+    REPLAY_SIZES(REPLAY_CASE)
+#undef REPLAY_CASE
+#undef REPLAY_FILL_CASE
+#undef REPLAY_ASSIGN_CASE
+    }
+    return REPLAY_UNSUPPORTED;
+}
+
+/* Re-executes one record */
+/* Returns: 0 on success, -1 if the library failed, REPLAY_UNSUPPORTED if */
+/*          the target build cannot replay it */
+static int replay_one(const trace_record* rec, vector* vec)
+{
+    size_t index = (size_t)rec->index, count = (size_t)rec->count;
+    switch (rec->op)
+    {
+    case TRACE_CREATE:
+        vec = create(index, count);
+        bind(rec->vector_id, vec);
+        return vec ? 0 : -1;
+    case TRACE_FREE:
+        vector_free(vec);
+        bind(rec->vector_id, NULL);
+        return 0;
+    case TRACE_APPEND:
+        return vector_append_array(vec, values(count * vec->element_size), count);
+    case TRACE_INSERT:
+    case TRACE_PREPEND:
+        return vector_insert_array(vec, rec->op == TRACE_INSERT ? index : 0,
+                                   values(count * vec->element_size), count);
+    case TRACE_REMOVE:
+        return vector_remove(vec, index, count);
+    case TRACE_POP:
+    {
+        void* popped = vector_pop(void, vec);
+        free(popped);
+        return popped ? 0 : -1;
+    }
+    case TRACE_AT:
+    {
+        unsigned char* p = vector_at(unsigned char, vec, index);
+        if (!p)
+            return -1;
+        replay_sink += *p;
+        return 0;
+    }
+    case TRACE_SET:
+    case TRACE_FIND:
+    case TRACE_FILL:
+    case TRACE_ASSIGN:
+        return replay_typed(rec, vec);
+    case TRACE_SORT:
+        vector_sort(vec, unsigned char, compare_asc);
+        return 0;
+    case TRACE_CLEAR:
+        return vector_clear(vec);
+    case TRACE_COPY:
+    {
+        /* The copy's own CREATE record came first; replace that vector */
+        vector* copy = vector_copy(vec);
+        vector_free(lookup((uint32_t)index));
+        bind((uint32_t)index, copy);
+        return copy ? 0 : -1;
+    }
+    case TRACE_RESERVE:
+        return vector_reserve(vec, count);
+    case TRACE_RESIZE:
+        return vector_resize(vec, count);
+    case TRACE_SHRINK:
+        return vector_shrink_to_fit(vec);
+    case TRACE_SWAP:
+        return vector_swap(vec, index, count);
+    case TRACE_SERIALIZE:
+        rewind(serialize_fp);
+        return vector_serialize(vec, serialize_fp);
+    case TRACE_DESERIALIZE:
+    {
+        /* Round-trips the vector its CREATE record built */
+        rewind(serialize_fp);
+        if (vector_serialize(vec, serialize_fp) != 0)
+            return -1;
+        rewind(serialize_fp);
+        vector* copy = vector_deserialize(serialize_fp, vec->element_size);
+        vector_free(vec);
+        bind(rec->vector_id, copy);
+        return copy ? 0 : -1;
+    }
+    case TRACE_RELEASE:
+#if defined(REPLAY_NO_RELEASE)
+        return REPLAY_UNSUPPORTED;
+#else
+        vec->allocator.free(vector_release_buffer(vec, NULL, NULL));
+        return 0;
+#endif
+    case TRACE_SWAP_CONTENTS:
+    {
+#if defined(REPLAY_NO_SWAP_CONTENTS)
+        return REPLAY_UNSUPPORTED;
+#else
+        vector* other = lookup((uint32_t)index);
+        return other ? vector_swap_contents(vec, other) : -1;
+#endif
+    }
+    case TRACE_MOVE:
+    {
+#if defined(REPLAY_NO_MOVE)
+        return REPLAY_UNSUPPORTED;
+#else
+        vector* src = lookup((uint32_t)index);
+        return src ? vector_move(vec, src) : -1;
+#endif
+    }
+    }
+    return REPLAY_UNSUPPORTED;
+}
+
+static void usage(const char* prog)
+{
+    fprintf(stderr, "Usage: %s TRACE [--repeat N] [--out FILE]\n", prog);
+}
+
+int main(int argc, char** argv)
+{
+    const char* trace_path = NULL;
+    const char* out_path = NULL;
+    size_t repeat = 1;
+    FILE* out = stdout;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "--repeat") && i + 1 < argc)
+            repeat = strtoul(argv[++i], NULL, 10);
+        else if (!strcmp(argv[i], "--out") && i + 1 < argc)
+            out_path = argv[++i];
+        else if (argv[i][0] != '-' && !trace_path)
+            trace_path = argv[i];
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (!trace_path || repeat == 0)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    /* Load the whole trace so file I/O stays out of the timed loop */
+    FILE* fp = fopen(trace_path, "rb");
+    if (!fp)
+    {
+        perror(trace_path);
+        return 1;
+    }
+    trace_header header;
+    if (fread(&header, sizeof(header), 1, fp) != 1 ||
+        memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != TRACE_VERSION ||
+        header.record_size != sizeof(trace_record))
+    {
+        fprintf(stderr, "%s: not a version %d vector trace\n", trace_path,
+                TRACE_VERSION);
+        fclose(fp);
+        return 1;
+    }
+    size_t num_records = 0, cap = 0;
+    trace_record* records = NULL;
+    for (;;)
+    {
+        if (num_records == cap)
+        {
+            cap = cap ? cap * 2 : 4096;
+            records = realloc(records, cap * sizeof(trace_record));
+        }
+        size_t n = fread(records + num_records, sizeof(trace_record),
+                         cap - num_records, fp);
+        num_records += n;
+        if (n == 0)
+            break;
+    }
+    fclose(fp);
+
+    if (out_path && !(out = fopen(out_path, "w")))
+    {
+        perror(out_path);
+        return 1;
+    }
+    serialize_fp = tmpfile();
+    vector_set_error_callback(VECTOR_ERROR_SILENT);
+
+    uint64_t skipped = 0, unsupported = 0, replay_ns = 0;
+    for (size_t r = 0; r < repeat; ++r)
+    {
+        uint64_t t_start = now_ns();
+        for (size_t i = 0; i < num_records; ++i)
+        {
+            const trace_record* rec = &records[i];
+            vector* vec = lookup(rec->vector_id);
+            if (rec->op == 0 || rec->op >= TRACE_OP_COUNT ||
+                (!vec && rec->op != TRACE_CREATE))
+            {
+                skipped++;
+                continue;
+            }
+            uint64_t t0 = now_ns();
+            int ret = replay_one(rec, vec);
+            uint64_t ns = now_ns() - t0;
+            op_result* res = &results[rec->op];
+            res->count++;
+            if (ret == REPLAY_UNSUPPORTED)
+            {
+                res->unsupported++;
+                unsupported++;
+                continue;
+            }
+            res->failed += ret != 0;
+            record_latency(res, ns);
+        }
+        replay_ns += now_ns() - t_start;
+
+        /* Vectors the trace never freed */
+        for (size_t v = 0; v < num_vectors; ++v)
+        {
+            vector_free(vectors[v]);
+            vectors[v] = NULL;
+        }
+    }
+
+    fprintf(out, "{\n  \"library\": \"vector.h\",\n  \"trace\": \"%s\",\n"
+            "  \"records\": %zu,\n  \"repeat\": %zu,\n  \"skipped\": %llu,\n"
+            "  \"unsupported\": %llu,\n"
+            "  \"replay_ns\": %llu,\n  \"ns_per_record\": %.3f,\n  \"ops\": {",
+            trace_path, num_records, repeat, (unsigned long long)skipped,
+            (unsigned long long)unsupported,
+            (unsigned long long)replay_ns,
+            num_records ? (double)replay_ns / (double)(num_records * repeat) : 0.0);
+    int printed = 0;
+    for (int op = 1; op < TRACE_OP_COUNT; ++op)
+    {
+        const op_result* res = &results[op];
+        uint64_t timed = res->count - res->unsupported;
+        if (!res->count)
+            continue;
+        fprintf(out,
+                "%s\n    \"%s\": {\"count\": %llu, \"failed\": %llu, "
+                "\"unsupported\": %llu, \"total_ns\": %llu, \"mean_ns\": %.1f, "
+                "\"p50_ns\": %llu, \"p99_ns\": %llu, \"max_ns\": %llu}",
+                printed++ ? "," : "", op_names[op],
+                (unsigned long long)res->count, (unsigned long long)res->failed,
+                (unsigned long long)res->unsupported,
+                (unsigned long long)res->total_ns,
+                timed ? (double)res->total_ns / (double)timed : 0.0,
+                (unsigned long long)(timed ? percentile(res, 50.0) : 0),
+                (unsigned long long)(timed ? percentile(res, 99.0) : 0),
+                (unsigned long long)res->max_ns);
+    }
+    fprintf(out, "\n  }\n}\n");
+
+    if (out != stdout)
+        fclose(out);
+    fclose(serialize_fp);
+    free(records);
+    free(vectors);
+    free(scratch);
+    return 0;
+}
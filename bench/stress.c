@@ -0,0 +1,476 @@
+/*
+ * stress.c - Multithreaded stress and scaling harness for vector.h
+ * Copyright (C) 2025 Stefan Froberg <stefan.froberg@protonmail.com>
+ *
+ * Overview:
+ * Runs N threads against a set of shared vectors with a configurable mix of
+ * reads, writes, appends, pops and sorts, for each requested thread count.
+ * Reports throughput and latency percentiles per operation type and checks
+ * the thread-safety guarantees from the vector.h header comment:
+ *   - every element read or popped must be untorn (all 8-byte words equal),
+ *   - the final lengths must equal initial + successful appends - pops.
+ *
+ * Element access follows the safe pattern for shared vectors: the element is
+ * copied out while the lock is held (vector_rdlock + vector_at_ptr), since a
+ * pointer returned by vector_at may be invalidated by a concurrent append.
+ * These lock-held accesses record their own trace events for --trace.
+ *
+ * Output:
+ *   One JSON document on stdout (or --out FILE). Exit status is 1 if any
+ *   validation check failed.
+ *
+ * Usage:
+ *   ./stress [--threads 1,2,4,8] [--duration SEC] [--elem-size BYTES]
+ *            [--vectors N] [--initial N] [--mix read=70,write=10,append=10,pop=9,sort=1]
+ *            [--out FILE] [--trace FILE]
+ *
+ * --trace records every operation for bench/replay; it needs a build with
+ * -DVECTOR_TRACE (make stress CPPFLAGS="-I.. -DVECTOR_TRACE").
+ */
+#include "vector.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+
+/* Operation types */
+enum { OP_READ, OP_WRITE, OP_APPEND, OP_POP, OP_SORT, OP_COUNT };
+static const char* const op_names[OP_COUNT] = {
+    "read", "write", "append", "pop", "sort"
+};
+
+/* Harness configuration */
+typedef struct {
+    size_t threads[32];     /* Thread counts to run */
+    size_t num_threads;     /* Entries in threads */
+    double duration;        /* Seconds per thread count */
+    size_t elem_size;       /* Bytes per element, multiple of 8 */
+    size_t num_vectors;     /* Shared vectors */
+    size_t initial_length;  /* Elements per vector at start */
+    unsigned mix[OP_COUNT]; /* Relative operation weights */
+    FILE* out;              /* JSON destination */
+} stress_config;
+
+/* Per-thread results */
+typedef struct {
+    uint64_t ops[OP_COUNT];                     /* Completed operations */
+    uint64_t failed[OP_COUNT];                  /* Operations that returned an error */
+    vector_lock_histogram latency[OP_COUNT];    /* Per-op latency in ns */
+    uint64_t torn;                              /* Torn elements observed */
+    int64_t length_delta;                       /* Appends minus pops */
+} thread_result;
+
+typedef struct {
+    size_t id;
+    uint64_t seed;
+    vector** vectors;
+    thread_result result;
+    pthread_barrier_t* start;
+} thread_arg;
+
+static stress_config cfg;
+static volatile int stop_flag;
+
+/* Returns monotonic time in nanoseconds */
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* Small deterministic PRNG (xorshift64) */
+static uint64_t rng_next(uint64_t* state)
+{
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+/* Fills an element with one repeated 8-byte word */
+static void fill_element(void* elem, uint64_t word)
+{
+    for (size_t i = 0; i < cfg.elem_size; i += sizeof(uint64_t))
+        memcpy((char*)elem + i, &word, sizeof(uint64_t));
+}
+
+/* Returns 1 if the element is untorn (all words equal) */
+static int check_element(const void* elem)
+{
+    uint64_t first, word;
+    memcpy(&first, elem, sizeof(uint64_t));
+    for (size_t i = sizeof(uint64_t); i < cfg.elem_size; i += sizeof(uint64_t))
+    {
+        memcpy(&word, (const char*)elem + i, sizeof(uint64_t));
+        if (word != first)
+            return 0;
+    }
+    return 1;
+}
+
+/* Compares whole elements by their (untorn) first word */
+static int compare_word(const void* a, const void* b, void* context)
+{
+    (void)context;
+    uint64_t x, y;
+    memcpy(&x, a, sizeof(uint64_t));
+    memcpy(&y, b, sizeof(uint64_t));
+    return x < y ? -1 : x > y;
+}
+
+/* Picks an operation according to the configured mix */
+static int pick_op(uint64_t r)
+{
+    unsigned total = 0;
+    for (int op = 0; op < OP_COUNT; ++op)
+        total += cfg.mix[op];
+    unsigned x = (unsigned)(r % total);
+    for (int op = 0; op < OP_COUNT; ++op)
+    {
+        if (x < cfg.mix[op])
+            return op;
+        x -= cfg.mix[op];
+    }
+    return OP_READ;
+}
+
+/* Executes one operation; returns 0 on success, -1 on a reported failure */
+static int run_op(int op, vector* vec, uint64_t* state, unsigned char* buf,
+                  thread_result* res)
+{
+    switch (op)
+    {
+    case OP_READ:
+    {
+        int ok = -1;
+        vector_rdlock(vec);
+        size_t len = vec->length;
+        if (len)
+        {
+            size_t index = rng_next(state) % len;
+            memcpy(buf, vector_at_ptr(unsigned char, vec, index), cfg.elem_size);
+            _VECTOR_TRACE(VECTOR_TRACE_AT, vec, index, 1);
+            ok = 0;
+        }
+        vector_unlock(vec);
+        if (ok == 0 && !check_element(buf))
+            res->torn++;
+        return ok;
+    }
+    case OP_WRITE:
+    {
+        int ok = -1;
+        fill_element(buf, rng_next(state));
+        vector_wrlock(vec);
+        size_t len = vec->length;
+        if (len)
+        {
+            size_t index = rng_next(state) % len;
+            memcpy(vector_at_ptr(unsigned char, vec, index), buf, cfg.elem_size);
+            _VECTOR_TRACE(VECTOR_TRACE_SET, vec, index, 1);
+            ok = 0;
+        }
+        vector_unlock(vec);
+        return ok;
+    }
+    case OP_APPEND:
+    {
+        fill_element(buf, rng_next(state));
+        vector_wrlock(vec);
+        int ret = _vector_append_internal(vec, 1, buf);
+        if (ret == 0)
+            _VECTOR_TRACE(VECTOR_TRACE_APPEND, vec, 0, 1);
+        vector_unlock(vec);
+        if (ret == 0)
+            res->length_delta++;
+        return ret;
+    }
+    case OP_POP:
+    {
+        unsigned char* popped = vector_pop(unsigned char, vec);
+        if (!popped)
+            return -1;
+        if (!check_element(popped))
+            res->torn++;
+        free(popped);
+        res->length_delta--;
+        return 0;
+    }
+    case OP_SORT:
+        vector_sort(vec, unsigned char, compare_word);
+        return 0;
+    }
+    return -1;
+}
+
+static void* worker(void* p)
+{
+    thread_arg* arg = (thread_arg*)p;
+    thread_result* res = &arg->result;
+    uint64_t state = arg->seed;
+    unsigned char* buf = malloc(cfg.elem_size);
+    pthread_barrier_wait(arg->start);
+    while (!__atomic_load_n(&stop_flag, __ATOMIC_RELAXED))
+    {
+        int op = pick_op(rng_next(&state));
+        vector* vec = arg->vectors[rng_next(&state) % cfg.num_vectors];
+        uint64_t t0 = now_ns();
+        int ret = run_op(op, vec, &state, buf, res);
+        uint64_t ns = now_ns() - t0;
+        vector_lock_histogram* hist = &res->latency[op];
+        hist->count++;
+        hist->total_ns += ns;
+        hist->buckets[_vector_lock_hist_index(ns)]++;
+        if (ns > hist->max_ns)
+            hist->max_ns = ns;
+        res->ops[op]++;
+        if (ret != 0)
+            res->failed[op]++;
+    }
+    free(buf);
+    return NULL;
+}
+
+/* Merges src latency histogram into dst */
+static void merge_hist(vector_lock_histogram* dst, const vector_lock_histogram* src)
+{
+    dst->count += src->count;
+    dst->total_ns += src->total_ns;
+    if (src->max_ns > dst->max_ns)
+        dst->max_ns = src->max_ns;
+    for (size_t i = 0; i < VECTOR_LOCK_HIST_BUCKETS; ++i)
+        dst->buckets[i] += src->buckets[i];
+}
+
+/* Runs one thread count and prints its JSON record; returns 0 if valid */
+static int run_threads(size_t threads, int first)
+{
+    vector** vectors = malloc(cfg.num_vectors * sizeof(vector*));
+    uint64_t seed = 12345;
+    for (size_t v = 0; v < cfg.num_vectors; ++v)
+    {
+        vectors[v] = _vector_create_base(cfg.elem_size, cfg.initial_length);
+        for (size_t i = 0; i < cfg.initial_length; ++i)
+            fill_element(vector_at_ptr(unsigned char, vectors[v], i),
+                         rng_next(&seed));
+    }
+
+    thread_arg* args = calloc(threads, sizeof(thread_arg));
+    pthread_t* tids = malloc(threads * sizeof(pthread_t));
+    pthread_barrier_t start;
+    pthread_barrier_init(&start, NULL, (unsigned)threads + 1);
+    stop_flag = 0;
+    for (size_t t = 0; t < threads; ++t)
+    {
+        args[t].id = t;
+        args[t].seed = 0x9E3779B97F4A7C15ull * (t + 1);
+        args[t].vectors = vectors;
+        args[t].start = &start;
+        pthread_create(&tids[t], NULL, worker, &args[t]);
+    }
+    pthread_barrier_wait(&start);
+    uint64_t t0 = now_ns();
+    struct timespec sleep_for = {(time_t)cfg.duration,
+                                 (long)((cfg.duration - (double)(time_t)cfg.duration) * 1e9)};
+    nanosleep(&sleep_for, NULL);
+    __atomic_store_n(&stop_flag, 1, __ATOMIC_RELAXED);
+    for (size_t t = 0; t < threads; ++t)
+        pthread_join(tids[t], NULL);
+    double seconds = (double)(now_ns() - t0) / 1e9;
+    pthread_barrier_destroy(&start);
+
+    /* Aggregate and validate */
+    static thread_result total;
+    memset(&total, 0, sizeof(total));
+    for (size_t t = 0; t < threads; ++t)
+    {
+        for (int op = 0; op < OP_COUNT; ++op)
+        {
+            total.ops[op] += args[t].result.ops[op];
+            total.failed[op] += args[t].result.failed[op];
+            merge_hist(&total.latency[op], &args[t].result.latency[op]);
+        }
+        total.torn += args[t].result.torn;
+        total.length_delta += args[t].result.length_delta;
+    }
+    int64_t expected = (int64_t)(cfg.num_vectors * cfg.initial_length) +
+                       total.length_delta;
+    int64_t actual = 0;
+    for (size_t v = 0; v < cfg.num_vectors; ++v)
+    {
+        actual += (int64_t)vector_length(vectors[v]);
+        for (size_t i = 0; i < vector_length(vectors[v]); ++i)
+            if (!check_element(vector_at_ptr(unsigned char, vectors[v], i)))
+                total.torn++;
+        vector_free(vectors[v]);
+    }
+    int valid = total.torn == 0 && actual == expected;
+
+    uint64_t all_ops = 0;
+    for (int op = 0; op < OP_COUNT; ++op)
+        all_ops += total.ops[op];
+    fprintf(cfg.out,
+            "%s    {\"threads\": %zu, \"seconds\": %.3f, \"ops_per_sec\": %.0f, "
+            "\"valid\": %s, \"torn_elements\": %llu, \"final_length\": %lld, "
+            "\"expected_length\": %lld,\n     \"ops\": {",
+            first ? "" : ",\n", threads, seconds, (double)all_ops / seconds,
+            valid ? "true" : "false", (unsigned long long)total.torn,
+            (long long)actual, (long long)expected);
+    int printed = 0;
+    for (int op = 0; op < OP_COUNT; ++op)
+    {
+        const vector_lock_histogram* h = &total.latency[op];
+        if (!cfg.mix[op])
+            continue;
+        fprintf(cfg.out,
+                "%s\n       \"%s\": {\"count\": %llu, \"failed\": %llu, "
+                "\"ops_per_sec\": %.0f, \"mean_ns\": %.1f, \"p50_ns\": %llu, "
+                "\"p90_ns\": %llu, \"p99_ns\": %llu, \"p999_ns\": %llu, "
+                "\"max_ns\": %llu}",
+                printed++ ? "," : "", op_names[op],
+                (unsigned long long)total.ops[op],
+                (unsigned long long)total.failed[op],
+                (double)total.ops[op] / seconds,
+                h->count ? (double)h->total_ns / (double)h->count : 0.0,
+                (unsigned long long)vector_lock_histogram_percentile(h, 50.0),
+                (unsigned long long)vector_lock_histogram_percentile(h, 90.0),
+                (unsigned long long)vector_lock_histogram_percentile(h, 99.0),
+                (unsigned long long)vector_lock_histogram_percentile(h, 99.9),
+                (unsigned long long)h->max_ns);
+    }
+    fprintf(cfg.out, "}}");
+    fflush(cfg.out);
+
+    free(tids);
+    free(args);
+    free(vectors);
+    return valid ? 0 : -1;
+}
+
+/* Parses "1,2,4,8" into cfg.threads */
+static int parse_threads(const char* s)
+{
+    cfg.num_threads = 0;
+    while (*s && cfg.num_threads < sizeof(cfg.threads) / sizeof(cfg.threads[0]))
+    {
+        char* end;
+        size_t n = strtoul(s, &end, 10);
+        if (end == s || n == 0)
+            return -1;
+        cfg.threads[cfg.num_threads++] = n;
+        s = *end == ',' ? end + 1 : end;
+    }
+    return cfg.num_threads ? 0 : -1;
+}
+
+/* Parses "read=70,write=10,..." into cfg.mix; unnamed ops get weight 0 */
+static int parse_mix(const char* s)
+{
+    memset(cfg.mix, 0, sizeof(cfg.mix));
+    while (*s)
+    {
+        int op;
+        for (op = 0; op < OP_COUNT; ++op)
+        {
+            size_t len = strlen(op_names[op]);
+            if (!strncmp(s, op_names[op], len) && s[len] == '=')
+            {
+                s += len + 1;
+                break;
+            }
+        }
+        if (op == OP_COUNT)
+            return -1;
+        char* end;
+        cfg.mix[op] = (unsigned)strtoul(s, &end, 10);
+        s = *end == ',' ? end + 1 : end;
+    }
+    unsigned total = 0;
+    for (int op = 0; op < OP_COUNT; ++op)
+        total += cfg.mix[op];
+    return total ? 0 : -1;
+}
+
+static void usage(const char* prog)
+{
+    fprintf(stderr,
+            "Usage: %s [--threads 1,2,4,8] [--duration SEC] [--elem-size BYTES]\n"
+            "          [--vectors N] [--initial N] [--out FILE] [--trace FILE]\n"
+            "          [--mix read=70,write=10,append=10,pop=9,sort=1]\n", prog);
+}
+
+int main(int argc, char** argv)
+{
+    cfg = (stress_config){{1, 2, 4, 8}, 4, 1.0, 16, 4, 4096,
+                          {70, 10, 10, 9, 1}, stdout};
+    const char* out_path = NULL;
+    const char* trace_path = NULL;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        int ok = 1;
+        if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+            ok = parse_threads(argv[++i]) == 0;
+        else if (!strcmp(argv[i], "--duration") && i + 1 < argc)
+            ok = (cfg.duration = strtod(argv[++i], NULL)) > 0;
+        else if (!strcmp(argv[i], "--elem-size") && i + 1 < argc)
+            ok = (cfg.elem_size = strtoul(argv[++i], NULL, 10)) > 0;
+        else if (!strcmp(argv[i], "--vectors") && i + 1 < argc)
+            ok = (cfg.num_vectors = strtoul(argv[++i], NULL, 10)) > 0;
+        else if (!strcmp(argv[i], "--initial") && i + 1 < argc)
+            cfg.initial_length = strtoul(argv[++i], NULL, 10);
+        else if (!strcmp(argv[i], "--mix") && i + 1 < argc)
+            ok = parse_mix(argv[++i]) == 0;
+        else if (!strcmp(argv[i], "--out") && i + 1 < argc)
+            out_path = argv[++i];
+        else if (!strcmp(argv[i], "--trace") && i + 1 < argc)
+            trace_path = argv[++i];
+        else
+            ok = 0;
+        if (!ok)
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    /* Elements are checked as whole 8-byte words */
+    cfg.elem_size = (cfg.elem_size + 7) & ~(size_t)7;
+    if (out_path && !(cfg.out = fopen(out_path, "w")))
+    {
+        perror(out_path);
+        return 1;
+    }
+
+    if (trace_path && vector_trace_start(trace_path) != 0)
+    {
+        fprintf(stderr, "%s: cannot record trace (built without VECTOR_TRACE?)\n",
+                trace_path);
+        return 1;
+    }
+    /* Pops on empty vectors are expected; count them without printing */
+    vector_set_error_callback(VECTOR_ERROR_SILENT);
+
+    fprintf(cfg.out, "{\n  \"library\": \"vector.h\",\n  \"duration\": %.3f,\n"
+            "  \"elem_size\": %zu,\n  \"vectors\": %zu,\n  \"initial_length\": %zu,\n"
+            "  \"mix\": {", cfg.duration, cfg.elem_size, cfg.num_vectors,
+            cfg.initial_length);
+    for (int op = 0; op < OP_COUNT; ++op)
+        fprintf(cfg.out, "%s\"%s\": %u", op ? ", " : "", op_names[op], cfg.mix[op]);
+    fprintf(cfg.out, "},\n  \"runs\": [\n");
+    int status = 0;
+    for (size_t i = 0; i < cfg.num_threads; ++i)
+        if (run_threads(cfg.threads[i], i == 0) != 0)
+            status = 1;
+    fprintf(cfg.out, "\n  ]\n}\n");
+    if (trace_path && vector_trace_stop() != 0)
+        status = 1;
+
+    if (cfg.out != stdout)
+        fclose(cfg.out);
+    return status;
+}
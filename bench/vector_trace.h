@@ -0,0 +1,70 @@
+/*
+ * vector_trace.h - On-disk format of a VECTOR_TRACE operation trace
+ * Copyright (C) 2025 Stefan Froberg <stefan.froberg@protonmail.com>
+ *
+ * Overview:
+ * Describes the file vector_trace_start writes, independently of vector.h, so
+ * that tools reading a trace (bench/replay) build against any vector.h,
+ * including trees that predate the recorder or were built without it.
+ *
+ * Layout: one trace_header, then fixed-size trace_records in the order the
+ * operations took effect. Element sizes appear only in CREATE records; later
+ * records refer to the vector by its trace id. Values are host-endian.
+ *
+ * The numbering and layout must stay in step with the vector_trace_op enum
+ * and the vector_trace_header/vector_trace_record structs in vector.h; bump
+ * TRACE_VERSION in both when either changes.
+ */
+#ifndef __VECTOR_TRACE_H__
+#define __VECTOR_TRACE_H__
+
+#include <stdint.h>
+
+#define TRACE_MAGIC "VECTRACE"
+#define TRACE_VERSION 1
+
+/* Operation codes in a trace */
+typedef enum {
+    TRACE_CREATE = 1,  /* index: element_size, count: initial length */
+    TRACE_FREE,
+    TRACE_APPEND,      /* count: values appended */
+    TRACE_INSERT,      /* index: position, count: values inserted */
+    TRACE_PREPEND,     /* count: values prepended */
+    TRACE_REMOVE,      /* index: position, count: elements removed */
+    TRACE_POP,
+    TRACE_AT,          /* index: element read */
+    TRACE_SET,         /* index: element written */
+    TRACE_FIND,        /* index: match or SIZE_MAX */
+    TRACE_SORT,        /* count: length sorted */
+    TRACE_CLEAR,
+    TRACE_COPY,        /* index: trace id of the new vector */
+    TRACE_RESERVE,     /* count: requested capacity */
+    TRACE_RESIZE,      /* count: new length */
+    TRACE_SHRINK,
+    TRACE_SWAP,        /* index: first element, count: second element */
+    TRACE_SERIALIZE,   /* count: length written */
+    TRACE_DESERIALIZE, /* count: length read (follows its CREATE) */
+    TRACE_RELEASE,     /* count: length handed to the caller */
+    TRACE_SWAP_CONTENTS, /* index: trace id of the other vector */
+    TRACE_MOVE,        /* index: trace id of the source vector */
+    TRACE_FILL,        /* count: elements overwritten */
+    TRACE_ASSIGN,      /* count: new length */
+    TRACE_OP_COUNT
+} trace_op;
+
+typedef struct {
+    char magic[8];        /* TRACE_MAGIC, not NUL-terminated */
+    uint32_t version;     /* TRACE_VERSION */
+    uint32_t record_size; /* sizeof(trace_record) */
+} trace_header;
+
+typedef struct {
+    uint64_t timestamp_ns; /* Nanoseconds since vector_trace_start */
+    uint64_t index;        /* Op-specific, see trace_op */
+    uint64_t count;        /* Op-specific, see trace_op */
+    uint32_t vector_id;    /* Trace id, assigned at creation */
+    uint16_t op;           /* trace_op */
+    uint16_t thread_id;    /* Small per-thread number, from 1 */
+} trace_record;
+
+#endif /* __VECTOR_TRACE_H__ */
@@ -0,0 +1,26 @@
+#include "vector.hpp"
+#include <algorithm>
+#include <cstdio>
+
+int main() {
+    // Create a vector of integers
+    vec::vector<int> v{3, 1, 2};
+
+    // Append elements
+    v.push_back(4);
+
+    // Sort with an inlined comparator and search the sorted range
+    std::sort(v.begin(), v.end(), [](int a, int b) { return a < b; });
+    auto it = std::lower_bound(v.begin(), v.end(), 3);
+
+    // Access and print elements
+    for (int x : v) {
+        std::printf("%d ", x);
+    }
+    std::printf("(3 at index %td)\n", it - v.begin()); // Output: 1 2 3 4 (3 at index 2)
+
+    // Moving hands over the buffer without copying
+    vec::vector<int> w = std::move(v);
+    std::printf("%zu %zu\n", v.size(), w.size()); // Output: 0 4
+    return 0;
+}
@@ -0,0 +1,39 @@
+/*
+ * test.h - Shared checks for the vector.h tests
+ * Copyright (C) 2025 Stefan Froberg <stefan.froberg@protonmail.com>
+ *
+ * Overview:
+ * Each test is a standalone program built by "make test". CHECK reports the
+ * first failed condition with its location and exits non-zero, so make stops
+ * at the failing test.
+ */
+#ifndef __VECTOR_TEST_H__
+#define __VECTOR_TEST_H__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Fails the test unless cond holds; the message is printf-style */
+#define CHECK(cond, ...) \
+    do { \
+        if (!(cond)) \
+        { \
+            fprintf(stderr, "%s:%d: check failed: %s: ", __FILE__, __LINE__, #cond); \
+            fprintf(stderr, __VA_ARGS__); \
+            fputc('\n', stderr); \
+            exit(1); \
+        } \
+    } while (0)
+
+/* Small deterministic generator for test inputs (xorshift64) */
+static uint64_t test_rng_state = 0x9E3779B97F4A7C15ull;
+static uint64_t test_rand(void)
+{
+    test_rng_state ^= test_rng_state << 13;
+    test_rng_state ^= test_rng_state >> 7;
+    test_rng_state ^= test_rng_state << 17;
+    return test_rng_state;
+}
+
+#endif /* __VECTOR_TEST_H__ */
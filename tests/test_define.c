@@ -0,0 +1,199 @@
+/*
+ * test_define.c - VECTOR_DEFINE typed API and its introsort
+ * Copyright (C) 2025 Stefan Froberg <stefan.froberg@protonmail.com>
+ *
+ * name_sort is checked against qsort on sorted, reversed, duplicate-heavy,
+ * organ-pipe and random input at lengths around the insertion sort cutoff,
+ * and on an adversarial input (McIlroy's "killer adversary") that drives the
+ * median-of-three quicksort quadratic, so the heapsort fallback must keep
+ * the comparison count at O(n log n). A 24-byte struct type checks that
+ * sorting moves whole elements.
+ */
+#include "vector.h"
+#include "test.h"
+#include <string.h>
+
+typedef struct {
+    int64_t key;
+    int64_t seq;   /* Input position, to check elements move intact */
+    int64_t check; /* key ^ seq */
+} record;
+
+VECTOR_DEFINE(ivec, int)
+VECTOR_DEFINE(rvec, record)
+
+static size_t comparisons;
+
+/* Returns floor(log2(n)) for n > 0 */
+static size_t log2_floor(size_t n)
+{
+    size_t bits = 0;
+    while (n >>= 1)
+        bits++;
+    return bits;
+}
+
+static int int_cmp(const int* a, const int* b)
+{
+    comparisons++;
+    return (*a > *b) - (*a < *b);
+}
+
+static int int_qsort_cmp(const void* a, const void* b)
+{
+    return int_cmp((const int*)a, (const int*)b);
+}
+
+static int record_cmp(const record* a, const record* b)
+{
+    return (a->key > b->key) - (a->key < b->key);
+}
+
+/* Input patterns, filling a[0..n) */
+enum { SORTED, REVERSED, EQUAL, FEW_KEYS, ORGAN_PIPE, SAWTOOTH, RANDOM, PATTERNS };
+static const char* const pattern_names[PATTERNS] = {
+    "sorted", "reversed", "equal", "few keys", "organ pipe", "sawtooth", "random"
+};
+
+static int pattern_value(int pattern, size_t i, size_t n)
+{
+    switch (pattern)
+    {
+    case SORTED: return (int)i;
+    case REVERSED: return (int)(n - i);
+    case EQUAL: return 7;
+    case FEW_KEYS: return (int)(test_rand() % 4);
+    case ORGAN_PIPE: return (int)(i < n / 2 ? i : n - i);
+    case SAWTOOTH: return (int)(i % 17);
+    default: return (int)(test_rand() % (n + 1)) - (int)(n / 2);
+    }
+}
+
+/* McIlroy's adversary: elements are indices whose values are decided only */
+/* when a comparison needs them, always in the way that makes the pivot bad */
+static int* adversary_val;
+static int adversary_gas, adversary_solid, adversary_candidate;
+
+static int adversary_cmp(const int* x, const int* y)
+{
+    comparisons++;
+    if (adversary_val[*x] == adversary_gas && adversary_val[*y] == adversary_gas)
+        adversary_val[*x == adversary_candidate ? *x : *y] = adversary_solid++;
+    if (adversary_val[*x] == adversary_gas)
+        adversary_candidate = *x;
+    else if (adversary_val[*y] == adversary_gas)
+        adversary_candidate = *y;
+    return (adversary_val[*x] > adversary_val[*y]) -
+           (adversary_val[*x] < adversary_val[*y]);
+}
+
+static void test_patterns(void)
+{
+    static const size_t lengths[] = {0, 1, 2, 3, 15, 16, 17, 18, 33, 100, 1000, 10000};
+    for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); ++l)
+    {
+        size_t n = lengths[l];
+        for (int p = 0; p < PATTERNS; ++p)
+        {
+            vector* v = vector_create(int, 0);
+            int* want = malloc((n ? n : 1) * sizeof(int));
+            for (size_t i = 0; i < n; ++i)
+            {
+                want[i] = pattern_value(p, i, n);
+                CHECK(ivec_append(v, want[i]) == 0, "append");
+            }
+            qsort(want, n, sizeof(int), int_qsort_cmp);
+            comparisons = 0;
+            CHECK(ivec_sort(v, int_cmp) == 0, "sort");
+            CHECK(vector_length(v) == n, "%s n=%zu length", pattern_names[p], n);
+            for (size_t i = 0; i < n; ++i)
+                CHECK(*ivec_at(v, i) == want[i], "%s n=%zu index %zu: %d, want %d",
+                      pattern_names[p], n, i, *ivec_at(v, i), want[i]);
+            if (n > 1)
+                CHECK(comparisons <= 4 * n * log2_floor(n) + 4 * n,
+                      "%s n=%zu: %zu comparisons", pattern_names[p], n, comparisons);
+            free(want);
+            vector_free(v);
+        }
+    }
+}
+
+static void test_adversary(void)
+{
+    size_t n = 20000;
+    vector* v = vector_create(int, n);
+    adversary_val = malloc(n * sizeof(int));
+    adversary_gas = (int)n;
+    adversary_solid = 0;
+    adversary_candidate = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        *ivec_at(v, i) = (int)i;
+        adversary_val[i] = adversary_gas;
+    }
+    comparisons = 0;
+    ivec_sort(v, adversary_cmp);
+    size_t limit = 8 * n * log2_floor(n);
+    CHECK(comparisons <= limit, "adversary: %zu comparisons, limit %zu", comparisons,
+          limit);
+
+    /* The values the adversary settled on, sorted with a plain comparator */
+    for (size_t i = 0; i < n; ++i)
+        *ivec_at(v, i) = adversary_val[i];
+    comparisons = 0;
+    ivec_sort(v, int_cmp);
+    CHECK(comparisons <= limit, "adversary input: %zu comparisons", comparisons);
+    for (size_t i = 1; i < n; ++i)
+        CHECK(*ivec_at(v, i - 1) <= *ivec_at(v, i), "adversary input index %zu", i);
+    free(adversary_val);
+    vector_free(v);
+}
+
+static void test_records(void)
+{
+    size_t n = 5000;
+    vector* v = vector_create(record, 0);
+    for (size_t i = 0; i < n; ++i)
+    {
+        record r = {(int64_t)(test_rand() % 50), (int64_t)i, 0};
+        r.check = r.key ^ r.seq;
+        CHECK(rvec_append(v, r) == 0, "append");
+    }
+    CHECK(rvec_sort(v, record_cmp) == 0, "sort");
+    unsigned char* seen = calloc(n, 1);
+    for (size_t i = 0; i < n; ++i)
+    {
+        const record* r = rvec_at(v, i);
+        CHECK(r->check == (r->key ^ r->seq), "record %zu torn", i);
+        CHECK(r->seq >= 0 && (size_t)r->seq < n && !seen[r->seq], "record %zu repeated", i);
+        seen[r->seq] = 1;
+        if (i)
+            CHECK(rvec_at(v, i - 1)->key <= r->key, "records out of order at %zu", i);
+    }
+    free(seen);
+    vector_free(v);
+}
+
+static void test_accessors(void)
+{
+    vector* v = vector_create(int, 0);
+    for (int i = 0; i < 100; ++i)
+        CHECK(ivec_append(v, i * 3) == 0, "append");
+    CHECK(*ivec_at(v, 10) == 30, "at");
+    CHECK(ivec_set(v, 10, -1) == 0 && *ivec_at(v, 10) == -1, "set");
+    CHECK(ivec_find(v, 297) == 99, "find last");
+    CHECK(ivec_find(v, 1) == -1, "find missing");
+    vector_set_error_callback(VECTOR_ERROR_SILENT);
+    CHECK(ivec_at(v, 100) == NULL, "at out of range");
+    CHECK(ivec_set(v, 100, 0) == -1, "set out of range");
+    vector_free(v);
+}
+
+int main(void)
+{
+    test_accessors();
+    test_patterns();
+    test_adversary();
+    test_records();
+    return 0;
+}
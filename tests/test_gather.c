@@ -0,0 +1,152 @@
+/*
+ * test_gather.c - vector_gather and vector_scatter against plain loops
+ * Copyright (C) 2025 Stefan Froberg <stefan.froberg@protonmail.com>
+ *
+ * Covers the element sizes with SIMD paths (4 and 8 bytes) and without, both
+ * index widths, random indices with repeats, an out-of-bounds index at the
+ * start, middle and end of the index vector (nothing may be written), and
+ * scatter with repeated indices, where the last store must win.
+ */
+#include "vector.h"
+#include "test.h"
+#include <string.h>
+
+typedef struct { unsigned char b[24]; } bytes24;
+
+/* Gathers n random (often repeated) indices from m elements and scatters */
+/* them back, comparing both with element-by-element copies */
+#define TEST_ROUND_TRIP(type, index_type) \
+    do { \
+        for (size_t n = 0; n < 5000; n = n * 2 + 3) \
+        { \
+            size_t m = n / 2 + 1; \
+            vector* src = vector_create(type, m); \
+            for (size_t i = 0; i < m; ++i) \
+                memset(vector_at(type, src, i), (int)(i * 31 + 7), sizeof(type)); \
+            vector* indices = vector_create(index_type, n); \
+            for (size_t i = 0; i < n; ++i) \
+                *vector_at(index_type, indices, i) = (index_type)(test_rand() % m); \
+            vector* dst = vector_create(type, 1); \
+            CHECK(vector_gather(dst, src, indices) == 0, #type "/" #index_type " n=%zu", n); \
+            CHECK(vector_length(dst) == n, #type "/" #index_type " n=%zu length %zu", \
+                  n, vector_length(dst)); \
+            for (size_t i = 0; i < n; ++i) \
+                CHECK(!memcmp(vector_at(type, dst, i), \
+                              vector_at(type, src, *vector_at(index_type, indices, i)), \
+                              sizeof(type)), \
+                      #type "/" #index_type " gather n=%zu index %zu", n, i); \
+            vector* out = vector_create(type, m); \
+            vector* want = vector_create(type, m); \
+            for (size_t i = 0; i < n; ++i) \
+                memset(vector_at(type, dst, i), (int)i, sizeof(type)); \
+            CHECK(vector_scatter(out, indices, dst) == 0, #type "/" #index_type " n=%zu", n); \
+            for (size_t i = 0; i < n; ++i) \
+                memcpy(vector_at(type, want, *vector_at(index_type, indices, i)), \
+                       vector_at(type, dst, i), sizeof(type)); \
+            CHECK(!memcmp(vector_data(type, out), vector_data(type, want), \
+                          m * sizeof(type)), \
+                  #type "/" #index_type " scatter n=%zu", n); \
+            vector_free(src); \
+            vector_free(indices); \
+            vector_free(dst); \
+            vector_free(out); \
+            vector_free(want); \
+        } \
+    } while (0)
+
+/* An out-of-bounds index anywhere in the index vector fails both calls */
+/* without writing to the destination */
+#define TEST_OUT_OF_BOUNDS(type) \
+    do { \
+        size_t n = 100, m = 10; \
+        size_t bad_at[] = {0, n / 2, n - 1}; \
+        vector* src = vector_create(type, m); \
+        for (size_t i = 0; i < m; ++i) \
+            *vector_at(type, src, i) = (type)(i + 1); \
+        for (size_t b = 0; b < 3; ++b) \
+        { \
+            vector* indices = vector_create(uint32_t, n); \
+            for (size_t i = 0; i < n; ++i) \
+                *vector_at(uint32_t, indices, i) = (uint32_t)(i % m); \
+            *vector_at(uint32_t, indices, bad_at[b]) = (uint32_t)m; \
+            vector* dst = vector_create(type, 3, (type)-1, (type)-1, (type)-1); \
+            CHECK(vector_gather(dst, src, indices) == -1, #type " bad index at %zu", \
+                  bad_at[b]); \
+            CHECK(vector_last_error() == VECTOR_ERR_BOUNDS, #type " error %d", \
+                  (int)vector_last_error()); \
+            CHECK(vector_length(dst) == 3 && *vector_at(type, dst, 0) == (type)-1, \
+                  #type " gather wrote with a bad index at %zu", bad_at[b]); \
+            vector* values = vector_create(type, n); \
+            vector* out = vector_create(type, m); \
+            for (size_t i = 0; i < n; ++i) \
+                *vector_at(type, values, i) = (type)7; \
+            CHECK(vector_scatter(out, indices, values) == -1, #type " bad index at %zu", \
+                  bad_at[b]); \
+            CHECK(vector_last_error() == VECTOR_ERR_BOUNDS, #type " error %d", \
+                  (int)vector_last_error()); \
+            for (size_t i = 0; i < m; ++i) \
+                CHECK(*vector_at(type, out, i) == (type)0, \
+                      #type " scatter wrote with a bad index at %zu", bad_at[b]); \
+            vector_free(indices); \
+            vector_free(dst); \
+            vector_free(values); \
+            vector_free(out); \
+        } \
+        vector_free(src); \
+    } while (0)
+
+/* Every element scattered to the same few slots: the last store wins */
+#define TEST_REPEATED_SCATTER(type, index_type) \
+    do { \
+        size_t n = 1000, m = 4; \
+        vector* indices = vector_create(index_type, n); \
+        vector* values = vector_create(type, n); \
+        for (size_t i = 0; i < n; ++i) \
+        { \
+            *vector_at(index_type, indices, i) = (index_type)(i % m); \
+            *vector_at(type, values, i) = (type)(i + 1); \
+        } \
+        vector* out = vector_create(type, m); \
+        CHECK(vector_scatter(out, indices, values) == 0, #type "/" #index_type); \
+        for (size_t i = 0; i < m; ++i) \
+            CHECK(*vector_at(type, out, i) == (type)(n - m + i + 1), \
+                  #type "/" #index_type " slot %zu", i); \
+        vector_free(indices); \
+        vector_free(values); \
+        vector_free(out); \
+    } while (0)
+
+int main(void)
+{
+    TEST_ROUND_TRIP(int32_t, uint32_t);
+    TEST_ROUND_TRIP(int32_t, uint64_t);
+    TEST_ROUND_TRIP(double, uint32_t);
+    TEST_ROUND_TRIP(double, uint64_t);
+    TEST_ROUND_TRIP(char, uint32_t);
+    TEST_ROUND_TRIP(int16_t, uint64_t);
+    TEST_ROUND_TRIP(bytes24, uint32_t);
+
+    vector_set_error_callback(VECTOR_ERROR_SILENT);
+    TEST_OUT_OF_BOUNDS(int32_t);
+    TEST_OUT_OF_BOUNDS(int64_t);
+    TEST_OUT_OF_BOUNDS(int16_t);
+
+    TEST_REPEATED_SCATTER(int32_t, uint32_t);
+    TEST_REPEATED_SCATTER(int64_t, uint64_t);
+    TEST_REPEATED_SCATTER(int16_t, uint32_t);
+
+    /* Mismatched sizes and aliasing are rejected */
+    vector* ints = vector_create(int, 4);
+    vector* indices = vector_create(uint32_t, 2, 1, 3);
+    vector* shorts = vector_create(int16_t, 2);
+    CHECK(vector_gather(ints, ints, indices) == -1, "dst aliases src");
+    CHECK(vector_gather(ints, ints, shorts) == -1, "2-byte indices");
+    CHECK(vector_scatter(ints, indices, shorts) == -1, "element size mismatch");
+    vector* three = vector_create(int, 3);
+    CHECK(vector_scatter(ints, indices, three) == -1, "length mismatch");
+    vector_free(ints);
+    vector_free(indices);
+    vector_free(shorts);
+    vector_free(three);
+    return 0;
+}
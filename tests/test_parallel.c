@@ -0,0 +1,181 @@
+/*
+ * test_parallel.c - vector_parallel_for and vector_parallel_transform
+ * Copyright (C) 2025 Stefan Froberg <stefan.froberg@protonmail.com>
+ *
+ * Built with VECTOR_PARALLEL_THREADS=4 by make test. Checks that every
+ * element is handed to exactly one call with the right index, that ranges
+ * after the first start on a cache line of the buffer, that transforms
+ * between element sizes and in place write every element, and that a
+ * parallel call from inside fn completes on the calling thread.
+ */
+#include "vector.h"
+#include "test.h"
+#include <string.h>
+
+static size_t unaligned_ranges;
+static size_t elements_seen;
+
+/* Returns a vector of n zeroed elements of element_size bytes; the first */
+/* four bytes of element i hold i */
+static vector* make_indexed(size_t element_size, size_t n)
+{
+    void* data = n ? calloc(n, element_size) : NULL;
+    for (size_t i = 0; i < n; ++i)
+    {
+        int32_t index = (int32_t)i;
+        memcpy((char*)data + i * element_size, &index, sizeof(index));
+    }
+    vector* vec = vector_from_buffer(data, n, n, element_size, NULL);
+    CHECK(vec, "vector_from_buffer");
+    return vec;
+}
+
+/* Replaces each index with its complement, so a second visit is caught */
+static void visit(void* chunk, size_t count, size_t first, void* ctx)
+{
+    size_t element_size = *(const size_t*)ctx;
+    char* p = (char*)chunk;
+    if (first && (uintptr_t)chunk % VECTOR_CACHE_LINE)
+        __atomic_fetch_add(&unaligned_ranges, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&elements_seen, count, __ATOMIC_RELAXED);
+    for (size_t i = 0; i < count; ++i)
+    {
+        int32_t index;
+        memcpy(&index, p + i * element_size, sizeof(index));
+        CHECK(index == (int32_t)(first + i), "element %zu holds %d", first + i,
+              (int)index);
+        index = ~index;
+        memcpy(p + i * element_size, &index, sizeof(index));
+    }
+}
+
+/* Runs visit over lengths around the grain with several grains; element */
+/* sizes 4, 8 and 12 can always start ranges on a cache line */
+static void test_for(size_t element_size)
+{
+    size_t grain = VECTOR_PARALLEL_GRAIN_BYTES / element_size;
+    size_t lengths[] = {0, 1, 100, grain - 1, grain, grain + 1, 3 * grain + 7,
+                        10 * grain};
+    size_t grains[] = {0, 1, 1000};
+    for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); ++l)
+    {
+        for (size_t g = 0; g < sizeof(grains) / sizeof(grains[0]); ++g)
+        {
+            size_t n = lengths[l];
+            vector* v = make_indexed(element_size, n);
+            elements_seen = 0;
+            unaligned_ranges = 0;
+            CHECK(vector_parallel_for(v, visit, &element_size, grains[g]) == 0,
+                  "size %zu n=%zu", element_size, n);
+            CHECK(elements_seen == n, "size %zu n=%zu grain=%zu: %zu elements",
+                  element_size, n, grains[g], elements_seen);
+            CHECK(unaligned_ranges == 0,
+                  "size %zu n=%zu grain=%zu: %zu ranges off a cache line",
+                  element_size, n, grains[g], unaligned_ranges);
+            for (size_t i = 0; i < n; ++i)
+            {
+                int32_t index;
+                memcpy(&index, (char*)v->data + i * element_size, sizeof(index));
+                CHECK(index == ~(int32_t)i, "size %zu n=%zu grain=%zu: element %zu "
+                      "not visited", element_size, n, grains[g], i);
+            }
+            vector_free(v);
+        }
+    }
+}
+
+static void int_to_double(const void* in, void* out, size_t count, void* ctx)
+{
+    const int32_t* a = (const int32_t*)in;
+    double* b = (double*)out;
+    (void)ctx;
+    for (size_t i = 0; i < count; ++i)
+        b[i] = a[i] * 0.5;
+}
+
+static void negate(const void* in, void* out, size_t count, void* ctx)
+{
+    const int32_t* a = (const int32_t*)in;
+    int32_t* b = (int32_t*)out;
+    (void)ctx;
+    for (size_t i = 0; i < count; ++i)
+        b[i] = -a[i];
+}
+
+static void test_transform(void)
+{
+    size_t grain = VECTOR_PARALLEL_GRAIN_BYTES / sizeof(int32_t);
+    size_t lengths[] = {0, 1, grain - 1, grain + 1, 5 * grain + 3};
+    for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); ++l)
+    {
+        size_t n = lengths[l];
+        vector* src = vector_create(int32_t, n);
+        for (size_t i = 0; i < n; ++i)
+            *vector_at(int32_t, src, i) = (int32_t)i;
+        vector* wide = vector_create(double, 7);
+        CHECK(vector_parallel_transform(src, wide, int_to_double, NULL) == 0, "n=%zu", n);
+        CHECK(vector_length(wide) == n, "n=%zu: length %zu", n, vector_length(wide));
+        for (size_t i = 0; i < n; ++i)
+            CHECK(*vector_at(double, wide, i) == (double)i * 0.5, "n=%zu index %zu", n, i);
+        CHECK(vector_parallel_transform(src, src, negate, NULL) == 0, "in place n=%zu", n);
+        for (size_t i = 0; i < n; ++i)
+            CHECK(*vector_at(int32_t, src, i) == -(int32_t)i, "in place n=%zu index %zu",
+                  n, i);
+        vector_free(src);
+        vector_free(wide);
+    }
+}
+
+/* A parallel call from inside fn, on another vector, runs on the caller */
+static vector* inner;
+static size_t inner_elements;
+
+static void count_inner(void* chunk, size_t count, size_t first, void* ctx)
+{
+    (void)chunk;
+    (void)first;
+    (void)ctx;
+    __atomic_fetch_add(&inner_elements, count, __ATOMIC_RELAXED);
+}
+
+static void run_inner(void* chunk, size_t count, size_t first, void* ctx)
+{
+    (void)chunk;
+    (void)first;
+    (void)ctx;
+    __atomic_fetch_add(&elements_seen, count, __ATOMIC_RELAXED);
+    CHECK(vector_parallel_for(inner, count_inner, NULL, 10) == 0, "nested call");
+}
+
+static void test_nested(void)
+{
+    size_t n = 200000, ranges = n / 1000;
+    vector* outer = vector_create(char, n);
+    inner = vector_create(char, 1000);
+    elements_seen = 0;
+    inner_elements = 0;
+    CHECK(vector_parallel_for(outer, run_inner, NULL, 1000) == 0, "outer call");
+    CHECK(elements_seen == n, "outer saw %zu elements", elements_seen);
+    CHECK(inner_elements % 1000 == 0 && inner_elements >= 1000 &&
+          inner_elements <= ranges * 1000,
+          "inner saw %zu elements", inner_elements);
+    vector_free(outer);
+    vector_free(inner);
+}
+
+int main(void)
+{
+    test_for(4);
+    test_for(8);
+    test_for(12);
+    test_transform();
+    test_nested();
+
+    vector_set_error_callback(VECTOR_ERROR_SILENT);
+    vector* v = vector_create(int32_t, 3);
+    CHECK(vector_parallel_for(NULL, visit, NULL, 0) == -1, "NULL vector");
+    CHECK(vector_parallel_for(v, NULL, NULL, 0) == -1, "NULL fn");
+    CHECK(vector_parallel_transform(v, NULL, negate, NULL) == -1, "NULL dst");
+    vector_free(v);
+    return 0;
+}
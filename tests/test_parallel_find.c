@@ -0,0 +1,104 @@
+/*
+ * test_parallel_find.c - vector_find, vector_parallel_find, vector_count_if
+ * and vector_any_of
+ * Copyright (C) 2025 Stefan Froberg <stefan.froberg@protonmail.com>
+ *
+ * Built with VECTOR_PARALLEL_THREADS=4 by make test. Matches are placed at
+ * the first and last element, on both sides of range boundaries and several
+ * times over, and the parallel searches must report the same first match as
+ * a sequential scan. vector_find must call compar on the calling thread only.
+ */
+#include "vector.h"
+#include "test.h"
+#include <pthread.h>
+
+static pthread_t caller;
+static int other_thread_calls;
+
+/* compare_eq for int64_t that notes calls made off the calling thread */
+static int eq_on_caller(const void* a, const void* b, void* context)
+{
+    (void)context;
+    if (!pthread_equal(pthread_self(), caller))
+        __atomic_store_n(&other_thread_calls, 1, __ATOMIC_RELAXED);
+    return *(const int64_t*)a != *(const int64_t*)b;
+}
+
+static int is_negative(const void* elem, void* ctx)
+{
+    (void)ctx;
+    return *(const int64_t*)elem < 0;
+}
+
+/* Returns the first negative element, -1 if none */
+static ssize_t first_negative(const vector* v)
+{
+    for (size_t i = 0; i < vector_length(v); ++i)
+        if (*(const int64_t*)((const char*)v->data + i * sizeof(int64_t)) < 0)
+            return (ssize_t)i;
+    return -1;
+}
+
+/* Runs every search over v and compares with a sequential scan */
+static void check_searches(vector* v, const char* what)
+{
+    ssize_t want = first_negative(v);
+    ssize_t count = 0;
+    for (size_t i = 0; i < vector_length(v); ++i)
+        count += *vector_at(int64_t, v, i) < 0;
+    other_thread_calls = 0;
+    CHECK(vector_find(int64_t, v, -1, eq_on_caller) == want, "%s: find", what);
+    CHECK(!other_thread_calls, "%s: vector_find called compar off the caller", what);
+    CHECK(vector_parallel_find(int64_t, v, -1, eq_on_caller) == want,
+          "%s: parallel_find", what);
+    CHECK(vector_parallel_find(int64_t, v, -1, compare_eq) == want,
+          "%s: parallel_find with compare_eq", what);
+    CHECK(vector_count_if(v, is_negative, NULL) == count, "%s: count_if", what);
+    CHECK(vector_any_of(v, is_negative, NULL) == (count > 0), "%s: any_of", what);
+}
+
+int main(void)
+{
+    caller = pthread_self();
+    size_t grain = VECTOR_PARALLEL_GRAIN_BYTES / sizeof(int64_t);
+    size_t lengths[] = {0, 1, 7, grain, grain + 1, 4 * grain + 3, 16 * grain};
+    char what[128];
+    for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); ++l)
+    {
+        size_t n = lengths[l];
+        vector* v = vector_create(int64_t, n);
+        for (size_t i = 0; i < n; ++i)
+            *vector_at(int64_t, v, i) = (int64_t)i;
+        snprintf(what, sizeof(what), "n=%zu no match", n);
+        check_searches(v, what);
+
+        /* One match at each interesting position, then all of them at once */
+        size_t spots[] = {0, 1, grain - 1, grain, grain + 1, n / 2, n - 1};
+        for (size_t s = 0; s < sizeof(spots) / sizeof(spots[0]); ++s)
+        {
+            if (spots[s] >= n)
+                continue;
+            *vector_at(int64_t, v, spots[s]) = -1;
+            snprintf(what, sizeof(what), "n=%zu match at %zu", n, spots[s]);
+            check_searches(v, what);
+            *vector_at(int64_t, v, spots[s]) = (int64_t)spots[s];
+        }
+        for (size_t s = sizeof(spots) / sizeof(spots[0]); s-- > 0;)
+        {
+            if (spots[s] >= n)
+                continue;
+            *vector_at(int64_t, v, spots[s]) = -1;
+            snprintf(what, sizeof(what), "n=%zu matches from %zu", n, spots[s]);
+            check_searches(v, what);
+        }
+        vector_free(v);
+    }
+
+    vector_set_error_callback(VECTOR_ERROR_SILENT);
+    vector* v = vector_create(int64_t, 3);
+    CHECK(vector_count_if(NULL, is_negative, NULL) == -1, "count_if NULL vector");
+    CHECK(vector_count_if(v, NULL, NULL) == -1, "count_if NULL pred");
+    CHECK(vector_any_of(v, NULL, NULL) == -1, "any_of NULL pred");
+    vector_free(v);
+    return 0;
+}
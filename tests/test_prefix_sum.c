@@ -0,0 +1,103 @@
+/*
+ * test_prefix_sum.c - vector_prefix_sum against a sequential reference
+ * Copyright (C) 2025 Stefan Froberg <stefan.froberg@protonmail.com>
+ *
+ * Covers every supported element type in both scan modes, in place and into
+ * a separate destination, at lengths around the SIMD width and around the
+ * parallel grain, where the scan switches to blocked passes on the pool.
+ * Values are small integers, so float and double sums are exact and can be
+ * compared for equality; unsigned types also check that sums wrap around.
+ */
+#include "vector.h"
+#include "test.h"
+
+/* Lengths scanned: short tails, then multiples of the grain plus or minus one */
+static size_t test_lengths(size_t grain, size_t* out)
+{
+    static const size_t small[] = {0, 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 63, 64, 65};
+    static const size_t blocks[] = {1, 2, 3, 7};
+    size_t n = 0;
+    for (size_t i = 0; i < sizeof(small) / sizeof(small[0]); ++i)
+        out[n++] = small[i];
+    for (size_t i = 0; i < sizeof(blocks) / sizeof(blocks[0]); ++i)
+    {
+        out[n++] = blocks[i] * grain - 1;
+        out[n++] = blocks[i] * grain;
+        out[n++] = blocks[i] * grain + 1;
+    }
+    return n;
+}
+
+/* Scans every length in both modes, in place, into src and into a separate */
+/* dst (shorter or longer beforehand), and compares with a plain loop. */
+/* value(i) gives the source elements; acc_type holds the reference sum. */
+#define TEST_SCAN(type, acc_type, value) \
+    do { \
+        size_t lengths[32]; \
+        size_t count = test_lengths(VECTOR_PARALLEL_GRAIN_BYTES / sizeof(type), lengths); \
+        for (size_t l = 0; l < count; ++l) \
+        { \
+            size_t n = lengths[l]; \
+            for (int mode = 0; mode < 2; ++mode) \
+            { \
+                for (int target = 0; target < 4; ++target) \
+                { \
+                    vector* src = vector_create(type, n); \
+                    for (size_t i = 0; i < n; ++i) \
+                        *vector_at(type, src, i) = (type)(value); \
+                    vector* dst = target == 0 ? NULL : target == 1 ? src : \
+                                  vector_create(type, target == 2 ? 3 : n + 100); \
+                    CHECK(vector_prefix_sum(type, src, dst, \
+                                            mode ? VECTOR_SCAN_EXCLUSIVE \
+                                                 : VECTOR_SCAN_INCLUSIVE) == 0, \
+                          #type " n=%zu", n); \
+                    vector* out = dst ? dst : src; \
+                    CHECK(vector_length(out) == n, #type " n=%zu length %zu", n, \
+                          vector_length(out)); \
+                    acc_type acc = 0; \
+                    for (size_t i = 0; i < n; ++i) \
+                    { \
+                        acc_type x = (acc_type)(type)(value); \
+                        acc_type want = mode ? acc : (acc_type)(acc + x); \
+                        acc = (acc_type)(acc + x); \
+                        CHECK(*vector_at(type, out, i) == (type)want, \
+                              #type " n=%zu mode=%d target=%d index %zu", n, mode, \
+                              target, i); \
+                    } \
+                    if (dst && dst != src) \
+                    { \
+                        for (size_t i = 0; i < n; ++i) \
+                            CHECK(*vector_at(type, src, i) == (type)(value), \
+                                  #type " n=%zu: source modified at %zu", n, i); \
+                        vector_free(dst); \
+                    } \
+                    vector_free(src); \
+                } \
+            } \
+        } \
+    } while (0)
+
+int main(void)
+{
+    TEST_SCAN(int32_t, int64_t, (int)(i * 7 % 13) - 3);
+    TEST_SCAN(uint32_t, uint32_t, 0x9E3779B9u * (uint32_t)i);
+    TEST_SCAN(int64_t, int64_t, (int64_t)(i * 7 % 13) - 3);
+    TEST_SCAN(uint64_t, uint64_t, 0x9E3779B97F4A7C15ull * (uint64_t)i);
+    TEST_SCAN(float, double, (int)(i * 7 % 13) - 3);
+    TEST_SCAN(double, double, (int)(i * 7 % 13) - 3);
+
+    /* Unsupported element types and mismatched sizes are rejected */
+    vector_set_error_callback(VECTOR_ERROR_SILENT);
+    vector* bytes = vector_create(char, 3);
+    CHECK(vector_prefix_sum(char, bytes, NULL, VECTOR_SCAN_INCLUSIVE) == -1, "char");
+    vector* ints = vector_create(int, 3);
+    CHECK(vector_prefix_sum(double, ints, NULL, VECTOR_SCAN_INCLUSIVE) == -1,
+          "double over int");
+    vector* longs = vector_create(int64_t, 3);
+    CHECK(vector_prefix_sum(int, ints, longs, VECTOR_SCAN_INCLUSIVE) == -1,
+          "int into int64_t");
+    vector_free(bytes);
+    vector_free(ints);
+    vector_free(longs);
+    return 0;
+}
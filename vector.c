@@ -0,0 +1,15 @@
+/*
+ * vector.c - libvector, the compiled form of vector.h
+ * Copyright (C) 2025 Stefan Froberg <stefan.froberg@protonmail.com>
+ *
+ * Overview:
+ * Emits the one copy of every vector.h function and of its global state
+ * (error callback, sort context, instrumentation tables). Programs that
+ * link libvector define VECTOR_LIB and the same VECTOR_* feature macros
+ * the library was built with. See the Makefile.
+ */
+#ifndef VECTOR_LIB
+#define VECTOR_LIB
+#endif
+#define VECTOR_IMPLEMENTATION
+#include "vector.h"
@@ -10,7 +10,34 @@
  * Key Features:
  * - O(1) access, O(1) amortized append, O(n) insert/remove.
  * - Thread-safe with read-write locks (Windows SRWLOCK, Linux pthread_rwlock_t).
- * - Customizable error handling via vector_set_error_callback.
+ * - Failures record a code in thread-local storage (vector_last_error); the
+ *   message is only formatted when vector_last_error_message or a callback
+ *   installed with vector_set_error_callback (e.g. vector_error_stderr)
+ *   needs it. No callback is installed by default.
+ * - Optional per-vector statistics (define VECTOR_STATS, see vector_get_stats).
+ * - Optional lock contention profiler (define VECTOR_LOCK_PROFILE, see
+ *   vector_lock_profile_dump).
+ * - Optional USDT probes for perf/bpftrace (define VECTOR_USDT, provider
+ *   "vector"; see the probe list below).
+ * - Optional live-vector registry with per-tag memory accounting (define
+ *   VECTOR_REGISTRY, see vector_registry_foreach).
+ * - Optional per-callsite allocation attribution (define VECTOR_ALLOC_SITES,
+ *   see vector_alloc_sites_dump).
+ * - Optional operation trace recorder writing a binary trace for replay with
+ *   bench/replay (define VECTOR_TRACE, see vector_trace_start).
+ * - Unchecked accessors (vector_get_unchecked, vector_data) that compile to
+ *   plain pointer arithmetic, asserting bounds only without NDEBUG; define
+ *   VECTOR_UNCHECKED to make vector_at_ptr and vector_view_at unchecked too.
+ * - Typed APIs with a compile-time element size (VECTOR_DEFINE).
+ * - Block-scoped iteration under one read lock (VECTOR_FOREACH) and chunked
+ *   callbacks with software prefetch (vector_for_each_chunk).
+ * - Parallel loops over a persistent worker pool (vector_parallel_for,
+ *   vector_parallel_transform).
+ * - Parallel search (vector_parallel_find, vector_count_if, vector_any_of) and
+ *   SIMD/parallel prefix sums (vector_prefix_sum).
+ * - Gather/scatter by index vectors (vector_gather, vector_scatter).
+ * - Non-owning views of a subrange (vector_slice) for read-only algorithms
+ *   (find, lower bound, reduce, serialize) without copying.
  *
  * Usage Example:
  *   vector* v = vector_create(int, 3, 1, 2, 3); // Creates [1, 2, 3]
@@ -24,6 +51,8 @@
  * Notes:
  * - Uninitialized memory is allocated; initialize elements before use.
  * - Requires C99 or later.
+ * - Header-only by default; define VECTOR_LIB and link libvector to share
+ *   one compiled copy and one global state (see "Build modes" below).
  */
 #ifndef __VECTOR_H__
 #define __VECTOR_H__
@@ -36,80 +65,539 @@
 #include <stdarg.h>  /* va_list, vsnprintf */
 #include <stdint.h>  /* SIZE_MAX, uint64_t, ssize_t */
 #include <stdbool.h>
+#include <assert.h>  /* assert (unchecked accessors in debug builds) */
 #include "align.h"   /* alignof, alignas */
 
 #if defined(_WIN32)
 #include <windows.h> /* SRWLOCK */
 #elif defined(__linux__)
-#include <pthread.h> /* pthread_rwlock_t */
+#include <pthread.h> /* pthread_rwlock_t, parallel worker pool */
+#include <unistd.h>  /* sysconf */
 #endif
 
-/* Enforce C99 or later */
-#if !defined(__STDC_VERSION__) || __STDC_VERSION__ < 199901L
+#if defined(__SSE2__)
+#include <emmintrin.h> /* SSE2 prefix sums */
+#endif
+
+/* x86 builds pick AVX2 or AVX-512 gathers at run time (target attributes */
+/* and __builtin_cpu_supports), whatever -m flags the code is built with */
+#if (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h> /* vector_gather, vector_scatter */
+#define _VECTOR_X86_GATHER
+#endif
+
+/* Lock acquisitions are timed when either instrumentation mode is enabled */
+#if defined(VECTOR_STATS) || defined(VECTOR_LOCK_PROFILE)
+#define _VECTOR_LOCK_TIMED
+#endif
+
+/* The monotonic clock is needed for lock timing and trace timestamps */
+#if defined(_VECTOR_LOCK_TIMED) || defined(VECTOR_TRACE)
+#define _VECTOR_CLOCK
+#endif
+
+#if defined(_VECTOR_CLOCK) && !defined(_WIN32)
+#include <time.h>    /* clock_gettime */
+#endif
+
+/*
+ * USDT probes (VECTOR_USDT). Each probe is a single nop plus an ELF note until
+ * a tracer attaches; arguments are values already in registers.
+ *   vector:realloc            (vec, old_capacity, new_capacity, element_size)
+ *   vector:sort__start        (vec, length, element_size)
+ *   vector:sort__done         (vec, length)
+ *   vector:serialize__start   (vec, length, element_size)
+ *   vector:serialize__done    (vec, result)
+ *   vector:deserialize__start (fp, element_size)
+ *   vector:deserialize__done  (vec, length)
+ *   vector:lock__wait__start  (vec, write)  only when the lock is contended
+ *   vector:lock__wait__done   (vec, write)
+ *   vector:pop__alloc         (vec, ptr, element_size)
+ *   vector:error              (code, format)
+ * Example: bpftrace -e 'usdt:./app:vector:realloc { @[arg2 - arg1] = count(); }'
+ */
+#if defined(VECTOR_USDT)
+    #if defined(__has_include)
+        #if __has_include(<sys/sdt.h>)
+            #include <sys/sdt.h>
+            #define _VECTOR_HAVE_SDT
+        #endif
+    #endif
+    #if !defined(_VECTOR_HAVE_SDT)
+        #warning "VECTOR_USDT requires <sys/sdt.h> (systemtap-sdt-dev); probes disabled"
+    #endif
+#endif
+
+#if defined(_VECTOR_HAVE_SDT)
+    #define _VECTOR_PROBE1(name, a) DTRACE_PROBE1(vector, name, a)
+    #define _VECTOR_PROBE2(name, a, b) DTRACE_PROBE2(vector, name, a, b)
+    #define _VECTOR_PROBE3(name, a, b, c) DTRACE_PROBE3(vector, name, a, b, c)
+    #define _VECTOR_PROBE4(name, a, b, c, d) DTRACE_PROBE4(vector, name, a, b, c, d)
+#else
+    #define _VECTOR_PROBE1(name, a) ((void)0)
+    #define _VECTOR_PROBE2(name, a, b) ((void)0)
+    #define _VECTOR_PROBE3(name, a, b, c) ((void)0)
+    #define _VECTOR_PROBE4(name, a, b, c, d) ((void)0)
+#endif
+
+/* Locks are tried without blocking first when contention must be observed */
+#if defined(_VECTOR_LOCK_TIMED) || defined(_VECTOR_HAVE_SDT)
+#define _VECTOR_LOCK_TRY
+#endif
+
+/* Enforce C99 or later; C++ may only use the declarations (VECTOR_LIB) */
+#if defined(__cplusplus)
+#if !defined(VECTOR_LIB)
+#error "C++ code must define VECTOR_LIB and link libvector (see vector.hpp)."
+#endif
+#elif !defined(__STDC_VERSION__) || __STDC_VERSION__ < 199901L
 #error "This library requires C99 or later."
 #endif
 
+/*
+ * Build modes:
+ * - Header-only (default): every function is static and defined in each
+ *   file that includes vector.h, each with its own copy of the global state.
+ * - Library: define VECTOR_LIB everywhere and link libvector (see Makefile).
+ *   vector.h then only declares the API, except for the hot accessors in
+ *   vector_inline.h, and vector.c defines VECTOR_IMPLEMENTATION to emit the
+ *   single copy of the functions and global state. The VECTOR_* feature
+ *   macros change the vector struct, so the library and its users must be
+ *   built with the same set.
+ */
+#if !defined(VECTOR_LIB)
+    #define VECTOR_API static
+    #define _VECTOR_DATA static
+    #ifndef VECTOR_IMPLEMENTATION
+    #define VECTOR_IMPLEMENTATION
+    #endif
+#elif defined(__GNUC__) || defined(__clang__)
+    #define VECTOR_API extern __attribute__((visibility("default")))
+    #define _VECTOR_DATA extern __attribute__((visibility("default")))
+#else
+    #define VECTOR_API extern
+    #define _VECTOR_DATA extern
+#endif
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
 /* Default alignment */
 #define VECTOR_DEFAULT_ALIGNMENT 16
 
-/* Vector struct definition */
+/* Error codes recorded per thread and returned by vector_last_error */
+typedef enum {
+    VECTOR_OK = 0,        /* No error recorded */
+    VECTOR_ERR_NULL,      /* NULL vector or argument */
+    VECTOR_ERR_BOUNDS,    /* Index or range out of bounds */
+    VECTOR_ERR_EMPTY,     /* Operation needs a non-empty vector */
+    VECTOR_ERR_OVERFLOW,  /* Size computation overflowed size_t */
+    VECTOR_ERR_NOMEM,     /* Allocation failed */
+    VECTOR_ERR_ARGS,      /* Invalid argument combination */
+    VECTOR_ERR_IO,        /* Serialization read or write failed */
+    VECTOR_ERR_LOCK       /* Lock initialization failed */
+} vector_error_code;
+
+/* Per-vector statistics, collected when compiled with VECTOR_STATS */
+typedef struct {
+    uint64_t reallocations;       /* Buffer reallocations (growth and shrink) */
+    uint64_t growth_bytes_copied; /* Bytes copied when realloc moved the buffer */
+    uint64_t memmove_bytes;       /* Bytes shifted by insert/prepend/remove */
+    size_t peak_capacity;         /* Highest capacity reached, in elements */
+    uint64_t lock_acquisitions;   /* Read and write lock acquisitions */
+    uint64_t lock_contentions;    /* Acquisitions that had to wait */
+    uint64_t lock_wait_ns;        /* Total nanoseconds spent waiting for the lock */
+} vector_stats;
+
+/* Log-scale lock wait histogram: 4 linear sub-buckets per power of two */
+/* nanoseconds, covering 0 ns to ~18 minutes with <= 25% bucket width */
+#define VECTOR_LOCK_HIST_SUB_BITS 2
+#define VECTOR_LOCK_HIST_MAX_BIT 40
+#define VECTOR_LOCK_HIST_BUCKETS \
+    ((VECTOR_LOCK_HIST_MAX_BIT - VECTOR_LOCK_HIST_SUB_BITS + 2) << VECTOR_LOCK_HIST_SUB_BITS)
+
+typedef struct {
+    uint64_t count;     /* Contended acquisitions recorded */
+    uint64_t total_ns;  /* Sum of wait times */
+    uint64_t max_ns;    /* Longest wait */
+    uint64_t buckets[VECTOR_LOCK_HIST_BUCKETS]; /* Wait time distribution */
+} vector_lock_histogram;
+
+/* Registry tag accounting (VECTOR_REGISTRY); sizes are in bytes */
+typedef struct {
+    const char* tag;            /* Tag name, NULL for untagged vectors */
+    size_t live_vectors;        /* Vectors currently carrying this tag */
+    size_t capacity_bytes;      /* Allocated data bytes charged to the tag */
+    size_t capacity_bytes_peak; /* High-water mark of capacity_bytes */
+    uint64_t grown_bytes;       /* Cumulative bytes added by reallocations */
+} vector_registry_tag_stats;
+
+/* Registry-wide totals (VECTOR_REGISTRY) */
+typedef struct {
+    size_t live_vectors;        /* Vectors currently alive */
+    size_t live_vectors_peak;   /* High-water mark of live_vectors */
+    size_t capacity_bytes;      /* Allocated data bytes across all vectors */
+    size_t capacity_bytes_peak; /* High-water mark of capacity_bytes */
+    size_t used_bytes;          /* length * element_size summed at query time */
+    size_t slack_bytes;         /* capacity_bytes - used_bytes at query time */
+} vector_registry_totals;
+
+/* One live vector as seen by vector_registry_foreach */
+typedef struct {
+    const struct vector* vec;   /* The vector (do not free from the callback) */
+    const char* tag;            /* Tag set with vector_set_tag, or NULL */
+    size_t element_size;        /* Bytes per element */
+    size_t length;              /* Elements in use */
+    size_t capacity;            /* Elements allocated */
+    size_t used_bytes;          /* length * element_size */
+    size_t capacity_bytes;      /* capacity * element_size */
+    size_t slack_bytes;         /* capacity_bytes - used_bytes */
+} vector_registry_entry;
+
+/* Per-callsite allocation totals (VECTOR_ALLOC_SITES); sizes are in bytes */
+typedef struct {
+    const char* file;           /* __FILE__ of the call, NULL if unattributed */
+    int line;                   /* __LINE__ of the call */
+    size_t live_vectors;        /* Vectors whose buffer is charged here */
+    size_t live_bytes;          /* Capacity bytes currently charged here */
+    size_t live_bytes_peak;     /* High-water mark of live_bytes */
+    uint64_t allocations;       /* Vectors created here */
+    uint64_t reallocations;     /* Buffer grows and shrinks done here */
+    uint64_t realloc_bytes;     /* Sum of new buffer sizes of those resizes */
+} vector_alloc_site_stats;
+
+/* Report orders for vector_alloc_sites_foreach and vector_alloc_sites_dump */
+typedef enum {
+    VECTOR_ALLOC_SORT_LIVE,     /* Most live bytes first */
+    VECTOR_ALLOC_SORT_CHURN     /* Most realloc_bytes first */
+} vector_alloc_sort;
+
+/* Prefix sum variants for vector_prefix_sum */
+typedef enum {
+    VECTOR_SCAN_INCLUSIVE,      /* out[i] = in[0] + ... + in[i] */
+    VECTOR_SCAN_EXCLUSIVE       /* out[i] = in[0] + ... + in[i - 1], out[0] = 0 */
+} vector_scan_mode;
+
+/* Operation codes in a VECTOR_TRACE trace */
+typedef enum {
+    VECTOR_TRACE_CREATE = 1,  /* index: element_size, count: initial length */
+    VECTOR_TRACE_FREE,
+    VECTOR_TRACE_APPEND,      /* count: values appended */
+    VECTOR_TRACE_INSERT,      /* index: position, count: values inserted */
+    VECTOR_TRACE_PREPEND,     /* count: values prepended */
+    VECTOR_TRACE_REMOVE,      /* index: position, count: elements removed */
+    VECTOR_TRACE_POP,
+    VECTOR_TRACE_AT,          /* index: element read */
+    VECTOR_TRACE_SET,         /* index: element written */
+    VECTOR_TRACE_FIND,        /* index: match or SIZE_MAX */
+    VECTOR_TRACE_SORT,        /* count: length sorted */
+    VECTOR_TRACE_CLEAR,
+    VECTOR_TRACE_COPY,        /* index: trace id of the new vector */
+    VECTOR_TRACE_RESERVE,     /* count: requested capacity */
+    VECTOR_TRACE_RESIZE,      /* count: new length */
+    VECTOR_TRACE_SHRINK,
+    VECTOR_TRACE_SWAP,        /* index: first element, count: second element */
+    VECTOR_TRACE_SERIALIZE,   /* count: length written */
+    VECTOR_TRACE_DESERIALIZE, /* count: length read (follows its CREATE) */
+    VECTOR_TRACE_RELEASE,     /* count: length handed to the caller */
+    VECTOR_TRACE_SWAP_CONTENTS, /* index: trace id of the other vector */
+    VECTOR_TRACE_MOVE,        /* index: trace id of the source vector */
+    VECTOR_TRACE_FILL,        /* count: elements overwritten */
+    VECTOR_TRACE_ASSIGN,      /* count: new length */
+    VECTOR_TRACE_OP_COUNT
+} vector_trace_op;
+
+/* Trace file layout: one vector_trace_header, then fixed-size records in */
+/* the order the operations took effect. Element sizes appear only in */
+/* CREATE records; later records refer to the vector by its trace id. */
+/* bench/vector_trace.h restates this layout for readers built without */
+/* vector.h; change both together. */
+#define VECTOR_TRACE_MAGIC "VECTRACE"
+#define VECTOR_TRACE_VERSION 1
+
+typedef struct {
+    char magic[8];        /* VECTOR_TRACE_MAGIC, not NUL-terminated */
+    uint32_t version;     /* VECTOR_TRACE_VERSION */
+    uint32_t record_size; /* sizeof(vector_trace_record) */
+} vector_trace_header;
+
+typedef struct {
+    uint64_t timestamp_ns; /* Nanoseconds since vector_trace_start */
+    uint64_t index;        /* Op-specific, see vector_trace_op */
+    uint64_t count;        /* Op-specific, see vector_trace_op */
+    uint32_t vector_id;    /* Trace id, assigned at creation */
+    uint16_t op;           /* vector_trace_op */
+    uint16_t thread_id;    /* Small per-thread number, from 1 */
+} vector_trace_record;
+
+/* Memory functions a vector uses for its data buffer */
 typedef struct {
+    void* (*alloc)(size_t);      /* Allocator function */
+    void* (*realloc)(void*, size_t); /* Reallocator function */
+    void (*free)(void*);         /* Deallocator function */
+} vector_allocator;
+
+/* Vector struct definition */
+typedef struct vector {
     void* data alignas(VECTOR_DEFAULT_ALIGNMENT); /* Pointer to data array */
     size_t length;       /* Current number of elements */
     size_t capacity;     /* Total allocated capacity */
     size_t element_size; /* Size of each element in bytes */
-    struct {
-        void* (*alloc)(size_t);      /* Allocator function */
-        void* (*realloc)(void*, size_t); /* Reallocator function */
-        void (*free)(void*);         /* Deallocator function */
-    } allocator;         /* Custom allocator functions */
+    vector_allocator allocator; /* Custom allocator functions */
 #if defined(_WIN32)
     SRWLOCK rwlock;      /* Windows read-write lock */
 #elif defined(__linux__)
     pthread_rwlock_t rwlock; /* POSIX read-write lock */
 #endif
+#if defined(VECTOR_STATS)
+    vector_stats stats;  /* Operation counters, updated atomically */
+#endif
+#if defined(VECTOR_LOCK_PROFILE)
+    vector_lock_histogram lock_wait[2]; /* Contended waits: [0] read, [1] write */
+#endif
+#if defined(VECTOR_REGISTRY)
+    struct {
+        struct vector* prev;         /* Live-vector list links */
+        struct vector* next;
+        struct _vector_tag* tag;     /* Tag slot capacity is charged to */
+        size_t accounted_bytes;      /* Capacity bytes currently charged */
+    } registry;
+#endif
+#if defined(VECTOR_TRACE)
+    uint32_t trace_id;   /* Identifies the vector in trace records */
+#endif
+#if defined(VECTOR_ALLOC_SITES)
+    struct {
+        struct _vector_alloc_site* created; /* Callsite that created the vector */
+        struct _vector_alloc_site* charged; /* Callsite the buffer is charged to */
+        size_t charged_bytes;               /* Capacity bytes currently charged */
+    } alloc_site;
+#endif
 } vector;
 
-/* Thread-local storage for sorting */
+/* Non-owning, read-only view of consecutive elements (see vector_slice) */
+/* Note: a view does not lock or own the buffer; it stays valid only until */
+/* the vector it came from is next modified or freed */
+typedef struct {
+    const void* data;    /* First element of the range */
+    size_t length;       /* Elements in the range */
+    size_t element_size; /* Size of each element in bytes */
+} vector_view;
+
+/* Statistics counter helpers; compile to nothing without VECTOR_STATS */
+#if defined(VECTOR_STATS)
+    #define _VECTOR_STAT_ADD(vec, field, n) \
+        ((void)__atomic_fetch_add(&(vec)->stats.field, (n), __ATOMIC_RELAXED))
+    #define _VECTOR_STAT_LOAD(vec, field) \
+        __atomic_load_n(&(vec)->stats.field, __ATOMIC_RELAXED)
+#else
+    #define _VECTOR_STAT_ADD(vec, field, n) ((void)0)
+#endif
+
+/* Thread-local storage class */
 #if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
-    _Thread_local static vector* _sort_context;
-    _Thread_local static int (*_sort_compar)(const void*, const void*, void*);
+    #define _VECTOR_THREAD_LOCAL _Thread_local
 #elif defined(__GNUC__) || defined(__clang__)
-    __thread static vector* _sort_context;
-    __thread static int (*_sort_compar)(const void*, const void*, void*);
+    #define _VECTOR_THREAD_LOCAL __thread
+#else
+    #define _VECTOR_THREAD_LOCAL
+    #warning "vector_sort and vector_last_error not thread-safe in pre-C11 without GCC/Clang"
+#endif
+
+/* Trace hook; arguments are not evaluated without VECTOR_TRACE */
+#if defined(VECTOR_TRACE)
+    #define _VECTOR_TRACE(op, vec, index, count) \
+        _vector_trace_record((op), (vec), (uint64_t)(index), (uint64_t)(count))
+#else
+    #define _VECTOR_TRACE(op, vec, index, count) ((void)0)
+#endif
+
+/* Cache line size assumed by prefetching and parallel range splitting */
+#ifndef VECTOR_CACHE_LINE
+#define VECTOR_CACHE_LINE 64
+#endif
+
+/* Read prefetch hint; a no-op on compilers without __builtin_prefetch */
+#if defined(__GNUC__) || defined(__clang__)
+    #define _VECTOR_PREFETCH(addr) __builtin_prefetch((addr), 0, 3)
+    #define _VECTOR_PREFETCH_WRITE(addr) __builtin_prefetch((addr), 1, 3)
+#else
+    #define _VECTOR_PREFETCH(addr) ((void)(addr))
+    #define _VECTOR_PREFETCH_WRITE(addr) ((void)(addr))
+#endif
+
+/* Allocation callsite of the public call in progress on this thread */
+#if defined(VECTOR_ALLOC_SITES)
+    #define _VECTOR_ALLOC_SITE_ENTER() \
+        (_vector_alloc_site_file = __FILE__, _vector_alloc_site_line = __LINE__)
+    #define _VECTOR_ALLOC_SITE_LEAVE() ((void)(_vector_alloc_site_file = NULL))
+#else
+    #define _VECTOR_ALLOC_SITE_ENTER() ((void)0)
+    #define _VECTOR_ALLOC_SITE_LEAVE() ((void)0)
+#endif
+
+/* Allocation callsite globals read by the public macros */
+#if defined(VECTOR_ALLOC_SITES)
+_VECTOR_DATA _VECTOR_THREAD_LOCAL const char* _vector_alloc_site_file;
+_VECTOR_DATA _VECTOR_THREAD_LOCAL int _vector_alloc_site_line;
+#endif
+
+/* Callsite of the public call in progress on this thread, charged for the */
+/* locks the library takes on its behalf (VECTOR_LOCK_PROFILE) */
+#if defined(VECTOR_LOCK_PROFILE)
+    #define _VECTOR_LOCK_SITE_ENTER() \
+        (_vector_lock_site_file = __FILE__, _vector_lock_site_line = __LINE__)
+    #define _VECTOR_LOCK_SITE_LEAVE() ((void)(_vector_lock_site_file = NULL))
+    #define _VECTOR_LOCK_SITE(call) \
+        ({ \
+            _VECTOR_LOCK_SITE_ENTER(); \
+            __typeof__(call) _site_ret = (call); \
+            _VECTOR_LOCK_SITE_LEAVE(); \
+            _site_ret; \
+        })
+    #define _VECTOR_LOCK_SITE_VOID(call) \
+        ({ \
+            _VECTOR_LOCK_SITE_ENTER(); \
+            (call); \
+            _VECTOR_LOCK_SITE_LEAVE(); \
+        })
+_VECTOR_DATA _VECTOR_THREAD_LOCAL const char* _vector_lock_site_file;
+_VECTOR_DATA _VECTOR_THREAD_LOCAL int _vector_lock_site_line;
 #else
-    static vector* _sort_context;
-    static int (*_sort_compar)(const void*, const void*, void*);
-    #warning "vector_sort not thread-safe in pre-C11 without GCC/Clang"
+    #define _VECTOR_LOCK_SITE_ENTER() ((void)0)
+    #define _VECTOR_LOCK_SITE_LEAVE() ((void)0)
+    #define _VECTOR_LOCK_SITE(call) (call)
+    #define _VECTOR_LOCK_SITE_VOID(call) ((void)(call))
 #endif
 
 /* Forward declarations */
-static void _vector_error(const char* format, ...);
-static void* _vector_at(vector* vec, size_t index);
-static vector* _vector_create_base(size_t element_size, size_t num_elements);
-static int _vector_append_internal(vector* vec, size_t num_values,
-                                   const void* values);
-static int _vector_insert_internal(vector* vec, size_t index, size_t num_values,
-                                   const void* values);
-static int _vector_prepend_internal(vector* vec, size_t num_values,
-                                    const void* values);
-static void* _vector_pop_internal(vector* vec);
-static int _vector_remove_internal(vector* vec, size_t index,
-                                   size_t num_elements);
-static int _vector_reserve_internal(vector* vec, size_t new_capacity);
-static int _vector_resize_internal(vector* vec, size_t new_length);
-static int _vector_serialize_internal(const vector* vec, FILE* fp);
-static vector* _vector_deserialize_internal(FILE* fp, size_t element_size);
-static int _vector_shrink_to_fit_internal(vector* vec);
-static int _vector_swap_internal(vector* vec, size_t idx1, size_t idx2);
-static void vector_rdlock(vector* vec);
-static void vector_wrlock(vector* vec);
-static void vector_unlock(vector* vec);
-static int _safe_add(size_t a, size_t b, size_t* result);
-static int _safe_mul(size_t a, size_t b, size_t* result);
-static void* default_alloc(size_t size);
-static void* default_realloc(void* ptr, size_t size);
-static void default_free(void* ptr);
+VECTOR_API void _vector_error(vector_error_code code, const char* format, ...);
+VECTOR_API int _vector_append_internal(vector* vec, size_t num_values,
+                                       const void* values);
+VECTOR_API int _vector_insert_internal(vector* vec, size_t index, size_t num_values,
+                                       const void* values);
+VECTOR_API int _vector_prepend_internal(vector* vec, size_t num_values,
+                                        const void* values);
+VECTOR_API void* _vector_pop_internal(vector* vec);
+VECTOR_API void vector_rdlock(vector* vec);
+VECTOR_API void vector_wrlock(vector* vec);
+VECTOR_API void vector_unlock(vector* vec);
+/* Non-blocking lock attempts; return 1 if the lock was taken, 0 if not */
+VECTOR_API int vector_tryrdlock(vector* vec);
+VECTOR_API int vector_trywrlock(vector* vec);
+VECTOR_API void _vector_rdlock_at(vector* vec, const char* file, int line);
+VECTOR_API void _vector_wrlock_at(vector* vec, const char* file, int line);
+#if defined(VECTOR_TRACE)
+VECTOR_API void _vector_trace_record(vector_trace_op op, const vector* vec,
+                                     uint64_t index, uint64_t count);
+#endif
+
+/* In profiling mode every lock call records the callsite that issued it */
+#if defined(VECTOR_LOCK_PROFILE)
+#define vector_rdlock(vec) _vector_rdlock_at((vec), __FILE__, __LINE__)
+#define vector_wrlock(vec) _vector_wrlock_at((vec), __FILE__, __LINE__)
+#endif
+
+/* In allocation attribution and lock profiling modes vector_reserve */
+/* records its callsite */
+#if defined(VECTOR_ALLOC_SITES) || defined(VECTOR_LOCK_PROFILE)
+#define vector_reserve(vec, new_capacity) \
+    ({ \
+        _VECTOR_ALLOC_SITE_ENTER(); \
+        _VECTOR_LOCK_SITE_ENTER(); \
+        int _ret = (vector_reserve)((vec), (new_capacity)); \
+        _VECTOR_LOCK_SITE_LEAVE(); \
+        _VECTOR_ALLOC_SITE_LEAVE(); \
+        _ret; \
+    })
+#endif
+
+/* Number of values in a macro's value list, from the size of the compound */
+/* literal built from it; 0 for an empty list */
+#define _VECTOR_VA_COUNT(type, ...) \
+    (sizeof((const type[]){__VA_ARGS__}) / sizeof(type))
+
+/* In allocation attribution and lock profiling modes the bulk appends */
+/* record their callsite */
+#if defined(VECTOR_ALLOC_SITES) || defined(VECTOR_LOCK_PROFILE)
+#define vector_append_array(vec, values, count) \
+    ({ \
+        _VECTOR_ALLOC_SITE_ENTER(); \
+        _VECTOR_LOCK_SITE_ENTER(); \
+        int _ret = (vector_append_array)((vec), (values), (count)); \
+        _VECTOR_LOCK_SITE_LEAVE(); \
+        _VECTOR_ALLOC_SITE_LEAVE(); \
+        _ret; \
+    })
+#define vector_insert_array(vec, index, values, count) \
+    ({ \
+        _VECTOR_ALLOC_SITE_ENTER(); \
+        _VECTOR_LOCK_SITE_ENTER(); \
+        int _ret = (vector_insert_array)((vec), (index), (values), (count)); \
+        _VECTOR_LOCK_SITE_LEAVE(); \
+        _VECTOR_ALLOC_SITE_LEAVE(); \
+        _ret; \
+    })
+#define vector_append_vector(dst, src) \
+    ({ \
+        _VECTOR_ALLOC_SITE_ENTER(); \
+        _VECTOR_LOCK_SITE_ENTER(); \
+        int _ret = (vector_append_vector)((dst), (src)); \
+        _VECTOR_LOCK_SITE_LEAVE(); \
+        _VECTOR_ALLOC_SITE_LEAVE(); \
+        _ret; \
+    })
+#define vector_append_uninit(vec, count) \
+    ({ \
+        _VECTOR_ALLOC_SITE_ENTER(); \
+        _VECTOR_LOCK_SITE_ENTER(); \
+        void* _slots = (vector_append_uninit)((vec), (count)); \
+        _VECTOR_LOCK_SITE_LEAVE(); \
+        _VECTOR_ALLOC_SITE_LEAVE(); \
+        _slots; \
+    })
+#define vector_append_begin(vec, count) \
+    ({ \
+        _VECTOR_ALLOC_SITE_ENTER(); \
+        _VECTOR_LOCK_SITE_ENTER(); \
+        void* _slots = (vector_append_begin)((vec), (count)); \
+        _VECTOR_LOCK_SITE_LEAVE(); \
+        _VECTOR_ALLOC_SITE_LEAVE(); \
+        _slots; \
+    })
+#endif
+
+/* Internal functions called from the public macros */
+VECTOR_API int _vector_compare_asc(const void* a, const void* b, void* context);
+VECTOR_API int _vector_compare_desc(const void* a, const void* b, void* context);
+VECTOR_API int _vector_compare_eq(const void* a, const void* b, void* context);
+VECTOR_API vector* _vector_create_with_values(size_t element_size, size_t num_elements,
+                                              size_t arg_count, const void* values);
+VECTOR_API vector* _vector_create_uninit(size_t element_size, size_t num_elements);
+VECTOR_API int _vector_fill_internal(vector* vec, const void* value, size_t element_size);
+VECTOR_API int _vector_assign_n_internal(vector* vec, size_t count, const void* value,
+                                         size_t element_size);
+VECTOR_API ssize_t _vector_find_internal(vector* vec, const void* value,
+                                         size_t element_size,
+                                         int (*compar)(const void*, const void*, void*));
+VECTOR_API ssize_t _vector_parallel_find_internal(vector* vec, const void* value,
+                                                  size_t element_size,
+                                                  int (*compar)(const void*, const void*,
+                                                                void*));
+VECTOR_API int _vector_prefix_sum_internal(vector* src, vector* dst,
+                                           vector_scan_mode mode,
+                                           size_t element_size, int floating);
+VECTOR_API ssize_t _vector_view_find_internal(vector_view view, const void* value,
+                                              int (*compar)(const void*, const void*, void*));
+VECTOR_API size_t _vector_view_lower_bound_internal(vector_view view, const void* value,
+                                                    int (*compar)(const void*, const void*, void*));
+VECTOR_API void _vector_sort_internal(vector* vec,
+                                      int (*compar)(const void*, const void*, void*));
+
+/* Hot accessors, inlined in both header-only and library builds */
+#include "vector_inline.h"
 
 /* Public API Macros and Functions */
 
@@ -120,27 +608,78 @@ static void default_free(void* ptr);
     ({ \
         int _ret; \
         if (!vec) { \
-            _vector_error("NULL vector"); \
+            _vector_error(VECTOR_ERR_NULL, "NULL vector"); \
             _ret = -1; \
         } else { \
+            _VECTOR_ALLOC_SITE_ENTER(); \
             vector_wrlock(vec); \
-            _ret = _vector_append_internal(vec, ARG_COUNT(__VA_ARGS__), \
+            _ret = _vector_append_internal(vec, \
+                                           _VECTOR_VA_COUNT(type, __VA_ARGS__), \
                                            (const type[]){__VA_ARGS__}); \
-            if (_ret == -1) _vector_error("Failed to append to vector"); \
+            if (_ret == -1) _vector_error(VECTOR_ERR_NOMEM, \
+                                          "Failed to append to vector"); \
+            else _VECTOR_TRACE(VECTOR_TRACE_APPEND, vec, 0, \
+                               _VECTOR_VA_COUNT(type, __VA_ARGS__)); \
             vector_unlock(vec); \
+            _VECTOR_ALLOC_SITE_LEAVE(); \
         } \
         _ret; \
     })
 
+/* Appends count elements from an array in one locked operation */
+/* Args: vec - vector pointer, values - count elements of vec->element_size */
+/*       bytes (may point into vec itself), count - number of elements */
+/* Returns: 0 on success, -1 on failure */
+/* Note: grows the buffer at most once and copies with a single memcpy */
+VECTOR_API int (vector_append_array)(vector* vec, const void* values, size_t count);
+
+/* Grows the length by count and returns the new, uninitialized slots */
+/* Args: vec - vector pointer, count - number of slots */
+/* Returns: pointer to the first new slot, NULL on failure or if count is 0 */
+/* Note: the slots are visible to other threads as soon as this returns and */
+/*       the pointer is invalidated by the next growth; for shared vectors use */
+/*       vector_append_begin/vector_append_commit instead */
+VECTOR_API void* (vector_append_uninit)(vector* vec, size_t count);
+
+/* Starts an in-place append: takes the write lock and makes room for count */
+/* elements past the end without changing the length */
+/* Args: vec - vector pointer, count - slots to reserve */
+/* Returns: pointer to the first reserved slot, NULL on failure or if count */
+/*          is 0 (the lock is not held after NULL) */
+/* Note: finish with vector_append_commit or vector_append_abort; the write */
+/*       lock is held in between */
+VECTOR_API void* (vector_append_begin)(vector* vec, size_t count);
+
+/* Publishes elements constructed after vector_append_begin and unlocks */
+/* Args: vec - vector pointer, count - slots actually filled (<= reserved) */
+/* Returns: 0 on success, -1 if count exceeds the reserved room (the lock is */
+/*          released either way) */
+VECTOR_API int vector_append_commit(vector* vec, size_t count);
+
+/* Abandons an append started with vector_append_begin and unlocks */
+/* Args: vec - vector pointer */
+/* Note: the reserved capacity is kept for later appends */
+VECTOR_API void vector_append_abort(vector* vec);
+
+/* Appends every element of src to dst in one locked operation */
+/* Args: dst - destination vector, src - source vector (read-only, may be dst) */
+/* Returns: 0 on success, -1 on failure or element size mismatch */
+/* Note: both vectors are locked for the copy, in address order */
+VECTOR_API int (vector_append_vector)(vector* dst, const vector* src);
+
 /* Macro to access an element at an index */
 /* Args: type - element type, vec - vector pointer, index - element index */
 /* Returns: pointer to element, NULL if invalid */
 #define vector_at(type, vec, index) \
     ({ \
+        size_t _idx = (index); \
         vector_rdlock(vec); \
-        type* _ptr = (type*)_vector_at(vec, index); \
-        if (!_ptr) _vector_error("Invalid vector or index %zu out of bounds " \
-                                 "(length: %zu)", index, vec ? vec->length : 0); \
+        type* _ptr = (type*)_vector_at(vec, _idx); \
+        if (!_ptr) _vector_error(vec ? VECTOR_ERR_BOUNDS : VECTOR_ERR_NULL, \
+                                 "Invalid vector or index %zu out of bounds " \
+                                 "(length: %zu)", _idx, \
+                                 vec ? vec->length : (size_t)0); \
+        else _VECTOR_TRACE(VECTOR_TRACE_AT, vec, _idx, 1); \
         vector_unlock(vec); \
         _ptr; \
     })
@@ -148,7 +687,37 @@ static void default_free(void* ptr);
 /* Macro to get pointer to element at index */
 /* Args: type - element type, vec - vector pointer, index - element index */
 /* Returns: pointer to element, NULL if invalid */
+/* Note: with VECTOR_UNCHECKED the NULL and bounds checks are only asserted */
+#if defined(VECTOR_UNCHECKED)
+#define vector_at_ptr(type, vec, index) \
+    ((type*)_vector_at_unchecked((vec), (index)))
+#else
 #define vector_at_ptr(type, vec, index) ((type*)_vector_at(vec, index))
+#endif
+
+/* Macro to get the data pointer without locking or checks */
+/* Args: type - element type, vec - vector pointer (asserted non-NULL) */
+/* Returns: pointer to the first element (NULL if nothing is allocated) */
+/* Note: the caller must hold the lock or otherwise exclude writers */
+#if defined(NDEBUG)
+#define vector_data(type, vec) ((type*)(vec)->data)
+#else
+#define vector_data(type, vec) ((type*)_vector_data_checked((vec), sizeof(type)))
+#endif
+
+/* Macro to get pointer to element at index without locking or checks */
+/* Args: type - element type (sizeof(type) must equal element_size), */
+/*       vec - vector pointer, index - element index (< length) */
+/* Returns: pointer to element */
+/* Note: compiles to typed pointer arithmetic; bounds, NULL and the element */
+/* size are asserted unless NDEBUG is defined. The caller must hold the */
+/* lock or otherwise exclude writers. */
+#if defined(NDEBUG)
+#define vector_get_unchecked(type, vec, index) ((type*)(vec)->data + (index))
+#else
+#define vector_get_unchecked(type, vec, index) \
+    ((type*)_vector_get_checked((vec), (index), sizeof(type)))
+#endif
 
 /* Macro to get vector capacity */
 /* Args: vec - vector pointer */
@@ -158,89 +727,265 @@ static void default_free(void* ptr);
 /* Clears vector by setting length to 0 */
 /* Args: vec - vector pointer */
 /* Returns: 0 on success, -1 if NULL */
-static int vector_clear(vector* vec)
-{
-    if (!vec)
-    {
-        _vector_error("NULL vector");
-        return -1;
-    }
-    vector_wrlock(vec);
-    vec->length = 0;
-    vector_unlock(vec);
-    return 0;
-}
+VECTOR_API int vector_clear(vector* vec);
 
 /* Creates a deep copy of the vector */
 /* Args: src - source vector pointer (read-only) */
 /* Returns: new vector pointer, NULL on failure */
-static vector* vector_copy(const vector* src)
-{
-    if (!src)
-    {
-        _vector_error("NULL source vector");
-        return NULL;
-    }
-    vector_rdlock((vector*)src);
-    vector* dst = _vector_create_base(src->element_size, src->length);
-    if (dst)
-    {
-        memcpy(dst->data, src->data, src->length * src->element_size);
-        dst->length = src->length;
-    }
-    vector_unlock((vector*)src);
-    return dst;
-}
+VECTOR_API vector* vector_copy(const vector* src);
 
 /* Macro to create vector with type and elements */
 /* Args: type - element type, ... - num_elements and optional values */
 /* Returns: new vector pointer, NULL on failure */
 #define vector_create(type, ...) \
-    _vector_create_dispatch(type, __VA_ARGS__)
+    ({ \
+        _VECTOR_ALLOC_SITE_ENTER(); \
+        vector* _vec = _vector_create_dispatch(type, __VA_ARGS__); \
+        _VECTOR_ALLOC_SITE_LEAVE(); \
+        _vec; \
+    })
 #define _vector_create_dispatch(type, num_elements_or_first, ...) \
     _vector_create_with_values(sizeof(type), num_elements_or_first, \
-                               ARG_COUNT(__VA_ARGS__), (const type[]){__VA_ARGS__})
+                               _VECTOR_VA_COUNT(type, __VA_ARGS__), \
+                               (const type[]){__VA_ARGS__})
+
+/* Macro to create vector of num_elements elements without zeroing them */
+/* Args: type - element type, num_elements - initial length */
+/* Returns: new vector pointer, NULL on failure */
+/* Note: element contents are indeterminate; write every element (e.g. with */
+/* vector_fill or through vector_data) before reading it */
+#define vector_create_uninit(type, num_elements) \
+    ({ \
+        _VECTOR_ALLOC_SITE_ENTER(); \
+        vector* _vec = _vector_create_uninit(sizeof(type), (num_elements)); \
+        _VECTOR_ALLOC_SITE_LEAVE(); \
+        _vec; \
+    })
+
+/* Block-scoped loop over vector elements under one read lock */
+/* Args: type - element type (sizeof(type) must equal element_size), */
+/*       vec - vector pointer, ptr - name of the type* loop variable */
+/* Usage: VECTOR_FOREACH(int, v, p) { sum += *p; } */
+/* Note: the lock is taken before the first element and released when the */
+/* loop ends, including through break. Leaving the body with return or goto */
+/* skips the unlock. A NULL vector runs no iterations. */
+#define VECTOR_FOREACH(type, vec, ptr) \
+    for (vector* _vfe_vec = (vec), \
+                *_vfe_held = _vfe_vec ? (vector_rdlock(_vfe_vec), _vfe_vec) : NULL; \
+         _vfe_held; vector_unlock(_vfe_held), _vfe_held = NULL) \
+        for (size_t _vfe_left = _vfe_vec->length, _vfe_once = 1; _vfe_once; \
+             _vfe_once = 0) \
+            for (type* ptr = vector_data(type, _vfe_vec); _vfe_left; \
+                 ++ptr, --_vfe_left)
 
-/* Macro to iterate over vector elements */
+/* Macro to iterate over vector elements; same as VECTOR_FOREACH */
 /* Args: type - element type, vec - vector pointer, ptr - iterator variable */
-#define vector_foreach(type, vec, ptr) \
-    do { \
-        if (vec) { \
-            vector_rdlock(vec); \
-            for (type* ptr = (type*)(vec)->data; \
-                 ptr < (type*)((char*)(vec)->data + (vec)->length * (vec)->element_size); \
-                 ++ptr) { \
-                /* User code here */ \
-            } \
-            vector_unlock(vec); \
-        } \
-    } while (0)
+#define vector_foreach(type, vec, ptr) VECTOR_FOREACH(type, vec, ptr)
+
+/* Default elements per vector_for_each_chunk call: this many bytes' worth */
+#ifndef VECTOR_CHUNK_BYTES
+#define VECTOR_CHUNK_BYTES 16384
+#endif
+
+/* Default bytes vector_for_each_chunk prefetches ahead of the callback */
+#ifndef VECTOR_PREFETCH_DISTANCE
+#define VECTOR_PREFETCH_DISTANCE VECTOR_CHUNK_BYTES
+#endif
+
+/* Calls fn on consecutive ranges of elements under one read lock */
+/* Args: vec - vector pointer (read-only), fn - called as */
+/*       fn(chunk, count, ctx) with a pointer to count consecutive */
+/*       elements, ctx - passed through to fn */
+/* Returns: 0 on success (also when fn stops early), -1 if vec or fn is NULL */
+/* Note: ranges cover the vector in order, VECTOR_CHUNK_BYTES at a time, and */
+/* the next VECTOR_PREFETCH_DISTANCE bytes are prefetched before each call. */
+/* fn stops the walk by returning non-zero and must not modify the vector. */
+VECTOR_API int vector_for_each_chunk(const vector* vec,
+                                     int (*fn)(const void* chunk, size_t count,
+                                               void* ctx),
+                                     void* ctx);
+
+/* vector_for_each_chunk with explicit chunk size and prefetch distance */
+/* Args: vec, fn, ctx - as for vector_for_each_chunk, chunk_elements - */
+/*       elements per call (0 for VECTOR_CHUNK_BYTES' worth), */
+/*       prefetch_bytes - how far ahead of each chunk to prefetch (0 to */
+/*       leave it to the hardware prefetcher) */
+/* Returns: 0 on success, -1 if vec or fn is NULL */
+VECTOR_API int vector_for_each_chunk_ex(const vector* vec,
+                                        int (*fn)(const void* chunk, size_t count,
+                                                  void* ctx),
+                                        void* ctx, size_t chunk_elements,
+                                        size_t prefetch_bytes);
+
+/* Threads used by the parallel calls, including the caller; 0 for one per */
+/* online CPU. The pool is static state of the implementation, so in the */
+/* default header-only mode every translation unit that makes parallel */
+/* calls starts its own pool; build with VECTOR_LIB to share one. */
+#ifndef VECTOR_PARALLEL_THREADS
+#define VECTOR_PARALLEL_THREADS 0
+#endif
+
+/* Upper bound on the parallel thread count */
+#ifndef VECTOR_PARALLEL_MAX_THREADS
+#define VECTOR_PARALLEL_MAX_THREADS 64
+#endif
+
+/* Default grain of the parallel calls: this many bytes' worth of elements */
+#ifndef VECTOR_PARALLEL_GRAIN_BYTES
+#define VECTOR_PARALLEL_GRAIN_BYTES 65536
+#endif
+
+/* Calls fn on disjoint ranges of elements from a pool of worker threads */
+/* Args: vec - vector pointer, fn - called as fn(chunk, count, first, ctx) */
+/*       with count elements starting at index first, ctx - passed through */
+/*       to fn, grain - minimum elements per range (0 for */
+/*       VECTOR_PARALLEL_GRAIN_BYTES' worth) */
+/* Returns: 0 on success, -1 if vec or fn is NULL */
+/* Note: the write lock is held for the whole call, so fn may modify the */
+/* elements of its range and nothing else of the vector. Ranges end on cache */
+/* line boundaries of the buffer (where the element size allows) and are */
+/* handed out dynamically, so fn runs concurrently */
+/* and in no particular order. Vectors of at most grain elements, calls made */
+/* from inside fn, calls made while another thread's parallel call is */
+/* running, and non-Linux builds run fn on the calling thread. */
+VECTOR_API int vector_parallel_for(vector* vec,
+                                   void (*fn)(void* chunk, size_t count,
+                                              size_t first, void* ctx),
+                                   void* ctx, size_t grain);
+
+/* Maps src into dst in parallel, range by range */
+/* Args: src - source vector (read-only), dst - destination vector (may be */
+/*       src, element sizes may differ), fn - called as fn(in, out, count, */
+/*       ctx) with count elements of src at in and of dst at out, */
+/*       ctx - passed through to fn */
+/* Returns: 0 on success, -1 on failure */
+/* Note: dst is resized to src's length and every element is written by fn. */
+/* The read lock on src and the write lock on dst are held for the call. */
+VECTOR_API int vector_parallel_transform(const vector* src, vector* dst,
+                                         void (*fn)(const void* in, void* out,
+                                                    size_t count, void* ctx),
+                                         void* ctx);
 
 /* Macro to find element in vector */
 /* Args: type - element type, vec - vector pointer, value - value to find, */
 /*       compar - comparison function */
-/* Returns: index of element, -1 if not found */
+/* Returns: index of the first matching element, -1 if not found */
+/* Note: scans on the calling thread. _vector_compare_eq on 1, 2, 4 and 8 */
+/* byte elements compares directly instead of calling through the pointer. */
 #define vector_find(type, vec, value, compar) \
-    _vector_find_internal((vec), (const void*)&(type){(value)}, sizeof(type), (compar))
+    _VECTOR_LOCK_SITE(_vector_find_internal((vec), (const void*)&(type){(value)}, \
+                                            sizeof(type), (compar)))
+
+/* Macro to find element in vector using the worker pool */
+/* Args: as vector_find */
+/* Returns: index of the first matching element, -1 if not found */
+/* Note: vectors larger than the parallel grain are scanned by the worker */
+/* pool (see vector_parallel_for), so compar must be safe to call from */
+/* several threads at once. Ranges past an earlier match stop scanning. */
+#define vector_parallel_find(type, vec, value, compar) \
+    _VECTOR_LOCK_SITE(_vector_parallel_find_internal((vec), (const void*)&(type){(value)}, \
+                                                     sizeof(type), (compar)))
+
+/* Counts the elements for which pred returns non-zero */
+/* Args: vec - vector pointer (read-only), pred - called as pred(elem, ctx), */
+/*       ctx - passed through to pred */
+/* Returns: number of matching elements, -1 if vec or pred is NULL */
+/* Note: scanned under one read lock, in parallel for vectors larger than */
+/* the parallel grain; pred must be safe to call from several threads */
+VECTOR_API ssize_t vector_count_if(const vector* vec,
+                                   int (*pred)(const void* elem, void* ctx),
+                                   void* ctx);
+
+/* Tests whether pred returns non-zero for any element */
+/* Args: vec - vector pointer (read-only), pred - called as pred(elem, ctx), */
+/*       ctx - passed through to pred */
+/* Returns: 1 if some element matches, 0 if none does, -1 if vec or pred */
+/*          is NULL */
+/* Note: scanned like vector_count_if; every thread stops at the first match */
+VECTOR_API int vector_any_of(const vector* vec,
+                             int (*pred)(const void* elem, void* ctx),
+                             void* ctx);
+
+/* Macro to compute the running sums of a numeric vector */
+/* Args: type - element type: 4 or 8 byte integer (signed or unsigned), */
+/*       float or double, src - source vector, dst - destination vector, */
+/*       NULL or src to scan in place, mode - VECTOR_SCAN_INCLUSIVE or */
+/*       VECTOR_SCAN_EXCLUSIVE */
+/* Returns: 0 on success, -1 on failure */
+/* Note: dst is resized to src's length. Integer sums wrap around. Vectors */
+/* larger than the parallel grain use two passes on the worker pool: block */
+/* totals first, then each block is scanned from the sum of the blocks */
+/* before it. Blocks are scanned four floats or ints, or two doubles or */
+/* 64-bit ints, per SSE2 register. Floating sums are therefore added in a */
+/* different order than a sequential loop and may differ in the last bits. */
+#define vector_prefix_sum(type, src, dst, mode) \
+    _VECTOR_LOCK_SITE(_vector_prefix_sum_internal((src), (dst), (mode), sizeof(type), \
+                                                  (type)0.5 != 0))
+
+/* Elements vector_gather and vector_scatter prefetch ahead when copying */
+/* element by element */
+#ifndef VECTOR_GATHER_PREFETCH
+#define VECTOR_GATHER_PREFETCH 16
+#endif
+
+/* Copies src elements selected by an index vector: dst[i] = src[indices[i]] */
+/* Args: dst - destination vector, resized to the number of indices, */
+/*       src - source vector with dst's element size, indices - vector of */
+/*       uint32_t or uint64_t (4 or 8 byte elements) */
+/* Returns: 0 on success, -1 on failure (nothing is written if an index is */
+/*          out of bounds) */
+/* Note: the three locks are taken once, in address order. dst must not be */
+/* src or indices. 4 and 8 byte elements are loaded with AVX-512 or AVX2 */
+/* gather instructions when the CPU has them; other sizes are copied one */
+/* by one, prefetching the source VECTOR_GATHER_PREFETCH indices ahead. */
+VECTOR_API int vector_gather(vector* dst, const vector* src, const vector* indices);
+
+/* Stores src elements at the positions of an index vector: */
+/* dst[indices[i]] = src[i] */
+/* Args: dst - destination vector (not resized), indices - vector of */
+/*       uint32_t or uint64_t with src's length, src - source vector with */
+/*       dst's element size */
+/* Returns: 0 on success, -1 on failure (nothing is written if an index is */
+/*          out of bounds) */
+/* Note: locks as vector_gather. When an index repeats, the last element */
+/* stored there wins. AVX-512 scatters 4 and 8 byte elements; otherwise */
+/* the destination is prefetched VECTOR_GATHER_PREFETCH indices ahead. */
+VECTOR_API int vector_scatter(vector* dst, const vector* indices, const vector* src);
 
 /* Frees vector and its data */
 /* Args: vec - vector pointer to free */
-static void vector_free(vector* vec)
-{
-    if (vec)
-    {
-        vector_wrlock(vec);
-        if (vec->data)
-            vec->allocator.free(vec->data);
-        vector_unlock(vec);
-#if defined(_WIN32)
-        /* SRWLOCK does not require destruction */
-#elif defined(__linux__)
-        pthread_rwlock_destroy(&vec->rwlock);
-#endif
-        free(vec);
-    }
-}
+VECTOR_API void vector_free(vector* vec);
+
+/* Creates a vector that takes ownership of an existing buffer, no copy */
+/* Args: data - buffer of capacity elements (NULL if capacity is 0), */
+/*       length - elements in use, capacity - elements allocated, */
+/*       element_size - bytes per element, allocator - functions compatible */
+/*       with how data was allocated, NULL for malloc/realloc/free */
+/* Returns: new vector pointer, NULL on failure (data stays with the caller) */
+VECTOR_API vector* vector_from_buffer(void* data, size_t length, size_t capacity,
+                                      size_t element_size,
+                                      const vector_allocator* allocator);
+
+/* Detaches the data buffer and hands ownership to the caller */
+/* Args: vec - vector pointer, length/capacity - receive the buffer's sizes */
+/*       in elements (either may be NULL) */
+/* Returns: the buffer (free it with vec->allocator.free), NULL if the */
+/*          vector had no buffer or on error */
+/* Note: the vector stays valid and empty, and allocates anew when it grows */
+VECTOR_API void* vector_release_buffer(vector* vec, size_t* length, size_t* capacity);
+
+/* Exchanges the contents of two vectors in O(1), without copying elements */
+/* Args: a, b - vectors with the same element size (may be equal) */
+/* Returns: 0 on success, -1 if NULL or the element sizes differ */
+/* Note: buffers keep their allocators; both locks are held, in address order */
+VECTOR_API int vector_swap_contents(vector* a, vector* b);
+
+/* Moves the contents of src into dst in O(1); src is left empty */
+/* Args: dst - destination (its old elements are freed), src - source, */
+/*       both with the same element size */
+/* Returns: 0 on success, -1 if NULL or the element sizes differ */
+/* Note: both locks are held, in address order */
+VECTOR_API int vector_move(vector* dst, vector* src);
 
 /* Macro to insert values at index */
 /* Args: vec - vector pointer, type - element type, index - insertion point, */
@@ -249,14 +994,31 @@ static void vector_free(vector* vec)
 #define vector_insert(vec, type, index, ...) \
     ({ \
         int _ret; \
+        size_t _idx = (index); \
+        _VECTOR_ALLOC_SITE_ENTER(); \
         vector_wrlock(vec); \
-        _ret = _vector_insert_internal(vec, index, ARG_COUNT(__VA_ARGS__), \
+        _ret = _vector_insert_internal(vec, _idx, \
+                                       _VECTOR_VA_COUNT(type, __VA_ARGS__), \
                                        (const type[]){__VA_ARGS__}); \
-        if (_ret == -1) _vector_error("Failed to insert into vector"); \
+        if (_ret == -1) _vector_error(!vec ? VECTOR_ERR_NULL : \
+                                      _idx > vec->length ? VECTOR_ERR_BOUNDS : \
+                                      VECTOR_ERR_NOMEM, \
+                                      "Failed to insert into vector"); \
+        else _VECTOR_TRACE(VECTOR_TRACE_INSERT, vec, _idx, \
+                           _VECTOR_VA_COUNT(type, __VA_ARGS__)); \
         vector_unlock(vec); \
+        _VECTOR_ALLOC_SITE_LEAVE(); \
         _ret; \
     })
 
+/* Inserts count elements from an array at index in one locked operation */
+/* Args: vec - vector pointer, index - insertion point (<= length), */
+/*       values - count elements (may point into vec itself), count - number */
+/* Returns: 0 on success, -1 on failure */
+/* Note: grows the buffer at most once, then one memmove and one memcpy */
+VECTOR_API int (vector_insert_array)(vector* vec, size_t index, const void* values,
+                                     size_t count);
+
 /* Checks if vector is empty */
 /* Args: vec - vector pointer */
 /* Returns: true if empty or NULL, false otherwise */
@@ -270,7 +1032,7 @@ static void vector_free(vector* vec)
 /* Removes and returns last element */
 /* Args: type - element type, vec - vector pointer */
 /* Returns: pointer to popped element, NULL on failure */
-#define vector_pop(type, vec) ((type*)_vector_pop_internal(vec))
+#define vector_pop(type, vec) ((type*)_VECTOR_LOCK_SITE(_vector_pop_internal(vec)))
 
 /* Macro to prepend values to vector */
 /* Args: vec - vector pointer, type - element type, ... - values to prepend */
@@ -278,11 +1040,17 @@ static void vector_free(vector* vec)
 #define vector_prepend(vec, type, ...) \
     ({ \
         int _ret; \
+        _VECTOR_ALLOC_SITE_ENTER(); \
         vector_wrlock(vec); \
-        _ret = _vector_prepend_internal(vec, ARG_COUNT(__VA_ARGS__), \
+        _ret = _vector_prepend_internal(vec, \
+                                        _VECTOR_VA_COUNT(type, __VA_ARGS__), \
                                         (const type[]){__VA_ARGS__}); \
-        if (_ret == -1) _vector_error("Failed to prepend to vector"); \
+        if (_ret == -1) _vector_error(vec ? VECTOR_ERR_NOMEM : VECTOR_ERR_NULL, \
+                                      "Failed to prepend to vector"); \
+        else _VECTOR_TRACE(VECTOR_TRACE_PREPEND, vec, 0, \
+                           _VECTOR_VA_COUNT(type, __VA_ARGS__)); \
         vector_unlock(vec); \
+        _VECTOR_ALLOC_SITE_LEAVE(); \
         _ret; \
     })
 
@@ -291,105 +1059,73 @@ static void vector_free(vector* vec)
 /* Removes elements from index */
 /* Args: vec - vector pointer, index - start index, num_elements - count */
 /* Returns: 0 on success, -1 on failure */
-static int vector_remove(vector* vec, size_t index, size_t num_elements)
-{
-    if (!vec)
-    {
-        _vector_error("NULL vector");
-        return -1;
-    }
-    vector_wrlock(vec);
-    int result = _vector_remove_internal(vec, index, num_elements);
-    vector_unlock(vec);
-    return result;
-}
+VECTOR_API int vector_remove(vector* vec, size_t index, size_t num_elements);
 
 /* Reserves capacity for vector */
 /* Args: vec - vector pointer, new_capacity - desired capacity */
 /* Returns: 0 on success, -1 on failure */
-static int vector_reserve(vector* vec, size_t new_capacity)
-{
-    if (!vec)
-    {
-        _vector_error("NULL vector");
-        return -1;
-    }
-    vector_wrlock(vec);
-    int result = _vector_reserve_internal(vec, new_capacity);
-    vector_unlock(vec);
-    return result;
-}
+VECTOR_API int (vector_reserve)(vector* vec, size_t new_capacity);
 
 /* Resizes vector to new length */
 /* Args: vec - vector pointer, new_length - desired length */
 /* Returns: 0 on success, -1 on failure */
-static int vector_resize(vector* vec, size_t new_length)
-{
-    if (!vec)
-    {
-        _vector_error("NULL vector");
-        return -1;
-    }
-    vector_wrlock(vec);
-    int result = _vector_resize_internal(vec, new_length);
-    vector_unlock(vec);
-    return result;
-}
+VECTOR_API int vector_resize(vector* vec, size_t new_length);
 
-/* Serializes vector to file */
-/* Args: vec - vector pointer (read-only), fp - file pointer */
+/* Macro to overwrite every element with value */
+/* Args: vec - vector pointer, type - element type, value - value to store */
+/* Returns: 0 on success, -1 if NULL or sizeof(type) != element_size */
+/* Note: values whose bytes are all equal (0, -1, ...) are stored with one */
+/* memset; others are copied once and then doubled with memcpy */
+#define vector_fill(vec, type, value) \
+    _VECTOR_LOCK_SITE(_vector_fill_internal((vec), (const void*)&(type){(value)}, \
+                                            sizeof(type)))
+
+/* Macro to replace the contents with count copies of value */
+/* Args: vec - vector pointer, type - element type, count - new length, */
+/*       value - value to store */
 /* Returns: 0 on success, -1 on failure */
-static int vector_serialize(const vector* vec, FILE* fp)
-{
-    if (!vec || !fp)
-    {
-        _vector_error("NULL vector or file pointer");
-        return -1;
-    }
-    vector_rdlock((vector*)vec);
-    int result = _vector_serialize_internal(vec, fp);
-    vector_unlock((vector*)vec);
-    return result;
-}
+/* Note: grows to exactly count elements when needed; never shrinks the */
+/* capacity */
+#define vector_assign_n(vec, type, count, value) \
+    ({ \
+        _VECTOR_ALLOC_SITE_ENTER(); \
+        _VECTOR_LOCK_SITE_ENTER(); \
+        int _ret = _vector_assign_n_internal((vec), (count), \
+                                             (const void*)&(type){(value)}, \
+                                             sizeof(type)); \
+        _VECTOR_LOCK_SITE_LEAVE(); \
+        _VECTOR_ALLOC_SITE_LEAVE(); \
+        _ret; \
+    })
+
+/* Serializes vector to file */
+/* Args: vec - vector pointer (read-only), fp - file pointer */
+/* Returns: 0 on success, -1 on failure */
+VECTOR_API int vector_serialize(const vector* vec, FILE* fp);
 
 /* Deserializes vector from file */
 /* Args: fp - file pointer, element_size - size of each element */
 /* Returns: new vector pointer, NULL on failure */
-static vector* vector_deserialize(FILE* fp, size_t element_size)
-{
-    if (!fp)
-    {
-        _vector_error("NULL file pointer");
-        return NULL;
-    }
-    return _vector_deserialize_internal(fp, element_size);
-}
+VECTOR_API vector* vector_deserialize(FILE* fp, size_t element_size);
 
 /* Macro to set value at index */
 /* Args: type - element type, vec - vector pointer, index - position, */
 /*       value - value to set */
 #define vector_set(type, vec, index, value) do { \
+    size_t _idx = (index); \
     vector_wrlock(vec); \
-    type* _ptr = (type*)_vector_at(vec, index); \
-    if (_ptr) *_ptr = (value); \
+    type* _ptr = (type*)_vector_at(vec, _idx); \
+    if (_ptr) { \
+        *_ptr = (value); \
+        _VECTOR_TRACE(VECTOR_TRACE_SET, vec, _idx, 1); \
+    } \
     vector_unlock(vec); \
 } while (0)
 
 /* Shrinks vector capacity to length */
 /* Args: vec - vector pointer */
 /* Returns: 0 on success, -1 on failure */
-static int vector_shrink_to_fit(vector* vec)
-{
-    if (!vec)
-    {
-        _vector_error("NULL vector");
-        return -1;
-    }
-    vector_wrlock(vec);
-    int result = _vector_shrink_to_fit_internal(vec);
-    vector_unlock(vec);
-    return result;
-}
+VECTOR_API int vector_shrink_to_fit(vector* vec);
 
 /* Macro to sort vector */
 /* Args: vec - vector pointer, type - element type, compar - comparison fn */
@@ -398,24 +1134,365 @@ static int vector_shrink_to_fit(vector* vec)
     do { \
         vector_wrlock(vec); \
         _vector_sort_internal(vec, compar); \
+        _VECTOR_TRACE(VECTOR_TRACE_SORT, vec, 0, (vec)->length); \
         vector_unlock(vec); \
     } while (0)
 
 /* Swaps two elements in vector */
 /* Args: vec - vector pointer, idx1 - first index, idx2 - second index */
 /* Returns: 0 on success, -1 on failure */
-static int vector_swap(vector* vec, size_t idx1, size_t idx2)
-{
-    if (!vec)
-    {
-        _vector_error("NULL vector");
-        return -1;
+VECTOR_API int vector_swap(vector* vec, size_t idx1, size_t idx2);
+
+/* Macro to generate a typed API for vectors of one element type */
+/* Args: name - prefix of the generated functions, type - element type */
+/* Generates (vec must have element_size == sizeof(type), asserted in debug */
+/* builds):                                                              */
+/*   int    name_append(vector* vec, type value)     0 or -1              */
+/*   type*  name_at(vector* vec, size_t index)       NULL if out of range */
+/*   int    name_set(vector* vec, size_t index, type value)  0 or -1      */
+/*   ssize_t name_find(vector* vec, type value)      index or -1          */
+/*   int    name_sort(vector* vec, int (*cmp)(const type*, const type*))  */
+/* Note: the functions lock like the generic API, but element loads, stores */
+/* and comparisons use sizeof(type) as a constant, so they compile to */
+/* single moves instead of variable-size memcpy. name_find compares bytes */
+/* like compare_eq. name_sort is an in-place introsort that calls cmp */
+/* directly, so a constant cmp can be inlined; it is not stable. */
+/* Example: VECTOR_DEFINE(ivec, int) at file scope, then ivec_append(v, 4) */
+#define VECTOR_DEFINE(name, type) \
+    static inline int name##_append(vector* vec, type value) \
+    { \
+        if (!vec) \
+        { \
+            _vector_error(VECTOR_ERR_NULL, "NULL vector"); \
+            return -1; \
+        } \
+        assert(vec->element_size == sizeof(type)); \
+        int _ret = 0; \
+        vector_wrlock(vec); \
+        if (vec->length < vec->capacity) \
+            ((type*)vec->data)[vec->length++] = value; \
+        else \
+            _ret = _vector_append_internal(vec, 1, &value); \
+        if (_ret == -1) \
+            _vector_error(VECTOR_ERR_NOMEM, "Failed to append to vector"); \
+        else \
+            _VECTOR_TRACE(VECTOR_TRACE_APPEND, vec, 0, 1); \
+        vector_unlock(vec); \
+        return _ret; \
+    } \
+    static inline type* name##_at(vector* vec, size_t index) \
+    { \
+        if (!vec) \
+        { \
+            _vector_error(VECTOR_ERR_NULL, "NULL vector"); \
+            return NULL; \
+        } \
+        assert(vec->element_size == sizeof(type)); \
+        type* _ptr = NULL; \
+        vector_rdlock(vec); \
+        if (index < vec->length) \
+        { \
+            _ptr = (type*)vec->data + index; \
+            _VECTOR_TRACE(VECTOR_TRACE_AT, vec, index, 1); \
+        } \
+        else \
+            _vector_error(VECTOR_ERR_BOUNDS, "Index %zu out of bounds " \
+                          "(length: %zu)", index, vec->length); \
+        vector_unlock(vec); \
+        return _ptr; \
+    } \
+    static inline int name##_set(vector* vec, size_t index, type value) \
+    { \
+        if (!vec) \
+        { \
+            _vector_error(VECTOR_ERR_NULL, "NULL vector"); \
+            return -1; \
+        } \
+        assert(vec->element_size == sizeof(type)); \
+        int _ret = -1; \
+        vector_wrlock(vec); \
+        if (index < vec->length) \
+        { \
+            ((type*)vec->data)[index] = value; \
+            _VECTOR_TRACE(VECTOR_TRACE_SET, vec, index, 1); \
+            _ret = 0; \
+        } \
+        else \
+            _vector_error(VECTOR_ERR_BOUNDS, "Index %zu out of bounds " \
+                          "(length: %zu)", index, vec->length); \
+        vector_unlock(vec); \
+        return _ret; \
+    } \
+    static inline ssize_t name##_find(vector* vec, type value) \
+    { \
+        if (!vec) \
+        { \
+            _vector_error(VECTOR_ERR_NULL, "NULL vector"); \
+            return -1; \
+        } \
+        assert(vec->element_size == sizeof(type)); \
+        ssize_t _found = -1; \
+        vector_rdlock(vec); \
+        const type* _data = (const type*)vec->data; \
+        for (size_t i = 0; i < vec->length; ++i) \
+        { \
+            if (memcmp(&_data[i], &value, sizeof(type)) == 0) \
+            { \
+                _found = (ssize_t)i; \
+                break; \
+            } \
+        } \
+        _VECTOR_TRACE(VECTOR_TRACE_FIND, vec, \
+                      _found < 0 ? SIZE_MAX : (size_t)_found, 1); \
+        vector_unlock(vec); \
+        return _found; \
+    } \
+    static inline void _##name##_sift(type* a, size_t root, size_t n, \
+                                      int (*cmp)(const type*, const type*)) \
+    { \
+        type t = a[root]; \
+        for (size_t c; (c = 2 * root + 1) < n; root = c) \
+        { \
+            if (c + 1 < n && cmp(&a[c], &a[c + 1]) < 0) \
+                ++c; \
+            if (cmp(&t, &a[c]) >= 0) \
+                break; \
+            a[root] = a[c]; \
+        } \
+        a[root] = t; \
+    } \
+    static inline void _##name##_sort_range(type* a, size_t n, \
+                                            int (*cmp)(const type*, const type*), \
+                                            int depth) \
+    { \
+        type t; \
+        while (n > 16) \
+        { \
+            if (depth-- == 0) \
+            { \
+                /* Quicksort is degenerating: heapsort the rest */ \
+                for (size_t i = n / 2; i-- > 0;) \
+                    _##name##_sift(a, i, n, cmp); \
+                for (size_t i = n - 1; i > 0; --i) \
+                { \
+                    t = a[0]; a[0] = a[i]; a[i] = t; \
+                    _##name##_sift(a, 0, i, cmp); \
+                } \
+                return; \
+            } \
+            /* Median of three; a[0] and a[n - 1] then bound both scans */ \
+            size_t m = n / 2; \
+            if (cmp(&a[m], &a[0]) < 0) \
+            { t = a[m]; a[m] = a[0]; a[0] = t; } \
+            if (cmp(&a[n - 1], &a[m]) < 0) \
+            { \
+                t = a[m]; a[m] = a[n - 1]; a[n - 1] = t; \
+                if (cmp(&a[m], &a[0]) < 0) \
+                { t = a[m]; a[m] = a[0]; a[0] = t; } \
+            } \
+            type pivot = a[m]; \
+            size_t i = 0, j = n - 1; \
+            for (;;) \
+            { \
+                while (cmp(&a[i], &pivot) < 0) \
+                    ++i; \
+                while (cmp(&pivot, &a[j]) < 0) \
+                    --j; \
+                if (i >= j) \
+                    break; \
+                t = a[i]; a[i] = a[j]; a[j] = t; \
+                ++i; \
+                --j; \
+            } \
+            /* Recurse into the smaller side, loop on the larger */ \
+            size_t left = j + 1; \
+            if (left < n - left) \
+            { \
+                _##name##_sort_range(a, left, cmp, depth); \
+                a += left; \
+                n -= left; \
+            } \
+            else \
+            { \
+                _##name##_sort_range(a + left, n - left, cmp, depth); \
+                n = left; \
+            } \
+        } \
+        for (size_t i = 1; i < n; ++i) \
+        { \
+            t = a[i]; \
+            size_t k = i; \
+            for (; k > 0 && cmp(&t, &a[k - 1]) < 0; --k) \
+                a[k] = a[k - 1]; \
+            a[k] = t; \
+        } \
+    } \
+    static inline int name##_sort(vector* vec, int (*cmp)(const type*, const type*)) \
+    { \
+        if (!vec || !cmp) \
+        { \
+            _vector_error(VECTOR_ERR_NULL, "NULL vector or comparison function"); \
+            return -1; \
+        } \
+        assert(vec->element_size == sizeof(type)); \
+        vector_wrlock(vec); \
+        int _depth = 0; \
+        for (size_t n = vec->length; n > 1; n >>= 1) \
+            _depth += 2; \
+        _##name##_sort_range((type*)vec->data, vec->length, cmp, _depth); \
+        _VECTOR_TRACE(VECTOR_TRACE_SORT, vec, 0, vec->length); \
+        vector_unlock(vec); \
+        return 0; \
     }
-    vector_wrlock(vec);
-    int result = _vector_swap_internal(vec, idx1, idx2);
-    vector_unlock(vec);
-    return result;
-}
+
+/* Returns a view of count elements starting at start */
+/* Args: vec - vector pointer (read-only), start - first element, */
+/*       count - number of elements */
+/* Returns: view of the range, an empty view (data NULL) on failure */
+/* Note: the bounds are checked under the read lock, but the view is not */
+/* locked; it stays valid until the vector is next modified or freed */
+VECTOR_API vector_view vector_slice(const vector* vec, size_t start, size_t count);
+
+/* Returns a view of all elements */
+/* Args: vec - vector pointer (read-only) */
+/* Returns: view of the whole vector, an empty view if NULL */
+/* Note: same lifetime rules as vector_slice */
+VECTOR_API vector_view vector_view_of(const vector* vec);
+
+/* Returns a view of count elements of view starting at start */
+/* Args: view - source view, start - first element, count - number of elements */
+/* Returns: narrowed view, an empty view on failure */
+VECTOR_API vector_view vector_view_sub(vector_view view, size_t start, size_t count);
+
+/* Macro to access an element of a view */
+/* Args: type - element type, view - vector_view, index - element index */
+/* Returns: const pointer to element, NULL if out of bounds */
+/* Note: with VECTOR_UNCHECKED the bounds check is only asserted */
+#if defined(VECTOR_UNCHECKED)
+#define vector_view_at(type, view, index) \
+    ((const type*)_vector_view_at_unchecked((view), (index)))
+#else
+#define vector_view_at(type, view, index) \
+    ((const type*)_vector_view_at((view), (index)))
+#endif
+
+/* Macro to find element in a view */
+/* Args: type - element type, view - vector_view, value - value to find, */
+/*       compar - comparison function */
+/* Returns: index of element within the view, -1 if not found */
+#define vector_view_find(type, view, value, compar) \
+    _vector_view_find_internal((view), (const void*)&(type){(value)}, (compar))
+
+/* Macro to binary search a sorted view */
+/* Args: type - element type, view - vector_view sorted by compar, */
+/*       value - value to search for, compar - comparison function */
+/* Returns: index of the first element not less than value (view length */
+/*          if every element is less) */
+#define vector_view_lower_bound(type, view, value, compar) \
+    _vector_view_lower_bound_internal((view), (const void*)&(type){(value)}, (compar))
+
+/* Folds the elements of a view into an accumulator, in order */
+/* Args: view - vector_view, fn - called as fn(acc, element, ctx), */
+/*       acc - accumulator passed to every call, ctx - user context */
+/* Returns: 0 on success, -1 if fn is NULL */
+VECTOR_API int vector_view_reduce(vector_view view,
+                                  void (*fn)(void* acc, const void* elem, void* ctx),
+                                  void* acc, void* ctx);
+
+/* Serializes a view to file in the vector_serialize format */
+/* Args: view - vector_view, fp - file pointer */
+/* Returns: 0 on success, -1 on failure */
+/* Note: read it back with vector_deserialize */
+VECTOR_API int vector_view_serialize(vector_view view, FILE* fp);
+
+/* Copies the vector's statistics counters */
+/* Args: vec - vector pointer (read-only), out - destination */
+/* Returns: 0 on success, -1 if NULL or built without VECTOR_STATS */
+VECTOR_API int vector_get_stats(const vector* vec, vector_stats* out);
+
+/* Resets the vector's statistics counters; peak restarts at current capacity */
+/* Args: vec - vector pointer */
+/* Returns: 0 on success, -1 if NULL or built without VECTOR_STATS */
+VECTOR_API int vector_reset_stats(vector* vec);
+
+/* Returns the upper bound of the bucket holding the p-th percentile wait */
+/* Args: hist - histogram, p - percentile in [0, 100] */
+/* Returns: wait time in nanoseconds, 0 if the histogram is empty */
+VECTOR_API uint64_t vector_lock_histogram_percentile(const vector_lock_histogram* hist,
+                                                     double p);
+
+/* Copies a vector's contended lock wait histograms */
+/* Args: vec - vector pointer (read-only), rd - read waits, wr - write waits */
+/*       (either may be NULL) */
+/* Returns: 0 on success, -1 if NULL or built without VECTOR_LOCK_PROFILE */
+VECTOR_API int vector_lock_profile_get(const vector* vec, vector_lock_histogram* rd,
+                                       vector_lock_histogram* wr);
+
+/* Prints one vector's read and write wait distributions */
+/* Args: vec - vector pointer (read-only), name - label for the report, */
+/*       fp - output stream */
+/* Returns: 0 on success, -1 if NULL or built without VECTOR_LOCK_PROFILE */
+VECTOR_API int vector_lock_profile_dump_vector(const vector* vec, const char* name,
+                                               FILE* fp);
+
+/* Prints every callsite that waited for a lock, longest total wait first */
+/* Args: fp - output stream */
+/* Returns: 0 on success, -1 if NULL or built without VECTOR_LOCK_PROFILE */
+VECTOR_API int vector_lock_profile_dump(FILE* fp);
+
+/* Tags a vector for registry accounting; its capacity moves to the new tag */
+/* Args: vec - vector pointer, tag - static string (NULL to untag) */
+/* Returns: 0 on success, -1 if NULL or built without VECTOR_REGISTRY */
+VECTOR_API int vector_set_tag(vector* vec, const char* tag);
+
+/* Calls fn for every live vector; stops early if fn returns non-zero */
+/* Args: fn - callback, ctx - passed through to fn */
+/* Returns: 0 on success, -1 if NULL or built without VECTOR_REGISTRY */
+/* Note: sizes are read without taking each vector's lock, so a vector that */
+/*       is being modified reports a recent but possibly stale snapshot. The */
+/*       registry is locked for the walk; fn must not create or free vectors. */
+VECTOR_API int vector_registry_foreach(int (*fn)(const vector_registry_entry* entry,
+                                                 void* ctx),
+                                       void* ctx);
+
+/* Calls fn for every registry tag that has ever held a vector */
+/* Args: fn - callback, ctx - passed through to fn */
+/* Returns: 0 on success, -1 if NULL or built without VECTOR_REGISTRY */
+VECTOR_API int vector_registry_foreach_tag(int (*fn)(const vector_registry_tag_stats* stats,
+                                                     void* ctx),
+                                           void* ctx);
+
+/* Reads registry-wide totals; used and slack bytes are summed by a walk */
+/* Args: out - destination */
+/* Returns: 0 on success, -1 if NULL or built without VECTOR_REGISTRY */
+VECTOR_API int vector_registry_get_totals(vector_registry_totals* out);
+
+/* Calls fn for every allocation callsite in the requested order; stops */
+/* early if fn returns non-zero */
+/* Args: fn - callback, ctx - passed through to fn, order - sort key */
+/* Returns: 0 on success, -1 if NULL or built without VECTOR_ALLOC_SITES */
+/* Note: allocations made outside vector_create, vector_append, */
+/*       vector_insert, vector_prepend and vector_reserve are charged to the */
+/*       vector's creating callsite, or reported with a NULL file */
+VECTOR_API int vector_alloc_sites_foreach(int (*fn)(const vector_alloc_site_stats* stats,
+                                                    void* ctx),
+                                          void* ctx, vector_alloc_sort order);
+
+/* Prints every allocation callsite, sorted by live bytes or realloc churn */
+/* Args: fp - output stream, order - sort key */
+/* Returns: 0 on success, -1 if NULL or built without VECTOR_ALLOC_SITES */
+VECTOR_API int vector_alloc_sites_dump(FILE* fp, vector_alloc_sort order);
+
+/* Starts recording every vector operation to a binary trace file */
+/* Args: path - trace file, truncated if it exists */
+/* Returns: 0 on success, -1 on failure, if a trace is already active or if */
+/*          built without VECTOR_TRACE */
+/* Note: only vectors created after this call can be replayed */
+VECTOR_API int vector_trace_start(const char* path);
+
+/* Stops recording and closes the trace file */
+/* Returns: 0 on success, -1 if no trace is active or a write failed */
+VECTOR_API int vector_trace_stop(void);
 
 /* Comparison macros for sorting */
 #define compare_asc   _vector_compare_asc
@@ -425,230 +1502,2827 @@ static int vector_swap(vector* vec, size_t idx1, size_t idx2)
 /* Error callback type */
 typedef void (*vector_error_callback)(const char* message);
 
-/* Sets error callback function */
-/* Args: callback - function to handle errors */
-void vector_set_error_callback(vector_error_callback callback);
+/* Callback value that disables error callbacks (the default); errors are */
+/* only recorded for vector_last_error and no message is formatted */
+#define VECTOR_ERROR_SILENT ((vector_error_callback)(uintptr_t)1)
+
+/* Sets error callback function; safe to call while other threads run */
+/* Args: callback - function to handle errors; NULL or VECTOR_ERROR_SILENT */
+/*       disables callbacks */
+/* Note: every failure then formats its message, which costs far more than */
+/* recording the code; install a callback for diagnostics, not lookup loops */
+VECTOR_API void vector_set_error_callback(vector_error_callback callback);
+
+/* Error callback that prints the message to stderr */
+/* Args: message - error message */
+/* Note: install with vector_set_error_callback(vector_error_stderr) */
+VECTOR_API void vector_error_stderr(const char* message);
+
+/* Returns the last error recorded on the calling thread */
+/* Returns: error code, VECTOR_OK if none since vector_clear_error */
+VECTOR_API vector_error_code vector_last_error(void);
+
+/* Clears the calling thread's last error */
+VECTOR_API void vector_clear_error(void);
+
+/* Returns a static description of an error code */
+/* Args: code - error code */
+VECTOR_API const char* vector_error_string(vector_error_code code);
 
-/* Internal Macros and Functions */
+/* Formats the calling thread's last error message */
+/* Args: buf - destination, size - size of buf */
+/* Returns: length of the full message (as snprintf), 0 if no error */
+VECTOR_API size_t vector_last_error_message(char* buf, size_t size);
 
-/* Counts variable arguments */
+/* In lock profiling mode the public functions that lock record their */
+/* callsite, so the locks they take are charged to the caller's line */
+#if defined(VECTOR_LOCK_PROFILE)
+#define vector_clear(vec) \
+    _VECTOR_LOCK_SITE((vector_clear)((vec)))
+#define vector_copy(src) \
+    _VECTOR_LOCK_SITE((vector_copy)((src)))
+#define vector_for_each_chunk(vec, fn, ctx) \
+    _VECTOR_LOCK_SITE((vector_for_each_chunk)((vec), (fn), (ctx)))
+#define vector_for_each_chunk_ex(vec, fn, ctx, chunk_elements, prefetch_bytes) \
+    _VECTOR_LOCK_SITE((vector_for_each_chunk_ex)((vec), (fn), (ctx), (chunk_elements), (prefetch_bytes)))
+#define vector_parallel_for(vec, fn, ctx, grain) \
+    _VECTOR_LOCK_SITE((vector_parallel_for)((vec), (fn), (ctx), (grain)))
+#define vector_parallel_transform(src, dst, fn, ctx) \
+    _VECTOR_LOCK_SITE((vector_parallel_transform)((src), (dst), (fn), (ctx)))
+#define vector_count_if(vec, pred, ctx) \
+    _VECTOR_LOCK_SITE((vector_count_if)((vec), (pred), (ctx)))
+#define vector_any_of(vec, pred, ctx) \
+    _VECTOR_LOCK_SITE((vector_any_of)((vec), (pred), (ctx)))
+#define vector_gather(dst, src, indices) \
+    _VECTOR_LOCK_SITE((vector_gather)((dst), (src), (indices)))
+#define vector_scatter(dst, indices, src) \
+    _VECTOR_LOCK_SITE((vector_scatter)((dst), (indices), (src)))
+#define vector_release_buffer(vec, length, capacity) \
+    _VECTOR_LOCK_SITE((vector_release_buffer)((vec), (length), (capacity)))
+#define vector_swap_contents(a, b) \
+    _VECTOR_LOCK_SITE((vector_swap_contents)((a), (b)))
+#define vector_move(dst, src) \
+    _VECTOR_LOCK_SITE((vector_move)((dst), (src)))
+#define vector_remove(vec, index, num_elements) \
+    _VECTOR_LOCK_SITE((vector_remove)((vec), (index), (num_elements)))
+#define vector_resize(vec, new_length) \
+    _VECTOR_LOCK_SITE((vector_resize)((vec), (new_length)))
+#define vector_serialize(vec, fp) \
+    _VECTOR_LOCK_SITE((vector_serialize)((vec), (fp)))
+#define vector_shrink_to_fit(vec) \
+    _VECTOR_LOCK_SITE((vector_shrink_to_fit)((vec)))
+#define vector_swap(vec, idx1, idx2) \
+    _VECTOR_LOCK_SITE((vector_swap)((vec), (idx1), (idx2)))
+#define vector_slice(vec, start, count) \
+    _VECTOR_LOCK_SITE((vector_slice)((vec), (start), (count)))
+#define vector_view_of(vec) \
+    _VECTOR_LOCK_SITE((vector_view_of)((vec)))
+#define vector_reset_stats(vec) \
+    _VECTOR_LOCK_SITE((vector_reset_stats)((vec)))
+#define vector_set_tag(vec, tag) \
+    _VECTOR_LOCK_SITE((vector_set_tag)((vec), (tag)))
+#define vector_free(vec) \
+    _VECTOR_LOCK_SITE_VOID((vector_free)((vec)))
+#endif
+
+/* Internal Macros */
+
+/* Legacy argument counter, limited to 10 arguments; the public macros use */
+/* _VECTOR_VA_COUNT instead */
 #define ARG_COUNT_N(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, N, ...) N
 #define ARG_COUNT(...) ARG_COUNT_N(__VA_ARGS__, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0)
 
-/* Gets pointer to element at index */
-/* Args: vec - vector pointer, index - element index */
-/* Returns: pointer to element, NULL if invalid */
-static void* _vector_at(vector* vec, size_t index)
-{
-    if (!vec || index >= vec->length)
-        return NULL;
-    return (char*)vec->data + index * vec->element_size;
+#if defined(__cplusplus)
 }
+#endif
 
-/* Appends values to vector */
-/* Args: vec - vector pointer, num_values - count, values - data to append */
-/* Returns: 0 on success, -1 on failure */
-static int _vector_append_internal(vector* vec, size_t num_values,
-                                   const void* values)
+/* Implementation; emitted in every including file in header-only mode, */
+/* and only in vector.c when building libvector */
+#if defined(VECTOR_IMPLEMENTATION)
+
+/* Process-wide mutex used by the instrumentation tables */
+#if defined(_WIN32)
+    typedef SRWLOCK _vector_mutex;
+    #define _VECTOR_MUTEX_INIT SRWLOCK_INIT
+#elif defined(__linux__)
+    typedef pthread_mutex_t _vector_mutex;
+    #define _VECTOR_MUTEX_INIT PTHREAD_MUTEX_INITIALIZER
+#else
+    typedef int _vector_mutex;
+    #define _VECTOR_MUTEX_INIT 0
+#endif
+
+/* Forward declarations of functions used only by the implementation */
+static vector* _vector_create_base(size_t element_size, size_t num_elements);
+static vector* _vector_create_alloc(size_t element_size, size_t num_elements,
+                                    int zeroed);
+static void _vector_fill_bytes(void* dst, const void* value, size_t count,
+                               size_t element_size);
+static vector* _vector_create_adopt(size_t element_size, void* data,
+                                    size_t length, size_t capacity,
+                                    const vector_allocator* allocator);
+static void* _vector_append_uninit_internal(vector* vec, size_t num_values);
+static int _vector_grow_internal(vector* vec, size_t needed);
+static int _vector_remove_internal(vector* vec, size_t index,
+                                   size_t num_elements);
+static int _vector_reserve_internal(vector* vec, size_t new_capacity);
+static int _vector_resize_internal(vector* vec, size_t new_length);
+static int _vector_serialize_internal(const vector* vec, FILE* fp);
+static int _vector_serialize_range(const void* owner, const void* data,
+                                   size_t length, size_t element_size, FILE* fp);
+static void _vector_view_shell(vector_view view, vector* shell);
+static vector* _vector_deserialize_internal(FILE* fp, size_t element_size);
+static int _vector_shrink_to_fit_internal(vector* vec);
+static int _vector_swap_internal(vector* vec, size_t idx1, size_t idx2);
+static void _vector_lock_ordered(vector* a, int a_write, vector* b, int b_write);
+static void _vector_unlock_ordered(vector* a, vector* b);
+static size_t _vector_sort_locks(vector* vecs[3], int write[3]);
+static void _vector_lock_ordered3(vector* a, int a_write, vector* b, int b_write,
+                                  vector* c, int c_write);
+static void _vector_unlock_ordered3(vector* a, vector* b, vector* c);
+static int _vector_index_check(const vector* indices, size_t bound);
+static void _vector_gather_range(char* dst, const char* src, const void* idx,
+                                 size_t n, size_t element_size, size_t index_size,
+                                 int narrow);
+static void _vector_scatter_range(char* dst, const char* src, const void* idx,
+                                  size_t n, size_t element_size, size_t index_size,
+                                  int narrow);
+#if defined(_VECTOR_X86_GATHER)
+static size_t _vector_gather_avx2(char* dst, const char* src, const void* idx,
+                                  size_t n, size_t element_size, size_t index_size);
+static size_t _vector_gather_avx512(char* dst, const char* src, const void* idx,
+                                    size_t n, size_t element_size, size_t index_size);
+static size_t _vector_scatter_avx512(char* dst, const char* src, const void* idx,
+                                     size_t n, size_t element_size, size_t index_size);
+#endif
+static void _vector_note_realloc(vector* vec, const void* old_data,
+                                 size_t old_capacity);
+static void _vector_registry_add(vector* vec);
+static void _vector_registry_remove(vector* vec);
+static void _vector_registry_charge(vector* vec);
+static void _vector_alloc_site_charge(vector* vec, int created);
+static void _vector_alloc_site_release(vector* vec);
+static void _vector_exchange_buffers(vector* a, vector* b);
+struct _vector_parallel_job;
+static void _vector_parallel_run(struct _vector_parallel_job* job,
+                                 size_t element_size, size_t grain);
+static void _vector_parallel_work(struct _vector_parallel_job* job);
+static size_t _vector_parallel_threads(void);
+static size_t _vector_parallel_task(size_t length, size_t element_size, size_t grain);
+static void _vector_parallel_plan(struct _vector_parallel_job* job, size_t element_size,
+                                  size_t grain);
+static size_t _vector_parallel_task_index(const struct _vector_parallel_job* job,
+                                          size_t begin);
+struct _vector_search_args;
+static void _vector_search(struct _vector_search_args* args, size_t length,
+                           void (*run)(struct _vector_parallel_job*, size_t, size_t));
+static ssize_t _vector_find_run(vector* vec, const void* value, size_t element_size,
+                                int (*compar)(const void*, const void*, void*),
+                                int parallel);
+static size_t _vector_search_range(const struct _vector_search_args* args,
+                                   size_t begin, size_t end);
+static void _vector_search_run(struct _vector_parallel_job* job, size_t begin,
+                               size_t end);
+static void _vector_count_run(struct _vector_parallel_job* job, size_t begin,
+                              size_t end);
+struct _vector_scan_args;
+union _vector_scan_value;
+static void _vector_scan(struct _vector_scan_args* args, size_t length);
+static void _vector_scan_sum_run(struct _vector_parallel_job* job, size_t begin,
+                                 size_t end);
+static void _vector_scan_block_run(struct _vector_parallel_job* job, size_t begin,
+                                   size_t end);
+static void _vector_scan_block(unsigned kind, const void* in, void* out, size_t n,
+                               union _vector_scan_value* acc, int exclusive);
+static void _vector_sum_block(unsigned kind, const void* in, size_t n,
+                              union _vector_scan_value* acc);
+#if defined(__linux__)
+static void _vector_pool_start(void);
+static void _vector_pool_after_fork(void);
+static void* _vector_pool_worker(void* arg);
+#endif
+static void _vector_mutex_lock(_vector_mutex* mutex);
+static void _vector_mutex_unlock(_vector_mutex* mutex);
+static void _vector_atomic_max_size(size_t* target, size_t value);
+static void _vector_atomic_min_size(size_t* target, size_t value);
+static void _vector_atomic_max_u64(uint64_t* target, uint64_t value);
+#if defined(VECTOR_REGISTRY)
+static struct _vector_tag* _vector_registry_tag_get(const char* name);
+#endif
+#if defined(VECTOR_ALLOC_SITES)
+static void _vector_alloc_site_copy(vector_alloc_site_stats* dst,
+                                    const struct _vector_alloc_site* src);
+#endif
+#if defined(VECTOR_TRACE)
+static void _vector_trace_flush_locked(void);
+#endif
+#if defined(_VECTOR_CLOCK)
+static uint64_t _vector_now_ns(void);
+#endif
+static uint64_t _vector_lock_hist_upper(size_t index);
+static void _vector_lock_hist_copy(vector_lock_histogram* dst,
+                                   const vector_lock_histogram* src);
+static void _vector_lock_hist_print(FILE* fp, const char* label, int line,
+                                    const char* mode,
+                                    const vector_lock_histogram* hist);
+static int _safe_add(size_t a, size_t b, size_t* result);
+static int _safe_mul(size_t a, size_t b, size_t* result);
+static void* default_alloc(size_t size);
+static void* default_realloc(void* ptr, size_t size);
+static void default_free(void* ptr);
+
+/* Thread-local storage for sorting */
+static _VECTOR_THREAD_LOCAL vector* _sort_context;
+static _VECTOR_THREAD_LOCAL int (*_sort_compar)(const void*, const void*, void*);
+
+/* Thread-local last error; the message is formatted only on request */
+struct _vector_error_state {
+    vector_error_code code; /* Last error code, VECTOR_OK if none */
+    const char* format;     /* printf format taking only size_t arguments */
+    size_t args[3];         /* Arguments for format */
+};
+static _VECTOR_THREAD_LOCAL struct _vector_error_state _vector_last_error;
+
+#if defined(VECTOR_LOCK_PROFILE)
+/* Callsite table size; waits from further callsites are counted as dropped */
+#ifndef VECTOR_LOCK_PROFILE_SITES
+#define VECTOR_LOCK_PROFILE_SITES 1024
+#endif
+
+/* Per-callsite contended wait histogram */
+struct _vector_lock_site {
+    const char* file;           /* __FILE__ of the lock call */
+    int line;                   /* __LINE__ of the lock call */
+    int write;                  /* 1 for vector_wrlock, 0 for vector_rdlock */
+    int used;                   /* Published with release ordering */
+    vector_lock_histogram hist; /* Contended waits from this callsite */
+};
+
+static struct _vector_lock_site _vector_lock_sites[VECTOR_LOCK_PROFILE_SITES];
+static uint64_t _vector_lock_sites_dropped;
+static _vector_mutex _vector_lock_sites_mutex = _VECTOR_MUTEX_INIT;
+#endif
+
+#if defined(VECTOR_REGISTRY)
+/* Tag table size; vectors tagged beyond it are charged to the untagged slot */
+#ifndef VECTOR_REGISTRY_TAGS
+#define VECTOR_REGISTRY_TAGS 256
+#endif
+
+/* Per-tag accounting slot; slot 0 is reserved for untagged vectors */
+struct _vector_tag {
+    const char* name;           /* Tag string (must outlive the vectors) */
+    int used;                   /* Published with release ordering */
+    size_t live_vectors;
+    size_t capacity_bytes;
+    size_t capacity_bytes_peak;
+    uint64_t grown_bytes;
+};
+
+static struct _vector_tag _vector_registry_tags[VECTOR_REGISTRY_TAGS] = {{NULL, 1, 0, 0, 0, 0}};
+static _vector_mutex _vector_registry_tags_mutex = _VECTOR_MUTEX_INIT;
+
+/* Live-vector list and atomic totals */
+static vector* _vector_registry_head;
+static _vector_mutex _vector_registry_mutex = _VECTOR_MUTEX_INIT;
+static size_t _vector_registry_live;
+static size_t _vector_registry_live_peak;
+static size_t _vector_registry_capacity;
+static size_t _vector_registry_capacity_peak;
+#endif
+
+#if defined(VECTOR_ALLOC_SITES)
+/* Callsite table size; further callsites are charged as unattributed */
+#ifndef VECTOR_ALLOC_SITES_MAX
+#define VECTOR_ALLOC_SITES_MAX 1024
+#endif
+
+/* Per-callsite allocation slot */
+struct _vector_alloc_site {
+    const char* file;           /* __FILE__ of the call */
+    int line;                   /* __LINE__ of the call */
+    int used;                   /* Published with release ordering */
+    size_t live_vectors;
+    size_t live_bytes;
+    size_t live_bytes_peak;
+    uint64_t allocations;
+    uint64_t reallocations;
+    uint64_t realloc_bytes;
+};
+
+static struct _vector_alloc_site _vector_alloc_sites[VECTOR_ALLOC_SITES_MAX];
+static struct _vector_alloc_site _vector_alloc_site_unknown = {NULL, 0, 1, 0, 0, 0, 0, 0, 0};
+static _vector_mutex _vector_alloc_sites_mutex = _VECTOR_MUTEX_INIT;
+#endif
+
+#if defined(VECTOR_TRACE)
+/* Records buffered before each write to the trace file */
+#ifndef VECTOR_TRACE_BUFFER
+#define VECTOR_TRACE_BUFFER 4096
+#endif
+
+/* Trace writer; active is read without the mutex on every operation */
+static struct {
+    FILE* fp;
+    int active;
+    int failed;            /* A write to fp failed */
+    uint64_t start_ns;
+    size_t used;
+    vector_trace_record buffer[VECTOR_TRACE_BUFFER];
+} _vector_trace_state;
+static _vector_mutex _vector_trace_mutex = _VECTOR_MUTEX_INIT;
+static uint32_t _vector_trace_next_id;
+static uint16_t _vector_trace_next_thread;
+static _VECTOR_THREAD_LOCAL uint16_t _vector_trace_thread;
+#endif
+
+/* One parallel call, split into tasks handed out through next */
+typedef struct _vector_parallel_job {
+    void (*run)(struct _vector_parallel_job* job, size_t begin, size_t end);
+    void* arg;      /* Call-specific state read by run */
+    size_t length;  /* Elements to process */
+    const void* base; /* Buffer run writes; NULL if tasks need not align */
+    size_t task;    /* Elements per task, a whole number of cache lines */
+    size_t head;    /* Elements in the first task, so later tasks start on */
+                    /* a cache line of base */
+    size_t tasks;   /* Number of tasks, 0 until planned */
+    size_t next;    /* Index of the next unclaimed task (atomic) */
+    size_t workers; /* Pool threads taking part besides the caller */
+} _vector_parallel_job;
+
+/* Running total of a prefix sum; the member of the element type is used */
+typedef union _vector_scan_value {
+    uint32_t u32;
+    uint64_t u64;
+    float f32;
+    double f64;
+} _vector_scan_value;
+
+/* Prefix sum element kinds: the element size, ored with this if floating */
+#define _VECTOR_SCAN_FLOATING 0x100
+
+/* State shared by the passes of a prefix sum */
+struct _vector_scan_args {
+    const char* in;
+    char* out;
+    char* totals;          /* One element per task: block sums, then their */
+                           /* exclusive prefix sums */
+    size_t element_size;
+    unsigned kind;         /* Element size | _VECTOR_SCAN_FLOATING */
+    int exclusive;
+};
+
+/* State shared by the threads of a find, count or any search */
+struct _vector_search_args {
+    const char* data;
+    size_t element_size;
+    const void* value;                                /* find: value sought */
+    int (*compar)(const void*, const void*, void*);   /* find: comparator */
+    vector* vec;                                      /* find: compar context */
+    int (*pred)(const void* elem, void* ctx);         /* count/any: predicate */
+    void* ctx;                                        /* count/any: pred context */
+    int any;        /* Stop at any match rather than the first one */
+    size_t best;    /* Lowest matching index so far, SIZE_MAX if none (atomic) */
+    size_t count;   /* Matches counted (atomic) */
+};
+
+#if defined(__linux__)
+/* Persistent worker pool, started by the first parallel call; other */
+/* platforms run parallel jobs on the calling thread */
+static pthread_once_t _vector_pool_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t _vector_pool_busy = PTHREAD_MUTEX_INITIALIZER;  /* Held by the caller of the running job */
+static pthread_mutex_t _vector_pool_mutex = PTHREAD_MUTEX_INITIALIZER; /* Guards the fields below */
+static pthread_cond_t _vector_pool_wake = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t _vector_pool_done = PTHREAD_COND_INITIALIZER;
+static size_t _vector_pool_size;               /* Worker threads started */
+static _vector_parallel_job* _vector_pool_job; /* Running job, NULL when idle */
+static uint64_t _vector_pool_generation;       /* Incremented for every job */
+static size_t _vector_pool_pending;            /* Workers still on the job */
+static _VECTOR_THREAD_LOCAL int _vector_pool_inside; /* Thread is doing pool work */
+#endif
+
+/* Library build: the one definition of the globals declared _VECTOR_DATA */
+#if defined(VECTOR_LIB) && defined(VECTOR_ALLOC_SITES)
+_VECTOR_THREAD_LOCAL const char* _vector_alloc_site_file;
+_VECTOR_THREAD_LOCAL int _vector_alloc_site_line;
+#endif
+#if defined(VECTOR_LIB) && defined(VECTOR_LOCK_PROFILE)
+_VECTOR_THREAD_LOCAL const char* _vector_lock_site_file;
+_VECTOR_THREAD_LOCAL int _vector_lock_site_line;
+#endif
+
+/* Appends count elements from an array in one locked operation */
+VECTOR_API int (vector_append_array)(vector* vec, const void* values, size_t count)
 {
-    if (!vec)
+    if (!vec || (!values && count))
+    {
+        _vector_error(VECTOR_ERR_NULL, "NULL vector or values");
         return -1;
-    if (num_values == 0)
-        return 0;
-
-    size_t total_elements;
-    if (_safe_add(vec->length, num_values, &total_elements) == -1)
+    }
+    vector_wrlock(vec);
+    size_t total;
+    if (_safe_add(vec->length, count, &total) == -1)
+    {
+        vector_unlock(vec);
+        _vector_error(VECTOR_ERR_OVERFLOW, "Append of %zu elements overflows "
+                      "length %zu", count, vec->length);
         return -1;
-
-    if (total_elements > vec->capacity)
+    }
+    /* Source inside our own buffer: growth may move it, so keep the offset */
+    const char* data = (const char*)vec->data;
+    size_t bytes = vec->capacity * vec->element_size;
+    int aliased = data && (const char*)values >= data &&
+                  (const char*)values < data + bytes;
+    size_t offset = aliased ? (size_t)((const char*)values - data) : 0;
+    if (aliased && total > vec->capacity &&
+        _vector_grow_internal(vec, total) == -1)
     {
-        size_t new_capacity = vec->capacity == 0 ? num_values :
-                              vec->capacity + vec->capacity / 2;
-        if (new_capacity < total_elements)
-            new_capacity = total_elements;
-        size_t new_size;
-        if (_safe_mul(new_capacity, vec->element_size, &new_size) == -1)
-            return -1;
-        void* new_data = vec->allocator.realloc(vec->data, new_size);
-        if (!new_data)
-            return -1;
-        vec->data = new_data;
-        vec->capacity = new_capacity;
+        vector_unlock(vec);
+        _vector_error(VECTOR_ERR_NOMEM, "Failed to append to vector");
+        return -1;
     }
-    memcpy((char*)vec->data + vec->length * vec->element_size, values,
-           num_values * vec->element_size);
-    vec->length = total_elements;
-    return 0;
+    if (aliased)
+        values = (const char*)vec->data + offset;
+    int result = _vector_append_internal(vec, count, values);
+    if (result == -1)
+        _vector_error(VECTOR_ERR_NOMEM, "Failed to append to vector");
+    else
+        _VECTOR_TRACE(VECTOR_TRACE_APPEND, vec, 0, count);
+    vector_unlock(vec);
+    return result;
 }
 
-/* Compares elements ascending */
-/* Args: a - first element, b - second element, context - vector pointer */
-/* Returns: -1 if a < b, 1 if a > b, 0 if equal */
-static int _vector_compare_asc(const void* a, const void* b, void* context)
+/* Grows the length by count and returns the new, uninitialized slots */
+VECTOR_API void* (vector_append_uninit)(vector* vec, size_t count)
 {
-    vector* vec = (vector*)context;
-    const char* ptr_a = (const char*)a;
-    const char* ptr_b = (const char*)b;
-    for (size_t i = 0; i < vec->element_size; ++i)
+    if (!vec)
     {
-        if (ptr_a[i] < ptr_b[i])
-            return -1;
-        if (ptr_a[i] > ptr_b[i])
-            return 1;
+        _vector_error(VECTOR_ERR_NULL, "NULL vector");
+        return NULL;
     }
-    return 0;
+    vector_wrlock(vec);
+    void* slots = _vector_append_uninit_internal(vec, count);
+    if (!slots && count)
+        _vector_error(VECTOR_ERR_NOMEM, "Failed to append %zu slots to vector",
+                      count);
+    else if (slots)
+        _VECTOR_TRACE(VECTOR_TRACE_APPEND, vec, 0, count);
+    vector_unlock(vec);
+    return slots;
 }
 
-/* Compares elements descending */
-/* Args: a - first element, b - second element, context - vector pointer */
-/* Returns: -1 if b < a, 1 if b > a, 0 if equal */
-static int _vector_compare_desc(const void* a, const void* b, void* context)
+/* Starts an in-place append: takes the write lock and makes room for count */
+VECTOR_API void* (vector_append_begin)(vector* vec, size_t count)
 {
-    vector* vec = (vector*)context;
-    const char* ptr_a = (const char*)a;
-    const char* ptr_b = (const char*)b;
-    for (size_t i = 0; i < vec->element_size; ++i)
+    if (!vec)
     {
-        if (ptr_b[i] < ptr_a[i])
-            return -1;
-        if (ptr_b[i] > ptr_a[i])
-            return 1;
+        _vector_error(VECTOR_ERR_NULL, "NULL vector");
+        return NULL;
     }
-    return 0;
+    if (count == 0)
+    {
+        _vector_error(VECTOR_ERR_ARGS, "Cannot begin an append of 0 slots");
+        return NULL;
+    }
+    vector_wrlock(vec);
+    size_t total;
+    if (_safe_add(vec->length, count, &total) == -1 ||
+        (total > vec->capacity && _vector_grow_internal(vec, total) == -1))
+    {
+        vector_unlock(vec);
+        _vector_error(VECTOR_ERR_NOMEM, "Failed to reserve %zu slots in vector",
+                      count);
+        return NULL;
+    }
+    return (char*)vec->data + vec->length * vec->element_size;
 }
 
-/* Checks element equality */
-/* Args: a - first element, b - second element, context - vector pointer */
-/* Returns: 0 if equal, 1 if not equal */
-static int _vector_compare_eq(const void* a, const void* b, void* context)
+/* Publishes elements constructed after vector_append_begin and unlocks */
+VECTOR_API int vector_append_commit(vector* vec, size_t count)
 {
-    vector* vec = (vector*)context;
-    const char* ptr_a = (const char*)a;
-    const char* ptr_b = (const char*)b;
-    for (size_t i = 0; i < vec->element_size; ++i)
+    if (!vec)
     {
-        if (ptr_a[i] != ptr_b[i])
-            return 1;
+        _vector_error(VECTOR_ERR_NULL, "NULL vector");
+        return -1;
+    }
+    if (count > vec->capacity - vec->length)
+    {
+        vector_unlock(vec);
+        _vector_error(VECTOR_ERR_BOUNDS, "Commit of %zu slots exceeds reserved "
+                      "room %zu", count, vec->capacity - vec->length);
+        return -1;
     }
+    vec->length += count;
+    if (count)
+        _VECTOR_TRACE(VECTOR_TRACE_APPEND, vec, 0, count);
+    vector_unlock(vec);
     return 0;
 }
 
-/* Creates vector with base settings */
+/* Abandons an append started with vector_append_begin and unlocks */
+VECTOR_API void vector_append_abort(vector* vec)
+{
+    vector_unlock(vec);
+}
+
+/* Appends every element of src to dst in one locked operation */
+VECTOR_API int (vector_append_vector)(vector* dst, const vector* src)
+{
+    if (!dst || !src)
+    {
+        _vector_error(VECTOR_ERR_NULL, "NULL vector");
+        return -1;
+    }
+    if (dst->element_size != src->element_size)
+    {
+        _vector_error(VECTOR_ERR_ARGS, "Element size mismatch: %zu vs %zu",
+                      dst->element_size, src->element_size);
+        return -1;
+    }
+    _vector_lock_ordered(dst, 1, (vector*)src, 0);
+    size_t count = src->length;
+    int result = 0;
+    if (count && dst == src)
+    {
+        /* Self-append: grow first so the source is the new buffer */
+        size_t total;
+        result = _safe_add(count, count, &total);
+        if (result == 0 && total > dst->capacity)
+            result = _vector_grow_internal(dst, total);
+    }
+    if (result == 0)
+        result = _vector_append_internal(dst, count, src->data);
+    if (result == -1)
+        _vector_error(VECTOR_ERR_NOMEM, "Failed to append to vector");
+    else
+        _VECTOR_TRACE(VECTOR_TRACE_APPEND, dst, 0, count);
+    _vector_unlock_ordered(dst, (vector*)src);
+    return result;
+}
+
+/* Clears vector by setting length to 0 */
+VECTOR_API int (vector_clear)(vector* vec)
+{
+    if (!vec)
+    {
+        _vector_error(VECTOR_ERR_NULL, "NULL vector");
+        return -1;
+    }
+    vector_wrlock(vec);
+    vec->length = 0;
+    _VECTOR_TRACE(VECTOR_TRACE_CLEAR, vec, 0, 0);
+    vector_unlock(vec);
+    return 0;
+}
+
+/* Creates a deep copy of the vector */
+VECTOR_API vector* (vector_copy)(const vector* src)
+{
+    if (!src)
+    {
+        _vector_error(VECTOR_ERR_NULL, "NULL source vector");
+        return NULL;
+    }
+    vector_rdlock((vector*)src);
+    vector* dst = _vector_create_base(src->element_size, src->length);
+    if (dst)
+    {
+        memcpy(dst->data, src->data, src->length * src->element_size);
+        dst->length = src->length;
+        _VECTOR_TRACE(VECTOR_TRACE_COPY, src, dst->trace_id, src->length);
+    }
+    vector_unlock((vector*)src);
+    return dst;
+}
+
+/* Calls fn on consecutive ranges of elements under one read lock */
+VECTOR_API int (vector_for_each_chunk)(const vector* vec,
+                                     int (*fn)(const void* chunk, size_t count,
+                                               void* ctx),
+                                     void* ctx)
+{
+    return (vector_for_each_chunk_ex)(vec, fn, ctx, 0, VECTOR_PREFETCH_DISTANCE);
+}
+
+/* vector_for_each_chunk with explicit chunk size and prefetch distance */
+VECTOR_API int (vector_for_each_chunk_ex)(const vector* vec,
+                                        int (*fn)(const void* chunk, size_t count,
+                                                  void* ctx),
+                                        void* ctx, size_t chunk_elements,
+                                        size_t prefetch_bytes)
+{
+    if (!vec || !fn)
+    {
+        _vector_error(VECTOR_ERR_NULL, "NULL vector or chunk function");
+        return -1;
+    }
+    size_t element_size = vec->element_size ? vec->element_size : 1;
+    if (chunk_elements == 0)
+        chunk_elements = VECTOR_CHUNK_BYTES / element_size;
+    if (chunk_elements == 0)
+        chunk_elements = 1;
+
+    vector_rdlock((vector*)vec);
+    const char* data = (const char*)vec->data;
+    size_t total = vec->length * vec->element_size;
+    for (size_t done = 0; done < vec->length; done += chunk_elements)
+    {
+        size_t count = vec->length - done;
+        if (count > chunk_elements)
+            count = chunk_elements;
+        size_t offset = done * vec->element_size;
+        if (prefetch_bytes && prefetch_bytes < total - offset)
+        {
+            /* Request the bytes fn reaches prefetch_bytes from now */
+            size_t from = offset + prefetch_bytes;
+            size_t to = from + count * vec->element_size;
+            if (to > total)
+                to = total;
+            for (; from < to; from += VECTOR_CACHE_LINE)
+                _VECTOR_PREFETCH(data + from);
+        }
+        if (fn(data + offset, count, ctx))
+            break;
+    }
+    vector_unlock((vector*)vec);
+    return 0;
+}
+
+/* Arguments of a vector_parallel_for job */
+struct _vector_parallel_for_args {
+    char* data;
+    size_t element_size;
+    void (*fn)(void* chunk, size_t count, size_t first, void* ctx);
+    void* ctx;
+};
+
+/* Runs one vector_parallel_for range */
+static void _vector_parallel_for_run(_vector_parallel_job* job, size_t begin,
+                                     size_t end)
+{
+    struct _vector_parallel_for_args* args =
+        (struct _vector_parallel_for_args*)job->arg;
+    args->fn(args->data + begin * args->element_size, end - begin, begin,
+             args->ctx);
+}
+
+/* Calls fn on disjoint ranges of elements from a pool of worker threads */
+VECTOR_API int (vector_parallel_for)(vector* vec,
+                                   void (*fn)(void* chunk, size_t count,
+                                              size_t first, void* ctx),
+                                   void* ctx, size_t grain)
+{
+    if (!vec || !fn)
+    {
+        _vector_error(VECTOR_ERR_NULL, "NULL vector or function");
+        return -1;
+    }
+    vector_wrlock(vec);
+    struct _vector_parallel_for_args args = {
+        (char*)vec->data, vec->element_size, fn, ctx
+    };
+    _vector_parallel_job job;
+    memset(&job, 0, sizeof(job));
+    job.run = _vector_parallel_for_run;
+    job.arg = &args;
+    job.length = vec->length;
+    job.base = vec->data;
+    _vector_parallel_run(&job, vec->element_size, grain);
+    vector_unlock(vec);
+    return 0;
+}
+
+/* Arguments of a vector_parallel_transform job */
+struct _vector_parallel_transform_args {
+    const char* in;
+    size_t in_size;
+    char* out;
+    size_t out_size;
+    void (*fn)(const void* in, void* out, size_t count, void* ctx);
+    void* ctx;
+};
+
+/* Runs one vector_parallel_transform range */
+static void _vector_parallel_transform_run(_vector_parallel_job* job,
+                                           size_t begin, size_t end)
+{
+    struct _vector_parallel_transform_args* args =
+        (struct _vector_parallel_transform_args*)job->arg;
+    args->fn(args->in + begin * args->in_size, args->out + begin * args->out_size,
+             end - begin, args->ctx);
+}
+
+/* Maps src into dst in parallel, range by range */
+VECTOR_API int (vector_parallel_transform)(const vector* src, vector* dst,
+                                         void (*fn)(const void* in, void* out,
+                                                    size_t count, void* ctx),
+                                         void* ctx)
+{
+    if (!src || !dst || !fn)
+    {
+        _vector_error(VECTOR_ERR_NULL, "NULL vector or function");
+        return -1;
+    }
+    _vector_lock_ordered((vector*)src, 0, dst, 1);
+    size_t length = src->length;
+    if (_vector_reserve_internal(dst, length) == -1)
+    {
+        _vector_unlock_ordered((vector*)src, dst);
+        _vector_error(VECTOR_ERR_NOMEM, "Failed to allocate %zu elements", length);
+        return -1;
+    }
+    if (dst != src && dst->length != length)
+    {
+        dst->length = length;
+        _VECTOR_TRACE(VECTOR_TRACE_RESIZE, dst, 0, length);
+    }
+    struct _vector_parallel_transform_args args = {
+        (const char*)src->data, src->element_size,
+        (char*)dst->data, dst->element_size, fn, ctx
+    };
+    _vector_parallel_job job;
+    memset(&job, 0, sizeof(job));
+    job.run = _vector_parallel_transform_run;
+    job.arg = &args;
+    job.length = length;
+    job.base = dst->data;
+    /* Writes are what must not share cache lines across ranges */
+    _vector_parallel_run(&job, dst->element_size, 0);
+    _vector_unlock_ordered((vector*)src, dst);
+    return 0;
+}
+
+/* Counts the elements for which pred returns non-zero */
+VECTOR_API ssize_t (vector_count_if)(const vector* vec,
+                                   int (*pred)(const void* elem, void* ctx),
+                                   void* ctx)
+{
+    if (!vec || !pred)
+    {
+        _vector_error(VECTOR_ERR_NULL, "NULL vector or predicate");
+        return -1;
+    }
+    vector_rdlock((vector*)vec);
+    struct _vector_search_args args;
+    memset(&args, 0, sizeof(args));
+    args.data = (const char*)vec->data;
+    args.element_size = vec->element_size;
+    args.pred = pred;
+    args.ctx = ctx;
+    _vector_search(&args, vec->length, _vector_count_run);
+    vector_unlock((vector*)vec);
+    return (ssize_t)args.count;
+}
+
+/* Tests whether pred returns non-zero for any element */
+VECTOR_API int (vector_any_of)(const vector* vec,
+                             int (*pred)(const void* elem, void* ctx),
+                             void* ctx)
+{
+    if (!vec || !pred)
+    {
+        _vector_error(VECTOR_ERR_NULL, "NULL vector or predicate");
+        return -1;
+    }
+    vector_rdlock((vector*)vec);
+    struct _vector_search_args args;
+    memset(&args, 0, sizeof(args));
+    args.data = (const char*)vec->data;
+    args.element_size = vec->element_size;
+    args.pred = pred;
+    args.ctx = ctx;
+    args.any = 1;
+    args.best = SIZE_MAX;
+    _vector_search(&args, vec->length, _vector_search_run);
+    vector_unlock((vector*)vec);
+    return args.best != SIZE_MAX;
+}
+
+/* Copies src elements selected by an index vector */
+VECTOR_API int (vector_gather)(vector* dst, const vector* src, const vector* indices)
+{
+    if (!dst || !src || !indices)
+    {
+        _vector_error(VECTOR_ERR_NULL, "NULL vector");
+        return -1;
+    }
+    if (dst == src || dst == indices || dst->element_size != src->element_size ||
+        (indices->element_size != 4 && indices->element_size != 8))
+    {
+        _vector_error(VECTOR_ERR_ARGS, "Gather needs a separate destination, equal "
+                      "element sizes (%zu, %zu) and 4 or 8 byte indices (%zu)",
+                      dst->element_size, src->element_size, indices->element_size);
+        return -1;
+    }
+    _vector_lock_ordered3(dst, 1, (vector*)src, 0, (vector*)indices, 0);
+    size_t n = indices->length;
+    int narrow = _vector_index_check(indices, src->length);
+    if (narrow == -1)
+    {
+        _vector_unlock_ordered3(dst, (vector*)src, (vector*)indices);
+        return -1;
+    }
+    if (_vector_reserve_internal(dst, n) == -1)
+    {
+        _vector_unlock_ordered3(dst, (vector*)src, (vector*)indices);
+        _vector_error(VECTOR_ERR_NOMEM, "Failed to allocate %zu elements", n);
+        return -1;
+    }
+    if (dst->length != n)
+    {
+        dst->length = n;
+        _VECTOR_TRACE(VECTOR_TRACE_RESIZE, dst, 0, n);
+    }
+    _vector_gather_range((char*)dst->data, (const char*)src->data, indices->data, n,
+                         dst->element_size, indices->element_size, narrow);
+    _vector_unlock_ordered3(dst, (vector*)src, (vector*)indices);
+    return 0;
+}
+
+/* Stores src elements at the positions of an index vector */
+VECTOR_API int (vector_scatter)(vector* dst, const vector* indices, const vector* src)
+{
+    if (!dst || !src || !indices)
+    {
+        _vector_error(VECTOR_ERR_NULL, "NULL vector");
+        return -1;
+    }
+    if (dst == src || dst == indices || dst->element_size != src->element_size ||
+        (indices->element_size != 4 && indices->element_size != 8))
+    {
+        _vector_error(VECTOR_ERR_ARGS, "Scatter needs a separate destination, equal "
+                      "element sizes (%zu, %zu) and 4 or 8 byte indices (%zu)",
+                      dst->element_size, src->element_size, indices->element_size);
+        return -1;
+    }
+    _vector_lock_ordered3(dst, 1, (vector*)src, 0, (vector*)indices, 0);
+    if (indices->length != src->length)
+    {
+        _vector_unlock_ordered3(dst, (vector*)src, (vector*)indices);
+        _vector_error(VECTOR_ERR_ARGS, "Scatter of %zu elements with %zu indices",
+                      src->length, indices->length);
+        return -1;
+    }
+    int narrow = _vector_index_check(indices, dst->length);
+    if (narrow == -1)
+    {
+        _vector_unlock_ordered3(dst, (vector*)src, (vector*)indices);
+        return -1;
+    }
+    _vector_scatter_range((char*)dst->data, (const char*)src->data, indices->data,
+                          src->length, dst->element_size, indices->element_size,
+                          narrow);
+    _vector_unlock_ordered3(dst, (vector*)src, (vector*)indices);
+    return 0;
+}
+
+/* Frees vector and its data */
+VECTOR_API void (vector_free)(vector* vec)
+{
+    if (vec)
+    {
+        _VECTOR_TRACE(VECTOR_TRACE_FREE, vec, 0, 0);
+        _vector_registry_remove(vec);
+        _vector_alloc_site_release(vec);
+        vector_wrlock(vec);
+        if (vec->data)
+            vec->allocator.free(vec->data);
+        vector_unlock(vec);
+#if defined(_WIN32)
+        /* SRWLOCK does not require destruction */
+#elif defined(__linux__)
+        pthread_rwlock_destroy(&vec->rwlock);
+#endif
+        free(vec);
+    }
+}
+
+/* Creates a vector that takes ownership of an existing buffer, no copy */
+VECTOR_API vector* vector_from_buffer(void* data, size_t length, size_t capacity,
+                                      size_t element_size,
+                                      const vector_allocator* allocator)
+{
+    size_t bytes;
+    if ((!data && capacity) || length > capacity || element_size == 0 ||
+        (allocator && (!allocator->alloc || !allocator->realloc ||
+                       !allocator->free)))
+    {
+        _vector_error(VECTOR_ERR_ARGS, "Invalid buffer: length %zu, capacity %zu, "
+                      "element_size %zu", length, capacity, element_size);
+        return NULL;
+    }
+    if (_safe_mul(capacity, element_size, &bytes) == -1)
+    {
+        _vector_error(VECTOR_ERR_OVERFLOW,
+                      "Overflow in buffer size: capacity %zu * element_size %zu",
+                      capacity, element_size);
+        return NULL;
+    }
+    return _vector_create_adopt(element_size, data, length, capacity, allocator);
+}
+
+/* Detaches the data buffer and hands ownership to the caller */
+VECTOR_API void* (vector_release_buffer)(vector* vec, size_t* length, size_t* capacity)
+{
+    if (length)
+        *length = 0;
+    if (capacity)
+        *capacity = 0;
+    if (!vec)
+    {
+        _vector_error(VECTOR_ERR_NULL, "NULL vector");
+        return NULL;
+    }
+    vector_wrlock(vec);
+    void* data = vec->data;
+    if (length)
+        *length = vec->length;
+    if (capacity)
+        *capacity = vec->capacity;
+    _VECTOR_TRACE(VECTOR_TRACE_RELEASE, vec, 0, vec->length);
+    vec->data = NULL;
+    vec->length = 0;
+    vec->capacity = 0;
+    _vector_registry_charge(vec);
+    _vector_alloc_site_release(vec);
+    vector_unlock(vec);
+    return data;
+}
+
+/* Exchanges the contents of two vectors in O(1), without copying elements */
+VECTOR_API int (vector_swap_contents)(vector* a, vector* b)
+{
+    if (!a || !b)
+    {
+        _vector_error(VECTOR_ERR_NULL, "NULL vector");
+        return -1;
+    }
+    if (a->element_size != b->element_size)
+    {
+        _vector_error(VECTOR_ERR_ARGS, "Element size mismatch: %zu vs %zu",
+                      a->element_size, b->element_size);
+        return -1;
+    }
+    if (a == b)
+        return 0;
+    _vector_lock_ordered(a, 1, b, 1);
+    _vector_exchange_buffers(a, b);
+    _VECTOR_TRACE(VECTOR_TRACE_SWAP_CONTENTS, a, b->trace_id, 0);
+    _vector_unlock_ordered(a, b);
+    return 0;
+}
+
+/* Moves the contents of src into dst in O(1); src is left empty */
+VECTOR_API int (vector_move)(vector* dst, vector* src)
+{
+    if (!dst || !src)
+    {
+        _vector_error(VECTOR_ERR_NULL, "NULL vector");
+        return -1;
+    }
+    if (dst->element_size != src->element_size)
+    {
+        _vector_error(VECTOR_ERR_ARGS, "Element size mismatch: %zu vs %zu",
+                      dst->element_size, src->element_size);
+        return -1;
+    }
+    if (dst == src)
+        return 0;
+    _vector_lock_ordered(dst, 1, src, 1);
+    _vector_exchange_buffers(dst, src);
+    /* src now holds dst's old buffer; free it and leave src empty */
+    if (src->data)
+        src->allocator.free(src->data);
+    src->data = NULL;
+    src->length = 0;
+    src->capacity = 0;
+    src->allocator = dst->allocator;
+    _vector_registry_charge(src);
+    _vector_alloc_site_release(src);
+    _VECTOR_TRACE(VECTOR_TRACE_MOVE, dst, src->trace_id, dst->length);
+    _vector_unlock_ordered(dst, src);
+    return 0;
+}
+
+/* Inserts count elements from an array at index in one locked operation */
+VECTOR_API int (vector_insert_array)(vector* vec, size_t index, const void* values,
+                                     size_t count)
+{
+    if (!vec || (!values && count))
+    {
+        _vector_error(VECTOR_ERR_NULL, "NULL vector or values");
+        return -1;
+    }
+    vector_wrlock(vec);
+    /* A source inside our own buffer would be shifted by the memmove */
+    const char* data = (const char*)vec->data;
+    void* copy = NULL;
+    if (count && data && (const char*)values >= data &&
+        (const char*)values < data + vec->capacity * vec->element_size)
+    {
+        copy = malloc(count * vec->element_size);
+        if (!copy)
+        {
+            vector_unlock(vec);
+            _vector_error(VECTOR_ERR_NOMEM, "Failed to insert into vector");
+            return -1;
+        }
+        memcpy(copy, values, count * vec->element_size);
+        values = copy;
+    }
+    int result = _vector_insert_internal(vec, index, count, values);
+    if (result == -1)
+        _vector_error(index > vec->length ? VECTOR_ERR_BOUNDS : VECTOR_ERR_NOMEM,
+                      "Failed to insert %zu elements at index %zu (length: %zu)",
+                      count, index, vec->length);
+    else
+        _VECTOR_TRACE(VECTOR_TRACE_INSERT, vec, index, count);
+    vector_unlock(vec);
+    free(copy);
+    return result;
+}
+
+/* Removes elements from index */
+VECTOR_API int (vector_remove)(vector* vec, size_t index, size_t num_elements)
+{
+    if (!vec)
+    {
+        _vector_error(VECTOR_ERR_NULL, "NULL vector");
+        return -1;
+    }
+    vector_wrlock(vec);
+    int result = _vector_remove_internal(vec, index, num_elements);
+    if (result == 0)
+        _VECTOR_TRACE(VECTOR_TRACE_REMOVE, vec, index, num_elements);
+    vector_unlock(vec);
+    return result;
+}
+
+/* Reserves capacity for vector */
+VECTOR_API int (vector_reserve)(vector* vec, size_t new_capacity)
+{
+    if (!vec)
+    {
+        _vector_error(VECTOR_ERR_NULL, "NULL vector");
+        return -1;
+    }
+    vector_wrlock(vec);
+    int result = _vector_reserve_internal(vec, new_capacity);
+    if (result == 0)
+        _VECTOR_TRACE(VECTOR_TRACE_RESERVE, vec, 0, new_capacity);
+    vector_unlock(vec);
+    return result;
+}
+
+/* Resizes vector to new length */
+VECTOR_API int (vector_resize)(vector* vec, size_t new_length)
+{
+    if (!vec)
+    {
+        _vector_error(VECTOR_ERR_NULL, "NULL vector");
+        return -1;
+    }
+    vector_wrlock(vec);
+    int result = _vector_resize_internal(vec, new_length);
+    if (result == 0)
+        _VECTOR_TRACE(VECTOR_TRACE_RESIZE, vec, 0, new_length);
+    vector_unlock(vec);
+    return result;
+}
+
+/* Serializes vector to file */
+VECTOR_API int (vector_serialize)(const vector* vec, FILE* fp)
+{
+    if (!vec || !fp)
+    {
+        _vector_error(VECTOR_ERR_NULL, "NULL vector or file pointer");
+        return -1;
+    }
+    vector_rdlock((vector*)vec);
+    int result = _vector_serialize_internal(vec, fp);
+    if (result == 0)
+        _VECTOR_TRACE(VECTOR_TRACE_SERIALIZE, vec, 0, vec->length);
+    vector_unlock((vector*)vec);
+    return result;
+}
+
+/* Deserializes vector from file */
+VECTOR_API vector* vector_deserialize(FILE* fp, size_t element_size)
+{
+    if (!fp)
+    {
+        _vector_error(VECTOR_ERR_NULL, "NULL file pointer");
+        return NULL;
+    }
+    vector* vec = _vector_deserialize_internal(fp, element_size);
+    if (vec)
+        _VECTOR_TRACE(VECTOR_TRACE_DESERIALIZE, vec, 0, vec->length);
+    return vec;
+}
+
+/* Shrinks vector capacity to length */
+VECTOR_API int (vector_shrink_to_fit)(vector* vec)
+{
+    if (!vec)
+    {
+        _vector_error(VECTOR_ERR_NULL, "NULL vector");
+        return -1;
+    }
+    vector_wrlock(vec);
+    int result = _vector_shrink_to_fit_internal(vec);
+    if (result == 0)
+        _VECTOR_TRACE(VECTOR_TRACE_SHRINK, vec, 0, 0);
+    vector_unlock(vec);
+    return result;
+}
+
+/* Swaps two elements in vector */
+VECTOR_API int (vector_swap)(vector* vec, size_t idx1, size_t idx2)
+{
+    if (!vec)
+    {
+        _vector_error(VECTOR_ERR_NULL, "NULL vector");
+        return -1;
+    }
+    vector_wrlock(vec);
+    int result = _vector_swap_internal(vec, idx1, idx2);
+    if (result == 0)
+        _VECTOR_TRACE(VECTOR_TRACE_SWAP, vec, idx1, idx2);
+    vector_unlock(vec);
+    return result;
+}
+
+/* Returns a view of count elements starting at start */
+VECTOR_API vector_view (vector_slice)(const vector* vec, size_t start, size_t count)
+{
+    vector_view view = {NULL, 0, vec ? vec->element_size : 0};
+    if (!vec)
+    {
+        _vector_error(VECTOR_ERR_NULL, "NULL vector");
+        return view;
+    }
+    vector_rdlock((vector*)vec);
+    size_t end;
+    if (_safe_add(start, count, &end) == -1 || end > vec->length)
+        _vector_error(VECTOR_ERR_BOUNDS, "Slice [%zu, +%zu) out of bounds "
+                      "(length: %zu)", start, count, vec->length);
+    else if (count)
+    {
+        view.data = (const char*)vec->data + start * vec->element_size;
+        view.length = count;
+    }
+    vector_unlock((vector*)vec);
+    return view;
+}
+
+/* Returns a view of all elements */
+VECTOR_API vector_view (vector_view_of)(const vector* vec)
+{
+    vector_view view = {NULL, 0, vec ? vec->element_size : 0};
+    if (!vec)
+    {
+        _vector_error(VECTOR_ERR_NULL, "NULL vector");
+        return view;
+    }
+    vector_rdlock((vector*)vec);
+    if (vec->length)
+    {
+        view.data = vec->data;
+        view.length = vec->length;
+    }
+    vector_unlock((vector*)vec);
+    return view;
+}
+
+/* Returns a view of count elements of view starting at start */
+VECTOR_API vector_view vector_view_sub(vector_view view, size_t start, size_t count)
+{
+    vector_view sub = {NULL, 0, view.element_size};
+    size_t end;
+    if (_safe_add(start, count, &end) == -1 || end > view.length)
+        _vector_error(VECTOR_ERR_BOUNDS, "Slice [%zu, +%zu) out of bounds "
+                      "(length: %zu)", start, count, view.length);
+    else if (count)
+    {
+        sub.data = (const char*)view.data + start * view.element_size;
+        sub.length = count;
+    }
+    return sub;
+}
+
+/* Folds the elements of a view into an accumulator, in order */
+VECTOR_API int vector_view_reduce(vector_view view,
+                                  void (*fn)(void* acc, const void* elem, void* ctx),
+                                  void* acc, void* ctx)
+{
+    if (!fn)
+    {
+        _vector_error(VECTOR_ERR_NULL, "NULL reduce function");
+        return -1;
+    }
+    const char* elem = (const char*)view.data;
+    for (size_t i = 0; i < view.length; ++i, elem += view.element_size)
+        fn(acc, elem, ctx);
+    return 0;
+}
+
+/* Serializes a view to file in the vector_serialize format */
+VECTOR_API int vector_view_serialize(vector_view view, FILE* fp)
+{
+    if (!fp)
+    {
+        _vector_error(VECTOR_ERR_NULL, "NULL file pointer");
+        return -1;
+    }
+    return _vector_serialize_range(view.data, view.data, view.length,
+                                   view.element_size, fp);
+}
+
+/* Copies the vector's statistics counters */
+VECTOR_API int vector_get_stats(const vector* vec, vector_stats* out)
+{
+    if (!out)
+        return -1;
+    memset(out, 0, sizeof(*out));
+    if (!vec)
+        return -1;
+#if defined(VECTOR_STATS)
+    out->reallocations = _VECTOR_STAT_LOAD(vec, reallocations);
+    out->growth_bytes_copied = _VECTOR_STAT_LOAD(vec, growth_bytes_copied);
+    out->memmove_bytes = _VECTOR_STAT_LOAD(vec, memmove_bytes);
+    out->peak_capacity = _VECTOR_STAT_LOAD(vec, peak_capacity);
+    out->lock_acquisitions = _VECTOR_STAT_LOAD(vec, lock_acquisitions);
+    out->lock_contentions = _VECTOR_STAT_LOAD(vec, lock_contentions);
+    out->lock_wait_ns = _VECTOR_STAT_LOAD(vec, lock_wait_ns);
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+/* Resets the vector's statistics counters; peak restarts at current capacity */
+VECTOR_API int (vector_reset_stats)(vector* vec)
+{
+    if (!vec)
+        return -1;
+#if defined(VECTOR_STATS)
+    vector_wrlock(vec);
+    memset(&vec->stats, 0, sizeof(vec->stats));
+    vec->stats.peak_capacity = vec->capacity;
+    vector_unlock(vec);
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+/* Returns the upper bound of the bucket holding the p-th percentile wait */
+VECTOR_API uint64_t vector_lock_histogram_percentile(const vector_lock_histogram* hist,
+                                                     double p)
+{
+    if (!hist || hist->count == 0)
+        return 0;
+    uint64_t rank = (uint64_t)((p / 100.0) * (double)hist->count + 0.5);
+    if (rank == 0)
+        rank = 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < VECTOR_LOCK_HIST_BUCKETS; ++i)
+    {
+        seen += hist->buckets[i];
+        if (seen >= rank)
+        {
+            uint64_t upper = _vector_lock_hist_upper(i);
+            return upper < hist->max_ns ? upper : hist->max_ns;
+        }
+    }
+    return hist->max_ns;
+}
+
+/* Copies a vector's contended lock wait histograms */
+VECTOR_API int vector_lock_profile_get(const vector* vec, vector_lock_histogram* rd,
+                                       vector_lock_histogram* wr)
+{
+    vector_lock_histogram* out[2] = {rd, wr};
+    for (int mode = 0; mode < 2; ++mode)
+        if (out[mode])
+            memset(out[mode], 0, sizeof(*out[mode]));
+    if (!vec)
+        return -1;
+#if defined(VECTOR_LOCK_PROFILE)
+    for (int mode = 0; mode < 2; ++mode)
+        if (out[mode])
+            _vector_lock_hist_copy(out[mode], &vec->lock_wait[mode]);
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+/* Prints one vector's read and write wait distributions */
+VECTOR_API int vector_lock_profile_dump_vector(const vector* vec, const char* name,
+                                               FILE* fp)
+{
+    vector_lock_histogram hist[2];
+    if (!fp || vector_lock_profile_get(vec, &hist[0], &hist[1]) == -1)
+        return -1;
+    for (int mode = 0; mode < 2; ++mode)
+        _vector_lock_hist_print(fp, name ? name : "vector", 0,
+                                mode ? "write" : "read", &hist[mode]);
+    return 0;
+}
+
+/* Prints every callsite that waited for a lock, longest total wait first */
+VECTOR_API int vector_lock_profile_dump(FILE* fp)
+{
+    if (!fp)
+        return -1;
+#if defined(VECTOR_LOCK_PROFILE)
+    size_t order[VECTOR_LOCK_PROFILE_SITES];
+    size_t count = 0;
+    for (size_t i = 0; i < VECTOR_LOCK_PROFILE_SITES; ++i)
+    {
+        if (!__atomic_load_n(&_vector_lock_sites[i].used, __ATOMIC_ACQUIRE))
+            continue;
+        /* Insertion sort by total wait, descending */
+        uint64_t total = _vector_lock_sites[i].hist.total_ns;
+        size_t j = count++;
+        while (j > 0 && _vector_lock_sites[order[j - 1]].hist.total_ns < total)
+        {
+            order[j] = order[j - 1];
+            --j;
+        }
+        order[j] = i;
+    }
+    fprintf(fp, "%-40s %6s %10s %12s %10s %10s %10s %10s %10s\n",
+            "callsite", "mode", "waits", "total_ns", "mean_ns",
+            "p50_ns", "p99_ns", "p999_ns", "max_ns");
+    for (size_t k = 0; k < count; ++k)
+    {
+        vector_lock_histogram hist;
+        const struct _vector_lock_site* site = &_vector_lock_sites[order[k]];
+        _vector_lock_hist_copy(&hist, &site->hist);
+        _vector_lock_hist_print(fp, site->file, site->line,
+                                site->write ? "write" : "read", &hist);
+    }
+    uint64_t dropped = __atomic_load_n(&_vector_lock_sites_dropped, __ATOMIC_RELAXED);
+    if (dropped)
+        fprintf(fp, "(%llu waits dropped: callsite table full)\n",
+                (unsigned long long)dropped);
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+/* Tags a vector for registry accounting; its capacity moves to the new tag */
+VECTOR_API int (vector_set_tag)(vector* vec, const char* tag)
+{
+    if (!vec)
+        return -1;
+#if defined(VECTOR_REGISTRY)
+    vector_wrlock(vec);
+    struct _vector_tag* old_tag = vec->registry.tag;
+    struct _vector_tag* new_tag = _vector_registry_tag_get(tag);
+    if (new_tag != old_tag)
+    {
+        size_t bytes = vec->registry.accounted_bytes;
+        __atomic_fetch_sub(&old_tag->capacity_bytes, bytes, __ATOMIC_RELAXED);
+        __atomic_fetch_sub(&old_tag->live_vectors, 1, __ATOMIC_RELAXED);
+        size_t now = __atomic_add_fetch(&new_tag->capacity_bytes, bytes,
+                                        __ATOMIC_RELAXED);
+        _vector_atomic_max_size(&new_tag->capacity_bytes_peak, now);
+        __atomic_fetch_add(&new_tag->live_vectors, 1, __ATOMIC_RELAXED);
+        vec->registry.tag = new_tag;
+    }
+    vector_unlock(vec);
+    return 0;
+#else
+    (void)tag;
+    return -1;
+#endif
+}
+
+/* Calls fn for every live vector; stops early if fn returns non-zero */
+VECTOR_API int vector_registry_foreach(int (*fn)(const vector_registry_entry* entry,
+                                                 void* ctx),
+                                       void* ctx)
+{
+    if (!fn)
+        return -1;
+#if defined(VECTOR_REGISTRY)
+    _vector_mutex_lock(&_vector_registry_mutex);
+    for (vector* vec = _vector_registry_head; vec; vec = vec->registry.next)
+    {
+        vector_registry_entry entry;
+        entry.vec = vec;
+        entry.tag = vec->registry.tag->name;
+        entry.element_size = vec->element_size;
+        entry.length = __atomic_load_n(&vec->length, __ATOMIC_RELAXED);
+        entry.capacity = __atomic_load_n(&vec->capacity, __ATOMIC_RELAXED);
+        if (entry.length > entry.capacity)
+            entry.length = entry.capacity;
+        entry.used_bytes = entry.length * entry.element_size;
+        entry.capacity_bytes = entry.capacity * entry.element_size;
+        entry.slack_bytes = entry.capacity_bytes - entry.used_bytes;
+        if (fn(&entry, ctx))
+            break;
+    }
+    _vector_mutex_unlock(&_vector_registry_mutex);
+    return 0;
+#else
+    (void)ctx;
+    return -1;
+#endif
+}
+
+/* Calls fn for every registry tag that has ever held a vector */
+VECTOR_API int vector_registry_foreach_tag(int (*fn)(const vector_registry_tag_stats* stats,
+                                                     void* ctx),
+                                           void* ctx)
+{
+    if (!fn)
+        return -1;
+#if defined(VECTOR_REGISTRY)
+    for (size_t i = 0; i < VECTOR_REGISTRY_TAGS; ++i)
+    {
+        struct _vector_tag* slot = &_vector_registry_tags[i];
+        if (!__atomic_load_n(&slot->used, __ATOMIC_ACQUIRE))
+            continue;
+        vector_registry_tag_stats stats;
+        stats.tag = slot->name;
+        stats.live_vectors = __atomic_load_n(&slot->live_vectors, __ATOMIC_RELAXED);
+        stats.capacity_bytes = __atomic_load_n(&slot->capacity_bytes, __ATOMIC_RELAXED);
+        stats.capacity_bytes_peak = __atomic_load_n(&slot->capacity_bytes_peak,
+                                                    __ATOMIC_RELAXED);
+        stats.grown_bytes = __atomic_load_n(&slot->grown_bytes, __ATOMIC_RELAXED);
+        if (fn(&stats, ctx))
+            break;
+    }
+    return 0;
+#else
+    (void)ctx;
+    return -1;
+#endif
+}
+
+#if defined(VECTOR_REGISTRY)
+/* Accumulates used bytes for vector_registry_get_totals */
+static int _vector_registry_sum_used(const vector_registry_entry* entry, void* ctx)
+{
+    *(size_t*)ctx += entry->used_bytes;
+    return 0;
+}
+#endif
+
+/* Reads registry-wide totals; used and slack bytes are summed by a walk */
+VECTOR_API int vector_registry_get_totals(vector_registry_totals* out)
+{
+    if (!out)
+        return -1;
+    memset(out, 0, sizeof(*out));
+#if defined(VECTOR_REGISTRY)
+    size_t used = 0;
+    vector_registry_foreach(_vector_registry_sum_used, &used);
+    out->live_vectors = __atomic_load_n(&_vector_registry_live, __ATOMIC_RELAXED);
+    out->live_vectors_peak = __atomic_load_n(&_vector_registry_live_peak,
+                                             __ATOMIC_RELAXED);
+    out->capacity_bytes = __atomic_load_n(&_vector_registry_capacity,
+                                          __ATOMIC_RELAXED);
+    out->capacity_bytes_peak = __atomic_load_n(&_vector_registry_capacity_peak,
+                                               __ATOMIC_RELAXED);
+    out->used_bytes = used;
+    out->slack_bytes = out->capacity_bytes > used ? out->capacity_bytes - used : 0;
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+/* Calls fn for every allocation callsite in the requested order; stops */
+VECTOR_API int vector_alloc_sites_foreach(int (*fn)(const vector_alloc_site_stats* stats,
+                                                    void* ctx),
+                                          void* ctx, vector_alloc_sort order)
+{
+    if (!fn)
+        return -1;
+#if defined(VECTOR_ALLOC_SITES)
+    static const size_t unknown = VECTOR_ALLOC_SITES_MAX;
+    size_t index[VECTOR_ALLOC_SITES_MAX + 1];
+    uint64_t key[VECTOR_ALLOC_SITES_MAX + 1];
+    size_t count = 0;
+    for (size_t i = 0; i <= VECTOR_ALLOC_SITES_MAX; ++i)
+    {
+        const struct _vector_alloc_site* site =
+            i == unknown ? &_vector_alloc_site_unknown : &_vector_alloc_sites[i];
+        if (!__atomic_load_n(&site->used, __ATOMIC_ACQUIRE))
+            continue;
+        /* Insertion sort by the requested key, descending */
+        uint64_t k = order == VECTOR_ALLOC_SORT_CHURN ?
+                     __atomic_load_n(&site->realloc_bytes, __ATOMIC_RELAXED) :
+                     __atomic_load_n(&site->live_bytes, __ATOMIC_RELAXED);
+        size_t j = count++;
+        while (j > 0 && key[j - 1] < k)
+        {
+            index[j] = index[j - 1];
+            key[j] = key[j - 1];
+            --j;
+        }
+        index[j] = i;
+        key[j] = k;
+    }
+    for (size_t k = 0; k < count; ++k)
+    {
+        vector_alloc_site_stats stats;
+        _vector_alloc_site_copy(&stats, index[k] == unknown ?
+                                        &_vector_alloc_site_unknown :
+                                        &_vector_alloc_sites[index[k]]);
+        if (stats.allocations == 0 && stats.reallocations == 0)
+            continue;
+        if (fn(&stats, ctx))
+            break;
+    }
+    return 0;
+#else
+    (void)ctx;
+    (void)order;
+    return -1;
+#endif
+}
+
+/* Prints one allocation callsite row for vector_alloc_sites_dump */
+static int _vector_alloc_site_print(const vector_alloc_site_stats* stats, void* ctx)
+{
+    char label[64];
+    if (stats->file)
+        snprintf(label, sizeof(label), "%s:%d", stats->file, stats->line);
+    else
+        snprintf(label, sizeof(label), "(unattributed)");
+    fprintf((FILE*)ctx, "%-40s %8zu %14zu %14zu %8llu %10llu %16llu\n", label,
+            stats->live_vectors, stats->live_bytes, stats->live_bytes_peak,
+            (unsigned long long)stats->allocations,
+            (unsigned long long)stats->reallocations,
+            (unsigned long long)stats->realloc_bytes);
+    return 0;
+}
+
+/* Prints every allocation callsite, sorted by live bytes or realloc churn */
+VECTOR_API int vector_alloc_sites_dump(FILE* fp, vector_alloc_sort order)
+{
+    if (!fp)
+        return -1;
+#if defined(VECTOR_ALLOC_SITES)
+    fprintf(fp, "%-40s %8s %14s %14s %8s %10s %16s\n", "callsite", "vectors",
+            "live_bytes", "peak_bytes", "creates", "reallocs", "realloc_bytes");
+#endif
+    return vector_alloc_sites_foreach(_vector_alloc_site_print, fp, order);
+}
+
+/* Starts recording every vector operation to a binary trace file */
+VECTOR_API int vector_trace_start(const char* path)
+{
+    if (!path)
+    {
+        _vector_error(VECTOR_ERR_NULL, "NULL trace path");
+        return -1;
+    }
+#if defined(VECTOR_TRACE)
+    _vector_mutex_lock(&_vector_trace_mutex);
+    if (_vector_trace_state.active)
+    {
+        _vector_mutex_unlock(&_vector_trace_mutex);
+        _vector_error(VECTOR_ERR_ARGS, "Trace already active");
+        return -1;
+    }
+    FILE* fp = fopen(path, "wb");
+    vector_trace_header header;
+    memcpy(header.magic, VECTOR_TRACE_MAGIC, sizeof(header.magic));
+    header.version = VECTOR_TRACE_VERSION;
+    header.record_size = sizeof(vector_trace_record);
+    if (!fp || fwrite(&header, sizeof(header), 1, fp) != 1)
+    {
+        if (fp)
+            fclose(fp);
+        _vector_mutex_unlock(&_vector_trace_mutex);
+        _vector_error(VECTOR_ERR_IO, "Failed to open trace file");
+        return -1;
+    }
+    _vector_trace_state.fp = fp;
+    _vector_trace_state.failed = 0;
+    _vector_trace_state.used = 0;
+    _vector_trace_state.start_ns = _vector_now_ns();
+    __atomic_store_n(&_vector_trace_state.active, 1, __ATOMIC_RELEASE);
+    _vector_mutex_unlock(&_vector_trace_mutex);
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+/* Stops recording and closes the trace file */
+VECTOR_API int vector_trace_stop(void)
+{
+#if defined(VECTOR_TRACE)
+    _vector_mutex_lock(&_vector_trace_mutex);
+    if (!_vector_trace_state.active)
+    {
+        _vector_mutex_unlock(&_vector_trace_mutex);
+        return -1;
+    }
+    __atomic_store_n(&_vector_trace_state.active, 0, __ATOMIC_RELAXED);
+    _vector_trace_flush_locked();
+    if (fclose(_vector_trace_state.fp) != 0)
+        _vector_trace_state.failed = 1;
+    _vector_trace_state.fp = NULL;
+    int failed = _vector_trace_state.failed;
+    _vector_mutex_unlock(&_vector_trace_mutex);
+    if (failed)
+    {
+        _vector_error(VECTOR_ERR_IO, "Failed to write trace file");
+        return -1;
+    }
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+/* Returns the last error recorded on the calling thread */
+VECTOR_API vector_error_code vector_last_error(void)
+{
+    return _vector_last_error.code;
+}
+
+/* Clears the calling thread's last error */
+VECTOR_API void vector_clear_error(void)
+{
+    _vector_last_error.code = VECTOR_OK;
+    _vector_last_error.format = NULL;
+}
+
+/* Returns a static description of an error code */
+VECTOR_API const char* vector_error_string(vector_error_code code)
+{
+    switch (code)
+    {
+    case VECTOR_OK:           return "No error";
+    case VECTOR_ERR_NULL:     return "NULL vector or argument";
+    case VECTOR_ERR_BOUNDS:   return "Index out of bounds";
+    case VECTOR_ERR_EMPTY:    return "Vector is empty";
+    case VECTOR_ERR_OVERFLOW: return "Size overflow";
+    case VECTOR_ERR_NOMEM:    return "Out of memory";
+    case VECTOR_ERR_ARGS:     return "Invalid argument";
+    case VECTOR_ERR_IO:       return "I/O error";
+    case VECTOR_ERR_LOCK:     return "Lock initialization failed";
+    }
+    return "Unknown error";
+}
+
+/* Formats the calling thread's last error message */
+VECTOR_API size_t vector_last_error_message(char* buf, size_t size)
+{
+    const struct _vector_error_state* err = &_vector_last_error;
+    if (err->code == VECTOR_OK)
+    {
+        if (buf && size)
+            buf[0] = '\0';
+        return 0;
+    }
+    int len = snprintf(buf, size, err->format ? err->format :
+                       vector_error_string(err->code),
+                       err->args[0], err->args[1], err->args[2]);
+    return len < 0 ? 0 : (size_t)len;
+}
+
+/* Internal Functions */
+
+/* Appends values to vector */
+/* Args: vec - vector pointer, num_values - count, values - data to append */
+/* Returns: 0 on success, -1 on failure */
+VECTOR_API int _vector_append_internal(vector* vec, size_t num_values,
+                                       const void* values)
+{
+    if (!vec)
+        return -1;
+    if (num_values == 0)
+        return 0;
+
+    size_t total_elements;
+    if (_safe_add(vec->length, num_values, &total_elements) == -1)
+        return -1;
+
+    if (total_elements > vec->capacity &&
+        _vector_grow_internal(vec, total_elements) == -1)
+        return -1;
+    memcpy((char*)vec->data + vec->length * vec->element_size, values,
+           num_values * vec->element_size);
+    vec->length = total_elements;
+    return 0;
+}
+
+/* Grows the length by num_values without initializing the new elements */
+/* Args: vec - vector pointer, num_values - count */
+/* Returns: pointer to the first new element, NULL on failure or if 0 */
+static void* _vector_append_uninit_internal(vector* vec, size_t num_values)
+{
+    if (!vec || num_values == 0)
+        return NULL;
+
+    size_t total_elements;
+    if (_safe_add(vec->length, num_values, &total_elements) == -1)
+        return NULL;
+
+    if (total_elements > vec->capacity &&
+        _vector_grow_internal(vec, total_elements) == -1)
+        return NULL;
+    void* slots = (char*)vec->data + vec->length * vec->element_size;
+    vec->length = total_elements;
+    return slots;
+}
+
+/* Block size the fill doubles up to; larger fills repeat the first block */
+/* so the copy source stays in L1 */
+#ifndef _VECTOR_FILL_BLOCK
+#define _VECTOR_FILL_BLOCK 16384
+#endif
+
+/* Stores count copies of value at dst */
+/* Args: dst - destination, value - element bytes, count - elements, */
+/*       element_size - bytes per element (count * element_size must fit) */
+static void _vector_fill_bytes(void* dst, const void* value, size_t count,
+                               size_t element_size)
+{
+    if (count == 0 || element_size == 0)
+        return;
+    const unsigned char* bytes = (const unsigned char*)value;
+    size_t i = 1;
+    while (i < element_size && bytes[i] == bytes[0])
+        ++i;
+    size_t total = count * element_size;
+    if (i == element_size)
+    {
+        memset(dst, bytes[0], total);
+        return;
+    }
+    size_t block = _VECTOR_FILL_BLOCK - _VECTOR_FILL_BLOCK % element_size;
+    if (block == 0)
+        block = element_size;
+    memcpy(dst, value, element_size);
+    size_t done = element_size;
+    while (done < total)
+    {
+        size_t chunk = done < block ? done : block;
+        if (chunk > total - done)
+            chunk = total - done;
+        memcpy((char*)dst + done, dst, chunk);
+        done += chunk;
+    }
+}
+
+/* Grows capacity geometrically (1.5x) to hold at least needed elements */
+/* Args: vec - vector pointer, needed - minimum capacity */
+/* Returns: 0 on success, -1 on failure */
+static int _vector_grow_internal(vector* vec, size_t needed)
+{
+    size_t new_capacity = vec->capacity + vec->capacity / 2;
+    if (new_capacity < needed)
+        new_capacity = needed;
+    return _vector_reserve_internal(vec, new_capacity);
+}
+
+/* Compares elements ascending */
+/* Args: a - first element, b - second element, context - vector pointer */
+/* Returns: -1 if a < b, 1 if a > b, 0 if equal */
+VECTOR_API int _vector_compare_asc(const void* a, const void* b, void* context)
+{
+    vector* vec = (vector*)context;
+    const char* ptr_a = (const char*)a;
+    const char* ptr_b = (const char*)b;
+    for (size_t i = 0; i < vec->element_size; ++i)
+    {
+        if (ptr_a[i] < ptr_b[i])
+            return -1;
+        if (ptr_a[i] > ptr_b[i])
+            return 1;
+    }
+    return 0;
+}
+
+/* Compares elements descending */
+/* Args: a - first element, b - second element, context - vector pointer */
+/* Returns: -1 if b < a, 1 if b > a, 0 if equal */
+VECTOR_API int _vector_compare_desc(const void* a, const void* b, void* context)
+{
+    vector* vec = (vector*)context;
+    const char* ptr_a = (const char*)a;
+    const char* ptr_b = (const char*)b;
+    for (size_t i = 0; i < vec->element_size; ++i)
+    {
+        if (ptr_b[i] < ptr_a[i])
+            return -1;
+        if (ptr_b[i] > ptr_a[i])
+            return 1;
+    }
+    return 0;
+}
+
+/* Checks element equality */
+/* Args: a - first element, b - second element, context - vector pointer */
+/* Returns: 0 if equal, 1 if not equal */
+VECTOR_API int _vector_compare_eq(const void* a, const void* b, void* context)
+{
+    vector* vec = (vector*)context;
+    const char* ptr_a = (const char*)a;
+    const char* ptr_b = (const char*)b;
+    for (size_t i = 0; i < vec->element_size; ++i)
+    {
+        if (ptr_a[i] != ptr_b[i])
+            return 1;
+    }
+    return 0;
+}
+
+/* Creates vector with base settings */
 /* Args: element_size - size of each element, num_elements - initial count */
 /* Returns: new vector pointer, NULL on failure */
-static vector* _vector_create_base(size_t element_size, size_t num_elements)
+static vector* _vector_create_base(size_t element_size, size_t num_elements)
+{
+    return _vector_create_alloc(element_size, num_elements, 1);
+}
+
+/* Creates a vector of num_elements elements, zeroed or left uninitialized */
+/* Args: element_size - size of each element, num_elements - initial length, */
+/*       zeroed - nonzero to calloc the buffer, 0 to malloc it */
+/* Returns: new vector pointer, NULL on failure */
+static vector* _vector_create_alloc(size_t element_size, size_t num_elements,
+                                    int zeroed)
+{
+    size_t alloc_size;
+    if (_safe_mul(element_size, num_elements, &alloc_size) == -1)
+    {
+        _vector_error(VECTOR_ERR_OVERFLOW,
+                      "Overflow in allocation: element_size %zu * num_elements %zu",
+                      element_size, num_elements);
+        return NULL;
+    }
+
+    void* data = NULL;
+    if (alloc_size)
+        data = zeroed ? calloc(num_elements, element_size) : malloc(alloc_size);
+    if (!data && alloc_size > 0)
+    {
+        _vector_error(VECTOR_ERR_NOMEM, "Failed to allocate vector data for %zu bytes",
+                      alloc_size);
+        return NULL;
+    }
+    vector* vec = _vector_create_adopt(element_size, data, num_elements,
+                                       num_elements, NULL);
+    if (!vec)
+        free(data);
+    return vec;
+}
+
+/* Creates a vector around an existing buffer */
+/* Args: element_size - bytes per element, data - buffer (NULL if capacity */
+/*       is 0), length/capacity - in elements, allocator - functions for data, */
+/*       NULL for the defaults */
+/* Returns: new vector pointer, NULL on failure (data is not freed) */
+static vector* _vector_create_adopt(size_t element_size, void* data,
+                                    size_t length, size_t capacity,
+                                    const vector_allocator* allocator)
+{
+    vector* vec = malloc(sizeof(vector));
+    if (!vec)
+    {
+        _vector_error(VECTOR_ERR_NOMEM, "Failed to allocate vector structure");
+        return NULL;
+    }
+
+    if (allocator)
+        vec->allocator = *allocator;
+    else
+    {
+        vec->allocator.alloc = default_alloc;
+        vec->allocator.realloc = default_realloc;
+        vec->allocator.free = default_free;
+    }
+    vec->data = data;
+    vec->length = length;
+    vec->capacity = capacity;
+    vec->element_size = element_size;
+#if defined(VECTOR_STATS)
+    memset(&vec->stats, 0, sizeof(vec->stats));
+    vec->stats.peak_capacity = capacity;
+#endif
+#if defined(VECTOR_LOCK_PROFILE)
+    memset(vec->lock_wait, 0, sizeof(vec->lock_wait));
+#endif
+#if defined(_WIN32)
+    InitializeSRWLock(&vec->rwlock);
+#elif defined(__linux__)
+    if (pthread_rwlock_init(&vec->rwlock, NULL) != 0)
+    {
+        free(vec);
+        _vector_error(VECTOR_ERR_LOCK, "Failed to initialize rwlock");
+        return NULL;
+    }
+#endif
+#if defined(VECTOR_TRACE)
+    vec->trace_id = __atomic_add_fetch(&_vector_trace_next_id, 1, __ATOMIC_RELAXED);
+#endif
+    _vector_registry_add(vec);
+    _vector_alloc_site_charge(vec, 1);
+    _VECTOR_TRACE(VECTOR_TRACE_CREATE, vec, element_size, length);
+    return vec;
+}
+
+/* Creates vector with values */
+/* Args: element_size - size of each element, num_elements - count, */
+/*       arg_count - number of values, values - initial values */
+/* Returns: new vector pointer, NULL on failure */
+VECTOR_API vector* _vector_create_with_values(size_t element_size, size_t num_elements,
+                                              size_t arg_count, const void* values)
 {
-    size_t alloc_size;
-    if (_safe_mul(element_size, num_elements, &alloc_size) == -1)
+    if (arg_count > 1 && arg_count > num_elements)
     {
-        _vector_error("Overflow in allocation: element_size %zu * num_elements %zu",
-                      element_size, num_elements);
+        _vector_error(VECTOR_ERR_ARGS, "Argument count %zu exceeds num_elements %zu",
+                      arg_count, num_elements);
         return NULL;
     }
+    /* Only a zero-initialized vector leaves calloc anything to do */
+    vector* vec = _vector_create_alloc(element_size, num_elements, arg_count == 0);
+    if (!vec)
+        return NULL;
 
-    vector* vec = malloc(sizeof(vector));
+    if (arg_count == 1)
+    {
+        _vector_fill_bytes(vec->data, values, num_elements, element_size);
+    }
+    else if (arg_count > 1)
+    {
+        memcpy(vec->data, values, arg_count * element_size);
+        memset((char*)vec->data + arg_count * element_size, 0,
+               (num_elements - arg_count) * element_size);
+    }
+    return vec;
+}
+
+/* Creates vector without zeroing its elements */
+/* Args: element_size - size of each element, num_elements - initial length */
+/* Returns: new vector pointer, NULL on failure */
+VECTOR_API vector* _vector_create_uninit(size_t element_size, size_t num_elements)
+{
+    return _vector_create_alloc(element_size, num_elements, 0);
+}
+
+/* Overwrites every element with a value */
+/* Args: vec - vector pointer, value - element bytes, */
+/*       element_size - size of value */
+/* Returns: 0 on success, -1 on failure */
+VECTOR_API int _vector_fill_internal(vector* vec, const void* value, size_t element_size)
+{
+    if (!vec || !value)
+    {
+        _vector_error(VECTOR_ERR_NULL, "NULL vector or value");
+        return -1;
+    }
+    if (element_size != vec->element_size)
+    {
+        _vector_error(VECTOR_ERR_ARGS, "Element size mismatch: %zu vs %zu",
+                      element_size, vec->element_size);
+        return -1;
+    }
+    vector_wrlock(vec);
+    _vector_fill_bytes(vec->data, value, vec->length, vec->element_size);
+    _VECTOR_TRACE(VECTOR_TRACE_FILL, vec, 0, vec->length);
+    vector_unlock(vec);
+    return 0;
+}
+
+/* Replaces the contents with count copies of a value */
+/* Args: vec - vector pointer, count - new length, value - element bytes, */
+/*       element_size - size of value */
+/* Returns: 0 on success, -1 on failure */
+VECTOR_API int _vector_assign_n_internal(vector* vec, size_t count, const void* value,
+                                         size_t element_size)
+{
+    if (!vec || !value)
+    {
+        _vector_error(VECTOR_ERR_NULL, "NULL vector or value");
+        return -1;
+    }
+    if (element_size != vec->element_size)
+    {
+        _vector_error(VECTOR_ERR_ARGS, "Element size mismatch: %zu vs %zu",
+                      element_size, vec->element_size);
+        return -1;
+    }
+    vector_wrlock(vec);
+    if (count > vec->capacity)
+    {
+        /* Every old element is overwritten, so a fresh buffer replaces */
+        /* the old one instead of realloc copying it */
+        size_t new_size;
+        void* new_data = NULL;
+        if (_safe_mul(count, vec->element_size, &new_size) == 0)
+            new_data = vec->allocator.alloc(new_size);
+        if (!new_data)
+        {
+            vector_unlock(vec);
+            _vector_error(VECTOR_ERR_NOMEM, "Failed to allocate %zu elements", count);
+            return -1;
+        }
+        size_t old_capacity = vec->capacity;
+        if (vec->data)
+            vec->allocator.free(vec->data);
+        vec->data = new_data;
+        vec->capacity = count;
+        _vector_note_realloc(vec, NULL, old_capacity);
+    }
+    vec->length = count;
+    _vector_fill_bytes(vec->data, value, count, vec->element_size);
+    _VECTOR_TRACE(VECTOR_TRACE_ASSIGN, vec, 0, count);
+    vector_unlock(vec);
+    return 0;
+}
+
+/* Finds element in vector */
+/* Args: vec - vector pointer, value - value to find, element_size - size, */
+/*       compar - comparison function */
+/* Returns: index of element, -1 if not found */
+VECTOR_API ssize_t _vector_find_internal(vector* vec, const void* value,
+                                         size_t element_size,
+                                         int (*compar)(const void*, const void*, void*))
+{
+    return _vector_find_run(vec, value, element_size, compar, 0);
+}
+
+/* Finds element in vector using the worker pool */
+/* Args: as _vector_find_internal */
+/* Returns: index of the first matching element, -1 if not found */
+VECTOR_API ssize_t _vector_parallel_find_internal(vector* vec, const void* value,
+                                                  size_t element_size,
+                                                  int (*compar)(const void*, const void*,
+                                                                void*))
+{
+    return _vector_find_run(vec, value, element_size, compar, 1);
+}
+
+/* Finds the first element equal to value under the read lock */
+/* Args: vec - vector pointer, value - value to find, element_size - size, */
+/*       compar - comparison function, parallel - 1 to use the worker pool */
+/* Returns: index of element, -1 if not found */
+static ssize_t _vector_find_run(vector* vec, const void* value, size_t element_size,
+                                int (*compar)(const void*, const void*, void*),
+                                int parallel)
+{
     if (!vec)
     {
-        _vector_error("Failed to allocate vector structure");
-        return NULL;
+        _vector_error(VECTOR_ERR_NULL, "NULL vector");
+        return -1;
+    }
+    vector_rdlock(vec);
+    struct _vector_search_args args;
+    memset(&args, 0, sizeof(args));
+    args.data = (const char*)vec->data;
+    args.element_size = element_size;
+    args.vec = vec;
+    args.value = value;
+    args.compar = compar;
+    args.best = SIZE_MAX;
+    if (parallel)
+        _vector_search(&args, vec->length, _vector_search_run);
+    else
+        args.best = _vector_search_range(&args, 0, vec->length);
+    _VECTOR_TRACE(VECTOR_TRACE_FIND, vec, args.best, 1);
+    vector_unlock(vec);
+    return args.best == SIZE_MAX ? -1 : (ssize_t)args.best;
+}
+
+/* Elements scanned between checks for a match found by another thread */
+#define _VECTOR_SEARCH_BLOCK 4096
+
+/* Runs a search job over length elements on the worker pool */
+/* Args: args - search state, length - elements, run - range function */
+static void _vector_search(struct _vector_search_args* args, size_t length,
+                           void (*run)(struct _vector_parallel_job*, size_t, size_t))
+{
+    _vector_parallel_job job;
+    memset(&job, 0, sizeof(job));
+    job.run = run;
+    job.arg = args;
+    job.length = length;
+    _vector_parallel_run(&job, args->element_size, 0);
+}
+
+/* Returns the first index in [begin, end) that matches, SIZE_MAX if none */
+/* Args: args - search state, begin/end - element range */
+static size_t _vector_search_range(const struct _vector_search_args* args,
+                                   size_t begin, size_t end)
+{
+    const char* data = args->data;
+    size_t es = args->element_size;
+    if (args->pred)
+    {
+        for (size_t i = begin; i < end; ++i)
+            if (args->pred(data + i * es, args->ctx))
+                return i;
+        return SIZE_MAX;
+    }
+    if (args->compar == _vector_compare_eq)
+    {
+        /* Bytewise equality: load whole elements instead of calling compar */
+        switch (es)
+        {
+        case 1:
+        {
+            const char* hit = (const char*)memchr(data + begin,
+                                                  *(const unsigned char*)args->value,
+                                                  end - begin);
+            return hit ? (size_t)(hit - data) : SIZE_MAX;
+        }
+#define _VECTOR_SEARCH_WORD(bits) \
+        case bits / 8: \
+        { \
+            uint##bits##_t want, elem; \
+            memcpy(&want, args->value, sizeof(want)); \
+            for (size_t i = begin; i < end; ++i) \
+            { \
+                memcpy(&elem, data + i * sizeof(elem), sizeof(elem)); \
+                if (elem == want) \
+                    return i; \
+            } \
+            return SIZE_MAX; \
+        }
+        _VECTOR_SEARCH_WORD(16)
+        _VECTOR_SEARCH_WORD(32)
+        _VECTOR_SEARCH_WORD(64)
+#undef _VECTOR_SEARCH_WORD
+        default:
+            for (size_t i = begin; i < end; ++i)
+                if (memcmp(data + i * es, args->value, es) == 0)
+                    return i;
+            return SIZE_MAX;
+        }
+    }
+    for (size_t i = begin; i < end; ++i)
+        if (args->compar(data + i * es, args->value, args->vec) == 0)
+            return i;
+    return SIZE_MAX;
+}
+
+/* Search job range: records the first match unless a better one is known */
+/* Args: job - search job, begin/end - element range */
+static void _vector_search_run(_vector_parallel_job* job, size_t begin, size_t end)
+{
+    struct _vector_search_args* args = (struct _vector_search_args*)job->arg;
+    for (size_t block = begin; block < end; block += _VECTOR_SEARCH_BLOCK)
+    {
+        /* First-match searches only skip ranges after a known match */
+        size_t best = __atomic_load_n(&args->best, __ATOMIC_RELAXED);
+        if (args->any ? best != SIZE_MAX : best < block)
+            return;
+        size_t stop = end - block > _VECTOR_SEARCH_BLOCK ? block + _VECTOR_SEARCH_BLOCK
+                                                         : end;
+        size_t hit = _vector_search_range(args, block, stop);
+        if (hit != SIZE_MAX)
+        {
+            _vector_atomic_min_size(&args->best, hit);
+            return;
+        }
+    }
+}
+
+/* Count job range: adds the number of matches in the range */
+/* Args: job - count job, begin/end - element range */
+static void _vector_count_run(_vector_parallel_job* job, size_t begin, size_t end)
+{
+    struct _vector_search_args* args = (struct _vector_search_args*)job->arg;
+    const char* elem = args->data + begin * args->element_size;
+    size_t count = 0;
+    for (size_t i = begin; i < end; ++i, elem += args->element_size)
+        count += args->pred(elem, args->ctx) != 0;
+    __atomic_fetch_add(&args->count, count, __ATOMIC_RELAXED);
+}
+
+/* Computes the running sums of a numeric vector */
+/* Args: src - source vector, dst - destination (NULL or src for in place), */
+/*       mode - inclusive or exclusive, element_size - sizeof the element */
+/*       type, floating - nonzero for float and double */
+/* Returns: 0 on success, -1 on failure */
+VECTOR_API int _vector_prefix_sum_internal(vector* src, vector* dst,
+                                           vector_scan_mode mode,
+                                           size_t element_size, int floating)
+{
+    if (!src)
+    {
+        _vector_error(VECTOR_ERR_NULL, "NULL vector");
+        return -1;
+    }
+    if (!dst)
+        dst = src;
+    if ((element_size != 4 && element_size != 8) ||
+        src->element_size != element_size || dst->element_size != element_size)
+    {
+        _vector_error(VECTOR_ERR_ARGS, "Prefix sum of %zu byte type over %zu byte "
+                      "elements (4 or 8 bytes required)", element_size,
+                      src->element_size != element_size ? src->element_size
+                                                        : dst->element_size);
+        return -1;
+    }
+    _vector_lock_ordered(src, 0, dst, 1);
+    size_t length = src->length;
+    if (dst != src)
+    {
+        if (_vector_reserve_internal(dst, length) == -1)
+        {
+            _vector_unlock_ordered(src, dst);
+            _vector_error(VECTOR_ERR_NOMEM, "Failed to allocate %zu elements", length);
+            return -1;
+        }
+        if (dst->length != length)
+        {
+            dst->length = length;
+            _VECTOR_TRACE(VECTOR_TRACE_RESIZE, dst, 0, length);
+        }
+    }
+    struct _vector_scan_args args;
+    memset(&args, 0, sizeof(args));
+    args.in = (const char*)src->data;
+    args.out = (char*)dst->data;
+    args.element_size = element_size;
+    args.kind = (unsigned)element_size | (floating ? _VECTOR_SCAN_FLOATING : 0);
+    args.exclusive = mode == VECTOR_SCAN_EXCLUSIVE;
+    _vector_scan(&args, length);
+    _vector_unlock_ordered(src, dst);
+    return 0;
+}
+
+/* Runs a prefix sum, as a two-pass block scan when the pool can help */
+/* Args: args - scan state, length - elements */
+static void _vector_scan(struct _vector_scan_args* args, size_t length)
+{
+    _vector_scan_value acc;
+    memset(&acc, 0, sizeof(acc));
+    _vector_parallel_job job;
+    memset(&job, 0, sizeof(job));
+    job.arg = args;
+    job.length = length;
+    job.base = args->out;
+    _vector_parallel_plan(&job, args->element_size, 0);
+    if (job.tasks > 1)
+        args->totals = (char*)malloc(job.tasks * args->element_size);
+    if (!args->totals)
+    {
+        _vector_scan_block(args->kind, args->in, args->out, length, &acc,
+                           args->exclusive);
+        return;
+    }
+    job.run = _vector_scan_sum_run;
+    _vector_parallel_run(&job, args->element_size, 0);
+    /* Each block starts from the sum of the blocks before it */
+    _vector_scan_block(args->kind, args->totals, args->totals, job.tasks, &acc, 1);
+    job.run = _vector_scan_block_run;
+    _vector_parallel_run(&job, args->element_size, 0);
+    free(args->totals);
+    args->totals = NULL;
+}
+
+/* First prefix sum pass: stores the total of one block */
+/* Args: job - scan job, begin/end - element range of the block */
+static void _vector_scan_sum_run(_vector_parallel_job* job, size_t begin, size_t end)
+{
+    struct _vector_scan_args* args = (struct _vector_scan_args*)job->arg;
+    _vector_scan_value acc;
+    memset(&acc, 0, sizeof(acc));
+    _vector_sum_block(args->kind, args->in + begin * args->element_size,
+                      end - begin, &acc);
+    memcpy(args->totals + _vector_parallel_task_index(job, begin) * args->element_size,
+           &acc, args->element_size);
+}
+
+/* Second prefix sum pass: scans one block from its starting total */
+/* Args: job - scan job, begin/end - element range of the block */
+static void _vector_scan_block_run(_vector_parallel_job* job, size_t begin, size_t end)
+{
+    struct _vector_scan_args* args = (struct _vector_scan_args*)job->arg;
+    _vector_scan_value acc;
+    memset(&acc, 0, sizeof(acc));
+    memcpy(&acc, args->totals + _vector_parallel_task_index(job, begin) * args->element_size,
+           args->element_size);
+    _vector_scan_block(args->kind, args->in + begin * args->element_size,
+                       args->out + begin * args->element_size, end - begin, &acc,
+                       args->exclusive);
+}
+
+/* Scans n elements, continuing from and updating a running total */
+/* Args: kind - element kind, in/out - n elements (may be the same), */
+/*       acc - running total, exclusive - nonzero for an exclusive scan */
+/* Note: SSE2 computes the sums within a register with two shifted adds */
+/* (one for two-lane types) and carries the last lane to the next register */
+static void _vector_scan_block(unsigned kind, const void* in, void* out, size_t n,
+                               _vector_scan_value* acc, int exclusive)
+{
+    size_t i = 0;
+    switch (kind)
+    {
+    case 4:
+    {
+        const uint32_t* src = (const uint32_t*)in;
+        uint32_t* dst = (uint32_t*)out;
+        uint32_t carry = acc->u32;
+#if defined(__SSE2__)
+        __m128i c = _mm_set1_epi32((int)carry);
+        for (; i + 4 <= n; i += 4)
+        {
+            __m128i x = _mm_loadu_si128((const __m128i*)(src + i));
+            x = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+            x = _mm_add_epi32(x, _mm_slli_si128(x, 8));
+            __m128i y = exclusive ? _mm_slli_si128(x, 4) : x;
+            _mm_storeu_si128((__m128i*)(dst + i), _mm_add_epi32(y, c));
+            c = _mm_add_epi32(c, _mm_shuffle_epi32(x, _MM_SHUFFLE(3, 3, 3, 3)));
+        }
+        carry = (uint32_t)_mm_cvtsi128_si32(c);
+#endif
+        for (; i < n; ++i)
+        {
+            uint32_t x = src[i];
+            dst[i] = exclusive ? carry : carry + x;
+            carry += x;
+        }
+        acc->u32 = carry;
+        break;
+    }
+    case 8:
+    {
+        const uint64_t* src = (const uint64_t*)in;
+        uint64_t* dst = (uint64_t*)out;
+        uint64_t carry = acc->u64;
+#if defined(__SSE2__)
+        __m128i c = _mm_set1_epi64x((long long)carry);
+        for (; i + 2 <= n; i += 2)
+        {
+            __m128i x = _mm_loadu_si128((const __m128i*)(src + i));
+            x = _mm_add_epi64(x, _mm_slli_si128(x, 8));
+            __m128i y = exclusive ? _mm_slli_si128(x, 8) : x;
+            _mm_storeu_si128((__m128i*)(dst + i), _mm_add_epi64(y, c));
+            c = _mm_add_epi64(c, _mm_unpackhi_epi64(x, x));
+        }
+        _mm_storel_epi64((__m128i*)&carry, c);
+#endif
+        for (; i < n; ++i)
+        {
+            uint64_t x = src[i];
+            dst[i] = exclusive ? carry : carry + x;
+            carry += x;
+        }
+        acc->u64 = carry;
+        break;
+    }
+    case 4 | _VECTOR_SCAN_FLOATING:
+    {
+        const float* src = (const float*)in;
+        float* dst = (float*)out;
+        float carry = acc->f32;
+#if defined(__SSE2__)
+        __m128 c = _mm_set1_ps(carry);
+        for (; i + 4 <= n; i += 4)
+        {
+            __m128 x = _mm_loadu_ps(src + i);
+            x = _mm_add_ps(x, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(x), 4)));
+            x = _mm_add_ps(x, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(x), 8)));
+            __m128 y = exclusive
+                ? _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(x), 4)) : x;
+            _mm_storeu_ps(dst + i, _mm_add_ps(y, c));
+            c = _mm_add_ps(c, _mm_shuffle_ps(x, x, _MM_SHUFFLE(3, 3, 3, 3)));
+        }
+        carry = _mm_cvtss_f32(c);
+#endif
+        for (; i < n; ++i)
+        {
+            float x = src[i];
+            dst[i] = exclusive ? carry : carry + x;
+            carry += x;
+        }
+        acc->f32 = carry;
+        break;
+    }
+    case 8 | _VECTOR_SCAN_FLOATING:
+    {
+        const double* src = (const double*)in;
+        double* dst = (double*)out;
+        double carry = acc->f64;
+#if defined(__SSE2__)
+        __m128d c = _mm_set1_pd(carry);
+        for (; i + 2 <= n; i += 2)
+        {
+            __m128d x = _mm_loadu_pd(src + i);
+            x = _mm_add_pd(x, _mm_castsi128_pd(_mm_slli_si128(_mm_castpd_si128(x), 8)));
+            __m128d y = exclusive
+                ? _mm_castsi128_pd(_mm_slli_si128(_mm_castpd_si128(x), 8)) : x;
+            _mm_storeu_pd(dst + i, _mm_add_pd(y, c));
+            c = _mm_add_pd(c, _mm_unpackhi_pd(x, x));
+        }
+        carry = _mm_cvtsd_f64(c);
+#endif
+        for (; i < n; ++i)
+        {
+            double x = src[i];
+            dst[i] = exclusive ? carry : carry + x;
+            carry += x;
+        }
+        acc->f64 = carry;
+        break;
+    }
+    }
+}
+
+/* Adds the sum of n elements to a running total */
+/* Args: kind - element kind, in - n elements, acc - running total */
+static void _vector_sum_block(unsigned kind, const void* in, size_t n,
+                              _vector_scan_value* acc)
+{
+    size_t i = 0;
+    switch (kind)
+    {
+    case 4:
+    {
+        const uint32_t* src = (const uint32_t*)in;
+        uint32_t sum = 0;
+#if defined(__SSE2__)
+        __m128i v = _mm_setzero_si128();
+        for (; i + 4 <= n; i += 4)
+            v = _mm_add_epi32(v, _mm_loadu_si128((const __m128i*)(src + i)));
+        v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+        v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+        sum = (uint32_t)_mm_cvtsi128_si32(v);
+#endif
+        for (; i < n; ++i)
+            sum += src[i];
+        acc->u32 += sum;
+        break;
+    }
+    case 8:
+    {
+        const uint64_t* src = (const uint64_t*)in;
+        uint64_t sum = 0;
+#if defined(__SSE2__)
+        __m128i v = _mm_setzero_si128();
+        for (; i + 2 <= n; i += 2)
+            v = _mm_add_epi64(v, _mm_loadu_si128((const __m128i*)(src + i)));
+        v = _mm_add_epi64(v, _mm_unpackhi_epi64(v, v));
+        _mm_storel_epi64((__m128i*)&sum, v);
+#endif
+        for (; i < n; ++i)
+            sum += src[i];
+        acc->u64 += sum;
+        break;
+    }
+    case 4 | _VECTOR_SCAN_FLOATING:
+    {
+        const float* src = (const float*)in;
+        float sum = 0;
+#if defined(__SSE2__)
+        __m128 v = _mm_setzero_ps();
+        for (; i + 4 <= n; i += 4)
+            v = _mm_add_ps(v, _mm_loadu_ps(src + i));
+        v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+        v = _mm_add_ss(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)));
+        sum = _mm_cvtss_f32(v);
+#endif
+        for (; i < n; ++i)
+            sum += src[i];
+        acc->f32 += sum;
+        break;
+    }
+    case 8 | _VECTOR_SCAN_FLOATING:
+    {
+        const double* src = (const double*)in;
+        double sum = 0;
+#if defined(__SSE2__)
+        __m128d v = _mm_setzero_pd();
+        for (; i + 2 <= n; i += 2)
+            v = _mm_add_pd(v, _mm_loadu_pd(src + i));
+        v = _mm_add_sd(v, _mm_unpackhi_pd(v, v));
+        sum = _mm_cvtsd_f64(v);
+#endif
+        for (; i < n; ++i)
+            sum += src[i];
+        acc->f64 += sum;
+        break;
+    }
+    }
+}
+
+/* Checks that every index of an index vector is below bound */
+/* Args: indices - vector of uint32_t or uint64_t, bound - length indexed */
+/* Returns: 1 if every index also fits in int32_t, 0 if not, -1 (with */
+/*          VECTOR_ERR_BOUNDS set) if some index is out of bounds */
+static int _vector_index_check(const vector* indices, size_t bound)
+{
+    uint64_t max = 0;
+    size_t n = indices->length;
+    if (indices->element_size == 4)
+    {
+        const uint32_t* idx = (const uint32_t*)indices->data;
+        uint32_t m = 0;
+        for (size_t i = 0; i < n; ++i)
+            m = idx[i] > m ? idx[i] : m;
+        max = m;
+    }
+    else
+    {
+        const uint64_t* idx = (const uint64_t*)indices->data;
+        for (size_t i = 0; i < n; ++i)
+            max = idx[i] > max ? idx[i] : max;
+    }
+    if (n && max >= bound)
+    {
+        _vector_error(VECTOR_ERR_BOUNDS, "Index %zu out of bounds for length %zu",
+                      (size_t)max, bound);
+        return -1;
+    }
+    return max <= INT32_MAX;
+}
+
+/* Reads index i of an index array of 4 or 8 byte elements */
+#define _VECTOR_INDEX_AT(idx, index_size, i) \
+    ((index_size) == 4 ? (size_t)((const uint32_t*)(idx))[i] \
+                       : (size_t)((const uint64_t*)(idx))[i])
+
+/* Gathers n elements: dst[i] = src[idx[i]] */
+/* Args: dst, src - element arrays, idx - n checked indices, element_size, */
+/*       index_size - 4 or 8, narrow - every index fits in int32_t */
+static void _vector_gather_range(char* dst, const char* src, const void* idx,
+                                 size_t n, size_t element_size, size_t index_size,
+                                 int narrow)
+{
+    size_t i = 0;
+#if defined(_VECTOR_X86_GATHER)
+    /* 32-bit gather indices are signed */
+    if ((element_size == 4 || element_size == 8) && (index_size == 8 || narrow))
+    {
+        if (__builtin_cpu_supports("avx512f"))
+            i = _vector_gather_avx512(dst, src, idx, n, element_size, index_size);
+        else if (__builtin_cpu_supports("avx2"))
+            i = _vector_gather_avx2(dst, src, idx, n, element_size, index_size);
+    }
+#else
+    (void)narrow;
+#endif
+    /* Constant sizes let the compiler inline each copy as a load and store */
+#define _VECTOR_GATHER_LOOP(size) \
+    for (; i < n; ++i) \
+    { \
+        if (i + VECTOR_GATHER_PREFETCH < n) \
+            _VECTOR_PREFETCH(src + _VECTOR_INDEX_AT(idx, index_size, \
+                                                    i + VECTOR_GATHER_PREFETCH) * (size)); \
+        memcpy(dst + i * (size), src + _VECTOR_INDEX_AT(idx, index_size, i) * (size), \
+               (size)); \
+    }
+    switch (element_size)
+    {
+    case 1:  _VECTOR_GATHER_LOOP(1); break;
+    case 2:  _VECTOR_GATHER_LOOP(2); break;
+    case 4:  _VECTOR_GATHER_LOOP(4); break;
+    case 8:  _VECTOR_GATHER_LOOP(8); break;
+    case 16: _VECTOR_GATHER_LOOP(16); break;
+    default: _VECTOR_GATHER_LOOP(element_size); break;
+    }
+#undef _VECTOR_GATHER_LOOP
+}
+
+/* Scatters n elements: dst[idx[i]] = src[i], in order of i */
+/* Args: dst, src - element arrays, idx - n checked indices, element_size, */
+/*       index_size - 4 or 8, narrow - every index fits in int32_t */
+static void _vector_scatter_range(char* dst, const char* src, const void* idx,
+                                  size_t n, size_t element_size, size_t index_size,
+                                  int narrow)
+{
+    size_t i = 0;
+#if defined(_VECTOR_X86_GATHER)
+    if ((element_size == 4 || element_size == 8) && (index_size == 8 || narrow) &&
+        __builtin_cpu_supports("avx512f"))
+        i = _vector_scatter_avx512(dst, src, idx, n, element_size, index_size);
+#else
+    (void)narrow;
+#endif
+#define _VECTOR_SCATTER_LOOP(size) \
+    for (; i < n; ++i) \
+    { \
+        if (i + VECTOR_GATHER_PREFETCH < n) \
+            _VECTOR_PREFETCH_WRITE(dst + _VECTOR_INDEX_AT(idx, index_size, \
+                                                          i + VECTOR_GATHER_PREFETCH) * (size)); \
+        memcpy(dst + _VECTOR_INDEX_AT(idx, index_size, i) * (size), src + i * (size), \
+               (size)); \
+    }
+    switch (element_size)
+    {
+    case 1:  _VECTOR_SCATTER_LOOP(1); break;
+    case 2:  _VECTOR_SCATTER_LOOP(2); break;
+    case 4:  _VECTOR_SCATTER_LOOP(4); break;
+    case 8:  _VECTOR_SCATTER_LOOP(8); break;
+    case 16: _VECTOR_SCATTER_LOOP(16); break;
+    default: _VECTOR_SCATTER_LOOP(element_size); break;
+    }
+#undef _VECTOR_SCATTER_LOOP
+}
+
+#if defined(_VECTOR_X86_GATHER)
+/* Gathers whole AVX2 registers of 4 or 8 byte elements */
+/* Args: as _vector_gather_range (32-bit indices must fit in int32_t) */
+/* Returns: elements gathered; the caller copies the rest */
+__attribute__((target("avx2")))
+static size_t _vector_gather_avx2(char* dst, const char* src, const void* idx,
+                                  size_t n, size_t element_size, size_t index_size)
+{
+    size_t i = 0;
+    if (element_size == 4 && index_size == 4)
+    {
+        for (; i + 8 <= n; i += 8)
+        {
+            __m256i ix = _mm256_loadu_si256((const __m256i*)((const uint32_t*)idx + i));
+            _mm256_storeu_si256((__m256i*)(dst + i * 4),
+                                _mm256_i32gather_epi32((const int*)src, ix, 4));
+        }
+    }
+    else if (element_size == 4)
+    {
+        for (; i + 4 <= n; i += 4)
+        {
+            __m256i ix = _mm256_loadu_si256((const __m256i*)((const uint64_t*)idx + i));
+            _mm_storeu_si128((__m128i*)(dst + i * 4),
+                             _mm256_i64gather_epi32((const int*)src, ix, 4));
+        }
+    }
+    else if (index_size == 4)
+    {
+        for (; i + 4 <= n; i += 4)
+        {
+            __m128i ix = _mm_loadu_si128((const __m128i*)((const uint32_t*)idx + i));
+            _mm256_storeu_si256((__m256i*)(dst + i * 8),
+                                _mm256_i32gather_epi64((const long long*)src, ix, 8));
+        }
+    }
+    else
+    {
+        for (; i + 4 <= n; i += 4)
+        {
+            __m256i ix = _mm256_loadu_si256((const __m256i*)((const uint64_t*)idx + i));
+            _mm256_storeu_si256((__m256i*)(dst + i * 8),
+                                _mm256_i64gather_epi64((const long long*)src, ix, 8));
+        }
+    }
+    return i;
+}
+
+/* Gathers whole AVX-512 registers of 4 or 8 byte elements */
+/* Args: as _vector_gather_range (32-bit indices must fit in int32_t) */
+/* Returns: elements gathered; the caller copies the rest */
+__attribute__((target("avx512f")))
+static size_t _vector_gather_avx512(char* dst, const char* src, const void* idx,
+                                    size_t n, size_t element_size, size_t index_size)
+{
+    size_t i = 0;
+    if (element_size == 4 && index_size == 4)
+    {
+        for (; i + 16 <= n; i += 16)
+        {
+            __m512i ix = _mm512_loadu_si512((const uint32_t*)idx + i);
+            _mm512_storeu_si512(dst + i * 4, _mm512_i32gather_epi32(ix, src, 4));
+        }
+    }
+    else if (element_size == 4)
+    {
+        for (; i + 8 <= n; i += 8)
+        {
+            __m512i ix = _mm512_loadu_si512((const uint64_t*)idx + i);
+            _mm256_storeu_si256((__m256i*)(dst + i * 4),
+                                _mm512_i64gather_epi32(ix, src, 4));
+        }
     }
-
-    vec->allocator.alloc = default_alloc;
-    vec->allocator.realloc = default_realloc;
-    vec->allocator.free = default_free;
-    vec->data = alloc_size ? calloc(num_elements, element_size) : NULL;
-    if (!vec->data && alloc_size > 0)
+    else if (index_size == 4)
     {
-        _vector_error("Failed to allocate vector data for %zu bytes", alloc_size);
-        free(vec);
-        return NULL;
+        for (; i + 8 <= n; i += 8)
+        {
+            __m256i ix = _mm256_loadu_si256((const __m256i*)((const uint32_t*)idx + i));
+            _mm512_storeu_si512(dst + i * 8, _mm512_i32gather_epi64(ix, src, 8));
+        }
     }
-
-    vec->length = num_elements;
-    vec->capacity = num_elements;
-    vec->element_size = element_size;
-#if defined(_WIN32)
-    InitializeSRWLock(&vec->rwlock);
-#elif defined(__linux__)
-    if (pthread_rwlock_init(&vec->rwlock, NULL) != 0)
+    else
     {
-        vec->allocator.free(vec->data);
-        free(vec);
-        _vector_error("Failed to initialize rwlock");
-        return NULL;
+        for (; i + 8 <= n; i += 8)
+        {
+            __m512i ix = _mm512_loadu_si512((const uint64_t*)idx + i);
+            _mm512_storeu_si512(dst + i * 8, _mm512_i64gather_epi64(ix, src, 8));
+        }
     }
-#endif
-    return vec;
+    return i;
 }
 
-/* Creates vector with values */
-/* Args: element_size - size of each element, num_elements - count, */
-/*       arg_count - number of values, values - initial values */
-/* Returns: new vector pointer, NULL on failure */
-static vector* _vector_create_with_values(size_t element_size, size_t num_elements,
-                                          size_t arg_count, const void* values)
+/* Scatters whole AVX-512 registers of 4 or 8 byte elements */
+/* Args: as _vector_scatter_range (32-bit indices must fit in int32_t) */
+/* Returns: elements scattered; the caller stores the rest */
+/* Note: a scatter writes its lanes in order, so a repeated index keeps the */
+/* later element, as the scalar loop does */
+__attribute__((target("avx512f")))
+static size_t _vector_scatter_avx512(char* dst, const char* src, const void* idx,
+                                     size_t n, size_t element_size, size_t index_size)
 {
-    vector* vec = _vector_create_base(element_size, num_elements);
-    if (!vec)
-        return NULL;
-
-    if (arg_count == 0)
+    size_t i = 0;
+    if (element_size == 4 && index_size == 4)
     {
-        /* Already zeroed by calloc */
+        for (; i + 16 <= n; i += 16)
+        {
+            __m512i ix = _mm512_loadu_si512((const uint32_t*)idx + i);
+            _mm512_i32scatter_epi32(dst, ix, _mm512_loadu_si512(src + i * 4), 4);
+        }
     }
-    else if (arg_count == 1)
+    else if (element_size == 4)
     {
-        for (size_t i = 0; i < num_elements; ++i)
-            memcpy((char*)vec->data + i * element_size, values, element_size);
+        for (; i + 8 <= n; i += 8)
+        {
+            __m512i ix = _mm512_loadu_si512((const uint64_t*)idx + i);
+            _mm512_i64scatter_epi32(dst, ix,
+                                    _mm256_loadu_si256((const __m256i*)(src + i * 4)), 4);
+        }
     }
-    else if (arg_count <= num_elements)
+    else if (index_size == 4)
     {
-        memcpy(vec->data, values, arg_count * element_size);
-        /* Remaining space already zeroed by calloc */
+        for (; i + 8 <= n; i += 8)
+        {
+            __m256i ix = _mm256_loadu_si256((const __m256i*)((const uint32_t*)idx + i));
+            _mm512_i32scatter_epi64(dst, ix, _mm512_loadu_si512(src + i * 8), 8);
+        }
     }
     else
     {
-        _vector_error("Argument count %zu exceeds num_elements %zu",
-                      arg_count, num_elements);
-        vector_free(vec);
-        return NULL;
+        for (; i + 8 <= n; i += 8)
+        {
+            __m512i ix = _mm512_loadu_si512((const uint64_t*)idx + i);
+            _mm512_i64scatter_epi64(dst, ix, _mm512_loadu_si512(src + i * 8), 8);
+        }
     }
-    return vec;
+    return i;
+}
+#endif
+
+/* Fills a stack vector so comparators can read a view's element size */
+/* Args: view - source view, shell - vector to fill (never locked or freed) */
+static void _vector_view_shell(vector_view view, vector* shell)
+{
+    memset(shell, 0, sizeof(*shell));
+    shell->data = (void*)view.data;
+    shell->length = view.length;
+    shell->capacity = view.length;
+    shell->element_size = view.element_size;
 }
 
-/* Finds element in vector */
-/* Args: vec - vector pointer, value - value to find, element_size - size, */
-/*       compar - comparison function */
+/* Finds element in a view */
+/* Args: view - vector_view, value - value to find, compar - comparison */
+/*       function (its context is a vector describing the view) */
 /* Returns: index of element, -1 if not found */
-static ssize_t _vector_find_internal(vector* vec, const void* value,
-                                     size_t element_size,
-                                     int (*compar)(const void*, const void*, void*))
+VECTOR_API ssize_t _vector_view_find_internal(vector_view view, const void* value,
+                                              int (*compar)(const void*, const void*, void*))
 {
-    if (!vec)
-    {
-        _vector_error("NULL vector");
-        return -1;
-    }
-    vector_rdlock(vec);
-    for (size_t i = 0; i < vec->length; ++i)
+    vector shell;
+    _vector_view_shell(view, &shell);
+    const char* elem = (const char*)view.data;
+    for (size_t i = 0; i < view.length; ++i, elem += view.element_size)
     {
-        void* elem = (char*)vec->data + i * element_size;
-        if (compar(elem, value, vec) == 0)
-        {
-            vector_unlock(vec);
+        if (compar(elem, value, &shell) == 0)
             return (ssize_t)i;
-        }
     }
-    vector_unlock(vec);
     return -1;
 }
 
+/* Binary searches a sorted view */
+/* Args: view - vector_view sorted by compar, value - value to search for, */
+/*       compar - comparison function */
+/* Returns: index of the first element not less than value */
+VECTOR_API size_t _vector_view_lower_bound_internal(vector_view view, const void* value,
+                                                    int (*compar)(const void*, const void*, void*))
+{
+    vector shell;
+    _vector_view_shell(view, &shell);
+    size_t lo = 0, hi = view.length;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        const void* elem = (const char*)view.data + mid * view.element_size;
+        if (compar(elem, value, &shell) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
 /* Inserts values at index */
 /* Args: vec - vector pointer, index - insertion point, num_values - count, */
 /*       values - data to insert */
 /* Returns: 0 on success, -1 on failure */
-static int _vector_insert_internal(vector* vec, size_t index, size_t num_values,
-                                   const void* values)
+VECTOR_API int _vector_insert_internal(vector* vec, size_t index, size_t num_values,
+                                       const void* values)
 {
     if (!vec)
         return -1;
@@ -661,20 +4335,16 @@ static int _vector_insert_internal(vector* vec, size_t index, size_t num_values,
     if (_safe_add(vec->length, num_values, &total_elements) == -1)
         return -1;
 
-    if (total_elements > vec->capacity)
-    {
-        size_t new_capacity = vec->capacity == 0 ? num_values :
-                              vec->capacity + vec->capacity / 2;
-        if (new_capacity < total_elements)
-            new_capacity = total_elements;
-        if (_vector_reserve_internal(vec, new_capacity) == -1)
-            return -1;
-    }
+    if (total_elements > vec->capacity &&
+        _vector_grow_internal(vec, total_elements) == -1)
+        return -1;
     if (index < vec->length)
     {
+        size_t bytes_to_move = (vec->length - index) * vec->element_size;
         memmove((char*)vec->data + (index + num_values) * vec->element_size,
                 (char*)vec->data + index * vec->element_size,
-                (vec->length - index) * vec->element_size);
+                bytes_to_move);
+        _VECTOR_STAT_ADD(vec, memmove_bytes, bytes_to_move);
     }
     memcpy((char*)vec->data + index * vec->element_size, values,
            num_values * vec->element_size);
@@ -685,15 +4355,23 @@ static int _vector_insert_internal(vector* vec, size_t index, size_t num_values,
 /* Pops last element */
 /* Args: vec - vector pointer */
 /* Returns: pointer to popped element, NULL on failure */
-static void* _vector_pop_internal(vector* vec)
+VECTOR_API void* _vector_pop_internal(vector* vec)
 {
-    if (!vec || vec->length == 0)
+    if (!vec)
     {
-        _vector_error("NULL or empty vector");
+        _vector_error(VECTOR_ERR_NULL, "NULL or empty vector");
         return NULL;
     }
     vector_wrlock(vec);
+    /* Checked under the lock: another thread may have emptied the vector */
+    if (vec->length == 0)
+    {
+        vector_unlock(vec);
+        _vector_error(VECTOR_ERR_EMPTY, "NULL or empty vector");
+        return NULL;
+    }
     void* popped_data = vec->allocator.alloc(vec->element_size);
+    _VECTOR_PROBE3(pop__alloc, vec, popped_data, vec->element_size);
     if (!popped_data)
     {
         vector_unlock(vec);
@@ -702,6 +4380,7 @@ static void* _vector_pop_internal(vector* vec)
     void* last_element = (char*)vec->data + (vec->length - 1) * vec->element_size;
     memcpy(popped_data, last_element, vec->element_size);
     vec->length--;
+    _VECTOR_TRACE(VECTOR_TRACE_POP, vec, vec->length, 1);
     vector_unlock(vec);
     return popped_data;
 }
@@ -709,8 +4388,8 @@ static void* _vector_pop_internal(vector* vec)
 /* Prepends values to vector */
 /* Args: vec - vector pointer, num_values - count, values - data to prepend */
 /* Returns: 0 on success, -1 on failure */
-static int _vector_prepend_internal(vector* vec, size_t num_values,
-                                    const void* values)
+VECTOR_API int _vector_prepend_internal(vector* vec, size_t num_values,
+                                        const void* values)
 {
     return _vector_insert_internal(vec, 0, num_values, values);
 }
@@ -725,16 +4404,18 @@ static int _vector_qsort_wrapper(const void* a, const void* b)
 
 /* Sorts vector with comparison function */
 /* Args: vec - vector pointer, compar - comparison function */
-static void _vector_sort_internal(vector* vec,
-                                  int (*compar)(const void*, const void*, void*))
+VECTOR_API void _vector_sort_internal(vector* vec,
+                                      int (*compar)(const void*, const void*, void*))
 {
     if (!vec || vec->length <= 1)
         return;
+    _VECTOR_PROBE3(sort__start, vec, vec->length, vec->element_size);
     _sort_context = vec;
     _sort_compar = compar;
     qsort(vec->data, vec->length, vec->element_size, _vector_qsort_wrapper);
     _sort_context = NULL;
     _sort_compar = NULL;
+    _VECTOR_PROBE2(sort__done, vec, vec->length);
 }
 
 /* Removes elements from index */
@@ -745,7 +4426,8 @@ static int _vector_remove_internal(vector* vec, size_t index,
 {
     if (index >= vec->length || index + num_elements > vec->length)
     {
-        _vector_error("Index out of bounds: index %zu, num_elements %zu, length %zu",
+        _vector_error(VECTOR_ERR_BOUNDS,
+                      "Index out of bounds: index %zu, num_elements %zu, length %zu",
                       index, num_elements, vec->length);
         return -1;
     }
@@ -759,6 +4441,7 @@ static int _vector_remove_internal(vector* vec, size_t index,
         memmove((char*)vec->data + index * vec->element_size,
                 (char*)vec->data + (index + num_elements) * vec->element_size,
                 bytes_to_move);
+        _VECTOR_STAT_ADD(vec, memmove_bytes, bytes_to_move);
     }
     vec->length -= num_elements;
     return 0;
@@ -774,11 +4457,14 @@ static int _vector_reserve_internal(vector* vec, size_t new_capacity)
     size_t new_size;
     if (_safe_mul(new_capacity, vec->element_size, &new_size) == -1)
         return -1;
+    void* old_data = vec->data;
+    size_t old_capacity = vec->capacity;
     void* new_data = vec->allocator.realloc(vec->data, new_size);
     if (!new_data && new_size > 0)
         return -1;
     vec->data = new_data;
     vec->capacity = new_capacity;
+    _vector_note_realloc(vec, old_data, old_capacity);
     return 0;
 }
 
@@ -804,163 +4490,859 @@ static int _vector_resize_internal(vector* vec, size_t new_length)
     return 0;
 }
 
-/* Serializes vector to file */
-/* Args: vec - vector pointer (read-only), fp - file pointer */
-/* Returns: 0 on success, -1 on failure */
-static int _vector_serialize_internal(const vector* vec, FILE* fp)
+/* Serializes vector to file */
+/* Args: vec - vector pointer (read-only), fp - file pointer */
+/* Returns: 0 on success, -1 on failure */
+static int _vector_serialize_internal(const vector* vec, FILE* fp)
+{
+    return _vector_serialize_range(vec, vec->data, vec->length,
+                                   vec->element_size, fp);
+}
+
+/* Writes a length/element_size header and the elements */
+/* Args: owner - vector or view reported to probes, data - first element, */
+/*       length - element count, element_size - bytes per element, fp - file */
+/* Returns: 0 on success, -1 on failure */
+static int _vector_serialize_range(const void* owner, const void* data,
+                                   size_t length, size_t element_size, FILE* fp)
+{
+    int result = 0;
+    (void)owner;
+    _VECTOR_PROBE3(serialize__start, owner, length, element_size);
+    if (fwrite(&length, sizeof(size_t), 1, fp) != 1 ||
+        fwrite(&element_size, sizeof(size_t), 1, fp) != 1 ||
+        (length && fwrite(data, element_size, length, fp) != length))
+        result = -1;
+    _VECTOR_PROBE2(serialize__done, owner, result);
+    return result;
+}
+
+/* Deserializes vector from file */
+/* Args: fp - file pointer, element_size - size of each element */
+/* Returns: new vector pointer, NULL on failure */
+static vector* _vector_deserialize_internal(FILE* fp, size_t element_size)
+{
+    size_t length, read_element_size;
+    _VECTOR_PROBE2(deserialize__start, fp, element_size);
+    if (fread(&length, sizeof(size_t), 1, fp) != 1 ||
+        fread(&read_element_size, sizeof(size_t), 1, fp) != 1 ||
+        read_element_size != element_size)
+    {
+        _VECTOR_PROBE2(deserialize__done, NULL, 0);
+        return NULL;
+    }
+    vector* vec = _vector_create_base(element_size, length);
+    if (!vec || fread(vec->data, element_size, length, fp) != length)
+    {
+        (vector_free)(vec);
+        _VECTOR_PROBE2(deserialize__done, NULL, 0);
+        return NULL;
+    }
+    _VECTOR_PROBE2(deserialize__done, vec, length);
+    return vec;
+}
+
+/* Shrinks capacity to fit length */
+/* Args: vec - vector pointer */
+/* Returns: 0 on success, -1 on failure */
+static int _vector_shrink_to_fit_internal(vector* vec)
+{
+    if (vec->capacity == vec->length)
+        return 0;
+    size_t new_size;
+    if (_safe_mul(vec->length, vec->element_size, &new_size) == -1)
+        return -1;
+    void* new_data = vec->length ? vec->allocator.realloc(vec->data, new_size) : NULL;
+    if (vec->length && !new_data)
+        return -1;
+    if (!vec->length && vec->data)
+        vec->allocator.free(vec->data);
+    void* old_data = vec->data;
+    size_t old_capacity = vec->capacity;
+    vec->data = new_data;
+    vec->capacity = vec->length;
+    _vector_note_realloc(vec, old_data, old_capacity);
+    return 0;
+}
+
+/* Swaps two elements in vector */
+/* Args: vec - vector pointer, idx1 - first index, idx2 - second index */
+/* Returns: 0 on success, -1 on failure */
+static int _vector_swap_internal(vector* vec, size_t idx1, size_t idx2)
+{
+    if (idx1 >= vec->length || idx2 >= vec->length)
+        return -1;
+    if (idx1 == idx2)
+        return 0;
+    char temp[vec->element_size];
+    void* ptr1 = (char*)vec->data + idx1 * vec->element_size;
+    void* ptr2 = (char*)vec->data + idx2 * vec->element_size;
+    memcpy(temp, ptr1, vec->element_size);
+    memcpy(ptr1, ptr2, vec->element_size);
+    memcpy(ptr2, temp, vec->element_size);
+    return 0;
+}
+
+/* Default allocator: allocates aligned memory */
+/* Args: size - bytes to allocate */
+/* Returns: pointer to allocated memory, NULL on failure */
+static void* default_alloc(size_t size)
+{
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+    /* C11 requires size to be a multiple of the alignment */
+    size_t rounded = (size + VECTOR_DEFAULT_ALIGNMENT - 1) &
+                     ~(size_t)(VECTOR_DEFAULT_ALIGNMENT - 1);
+    if (rounded < size)
+        return NULL;
+    return aligned_alloc(VECTOR_DEFAULT_ALIGNMENT, rounded); /* C11 */
+#else
+    return malloc(size); /* C99 */
+#endif
+}
+
+/* Default realloc: resizes memory */
+/* Args: ptr - pointer to resize, size - new size */
+/* Returns: pointer to reallocated memory, NULL on failure */
+static void* default_realloc(void* ptr, size_t size)
+{
+    return realloc(ptr, size);
+}
+
+/* Default free: deallocates memory */
+/* Args: ptr - pointer to free */
+static void default_free(void* ptr)
+{
+    free(ptr);
+}
+
+/* Error callback that prints the message to stderr */
+VECTOR_API void vector_error_stderr(const char* message)
+{
+    fprintf(stderr, "%s\n", message);
+}
+
+/* Static error callback variable, accessed atomically; NULL when silent */
+static vector_error_callback error_callback = NULL;
+
+/* Sets error callback function */
+/* Args: callback - function to handle errors */
+VECTOR_API void vector_set_error_callback(vector_error_callback callback)
+{
+    vector_error_callback value = callback == VECTOR_ERROR_SILENT ? NULL : callback;
+    __atomic_store_n(&error_callback, value, __ATOMIC_RELEASE);
+}
+
+/* Records an error for the calling thread and dispatches it to the callback */
+/* Args: code - error code, format - format string whose conversions all */
+/*       take size_t (at most 3), ... - size_t arguments */
+/* Note: the message is only formatted when a callback is installed */
+VECTOR_API void _vector_error(vector_error_code code, const char* format, ...)
+{
+    struct _vector_error_state* err = &_vector_last_error;
+    _VECTOR_PROBE2(error, code, format);
+    err->code = code;
+    err->format = format;
+    size_t argc = 0;
+    for (const char* p = format; *p && argc < 3; ++p)
+    {
+        if (*p == '%' && p[1] != '%')
+            ++argc;
+        else if (*p == '%')
+            ++p;
+    }
+    va_list args;
+    va_start(args, format);
+    for (size_t i = 0; i < 3; ++i)
+        err->args[i] = i < argc ? va_arg(args, size_t) : 0;
+    va_end(args);
+
+    vector_error_callback callback = __atomic_load_n(&error_callback,
+                                                     __ATOMIC_ACQUIRE);
+    if (callback)
+    {
+        char msg[256];
+        vector_last_error_message(msg, sizeof(msg));
+        callback(msg);
+    }
+}
+
+#if defined(_VECTOR_CLOCK)
+/* Monotonic clock for lock wait measurement and trace timestamps */
+/* Returns: nanoseconds since an arbitrary epoch */
+static uint64_t _vector_now_ns(void)
+{
+#if defined(_WIN32)
+    LARGE_INTEGER freq, count;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&count);
+    return (uint64_t)(count.QuadPart / freq.QuadPart) * 1000000000ull +
+           (uint64_t)(count.QuadPart % freq.QuadPart) * 1000000000ull /
+           (uint64_t)freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+#endif
+
+/* Maps a wait time to its histogram bucket */
+/* Args: ns - wait time in nanoseconds */
+/* Returns: bucket index in [0, VECTOR_LOCK_HIST_BUCKETS) */
+static size_t _vector_lock_hist_index(uint64_t ns)
+{
+    if (ns < (1u << VECTOR_LOCK_HIST_SUB_BITS))
+        return (size_t)ns;
+    unsigned msb = 63u - (unsigned)__builtin_clzll(ns);
+    if (msb > VECTOR_LOCK_HIST_MAX_BIT)
+        return VECTOR_LOCK_HIST_BUCKETS - 1;
+    unsigned shift = msb - VECTOR_LOCK_HIST_SUB_BITS;
+    return ((size_t)(shift + 1) << VECTOR_LOCK_HIST_SUB_BITS) |
+           (size_t)((ns >> shift) & ((1u << VECTOR_LOCK_HIST_SUB_BITS) - 1));
+}
+
+/* Returns the largest wait time that maps to a histogram bucket */
+/* Args: index - bucket index */
+static uint64_t _vector_lock_hist_upper(size_t index)
+{
+    if (index < (1u << VECTOR_LOCK_HIST_SUB_BITS))
+        return index;
+    unsigned shift = (unsigned)(index >> VECTOR_LOCK_HIST_SUB_BITS) - 1;
+    uint64_t sub = index & ((1u << VECTOR_LOCK_HIST_SUB_BITS) - 1);
+    uint64_t lower = ((1ull << VECTOR_LOCK_HIST_SUB_BITS) | sub) << shift;
+    return lower + (1ull << shift) - 1;
+}
+
+/* Adds one wait to a histogram; safe for concurrent recorders */
+/* Args: hist - histogram, ns - wait time */
+static void _vector_lock_hist_record(vector_lock_histogram* hist, uint64_t ns)
+{
+    __atomic_fetch_add(&hist->count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&hist->total_ns, ns, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&hist->buckets[_vector_lock_hist_index(ns)], 1,
+                       __ATOMIC_RELAXED);
+    _vector_atomic_max_u64(&hist->max_ns, ns);
+}
+
+/* Snapshots a histogram that may be updated concurrently */
+/* Args: dst - destination, src - live histogram */
+static void _vector_lock_hist_copy(vector_lock_histogram* dst,
+                                   const vector_lock_histogram* src)
+{
+    dst->count = __atomic_load_n(&src->count, __ATOMIC_RELAXED);
+    dst->total_ns = __atomic_load_n(&src->total_ns, __ATOMIC_RELAXED);
+    dst->max_ns = __atomic_load_n(&src->max_ns, __ATOMIC_RELAXED);
+    for (size_t i = 0; i < VECTOR_LOCK_HIST_BUCKETS; ++i)
+        dst->buckets[i] = __atomic_load_n(&src->buckets[i], __ATOMIC_RELAXED);
+}
+
+/* Prints one histogram summary row */
+/* Args: fp - output stream, label/line - row name, mode - read or write, */
+/*       hist - histogram snapshot */
+static void _vector_lock_hist_print(FILE* fp, const char* label, int line,
+                                    const char* mode,
+                                    const vector_lock_histogram* hist)
+{
+    char name[41];
+    if (line)
+        snprintf(name, sizeof(name), "%s:%d", label, line);
+    else
+        snprintf(name, sizeof(name), "%s", label);
+    fprintf(fp, "%-40s %6s %10llu %12llu %10llu %10llu %10llu %10llu %10llu\n",
+            name, mode, (unsigned long long)hist->count,
+            (unsigned long long)hist->total_ns,
+            (unsigned long long)(hist->count ? hist->total_ns / hist->count : 0),
+            (unsigned long long)vector_lock_histogram_percentile(hist, 50.0),
+            (unsigned long long)vector_lock_histogram_percentile(hist, 99.0),
+            (unsigned long long)vector_lock_histogram_percentile(hist, 99.9),
+            (unsigned long long)hist->max_ns);
+}
+
+#if defined(VECTOR_LOCK_PROFILE)
+/* Finds or claims the table slot for a callsite */
+/* Args: file, line - callsite, write - lock mode */
+/* Returns: slot pointer, NULL if the table is full */
+static struct _vector_lock_site* _vector_lock_site_get(const char* file, int line,
+                                                       int write)
+{
+    size_t hash = ((size_t)(uintptr_t)file >> 3) * 31u + (size_t)line * 2u +
+                  (size_t)write;
+    hash *= 0x9E3779B97F4A7C15ull;
+    for (int locked = 0; locked < 2; ++locked)
+    {
+        /* First pass is lock-free; the second claims a slot under the mutex */
+        if (locked)
+            _vector_mutex_lock(&_vector_lock_sites_mutex);
+        struct _vector_lock_site* found = NULL;
+        for (size_t probe = 0; probe < VECTOR_LOCK_PROFILE_SITES; ++probe)
+        {
+            struct _vector_lock_site* site =
+                &_vector_lock_sites[(hash + probe) % VECTOR_LOCK_PROFILE_SITES];
+            if (!__atomic_load_n(&site->used, __ATOMIC_ACQUIRE))
+            {
+                if (locked)
+                {
+                    site->file = file;
+                    site->line = line;
+                    site->write = write;
+                    __atomic_store_n(&site->used, 1, __ATOMIC_RELEASE);
+                    found = site;
+                }
+                break;
+            }
+            if (site->line == line && site->write == write &&
+                (site->file == file || strcmp(site->file, file) == 0))
+            {
+                found = site;
+                break;
+            }
+        }
+        if (locked)
+            _vector_mutex_unlock(&_vector_lock_sites_mutex);
+        if (found)
+            return found;
+    }
+    return NULL;
+}
+#endif
+
+/* Acquires a process-wide instrumentation mutex */
+/* Args: mutex - mutex pointer */
+static void _vector_mutex_lock(_vector_mutex* mutex)
+{
+#if defined(_WIN32)
+    AcquireSRWLockExclusive(mutex);
+#elif defined(__linux__)
+    pthread_mutex_lock(mutex);
+#else
+    (void)mutex;
+#endif
+}
+
+/* Releases a process-wide instrumentation mutex */
+/* Args: mutex - mutex pointer */
+static void _vector_mutex_unlock(_vector_mutex* mutex)
+{
+#if defined(_WIN32)
+    ReleaseSRWLockExclusive(mutex);
+#elif defined(__linux__)
+    pthread_mutex_unlock(mutex);
+#else
+    (void)mutex;
+#endif
+}
+
+/* Raises *target to value if value is larger; safe for concurrent callers */
+/* Args: target - high-water mark, value - candidate */
+static void _vector_atomic_max_size(size_t* target, size_t value)
+{
+    size_t cur = __atomic_load_n(target, __ATOMIC_RELAXED);
+    while (value > cur && !__atomic_compare_exchange_n(target, &cur, value, 1,
+                                                       __ATOMIC_RELAXED,
+                                                       __ATOMIC_RELAXED))
+        ;
+}
+
+/* Lowers *target to value if value is smaller; safe for concurrent callers */
+/* Args: target - running minimum, value - candidate */
+static void _vector_atomic_min_size(size_t* target, size_t value)
+{
+    size_t cur = __atomic_load_n(target, __ATOMIC_RELAXED);
+    while (value < cur && !__atomic_compare_exchange_n(target, &cur, value, 1,
+                                                       __ATOMIC_RELAXED,
+                                                       __ATOMIC_RELAXED))
+        ;
+}
+
+/* Raises *target to value if value is larger; safe for concurrent callers */
+/* Args: target - high-water mark, value - candidate */
+static void _vector_atomic_max_u64(uint64_t* target, uint64_t value)
+{
+    uint64_t cur = __atomic_load_n(target, __ATOMIC_RELAXED);
+    while (value > cur && !__atomic_compare_exchange_n(target, &cur, value, 1,
+                                                       __ATOMIC_RELAXED,
+                                                       __ATOMIC_RELAXED))
+        ;
+}
+
+#if defined(VECTOR_REGISTRY)
+/* Finds or claims the accounting slot for a tag */
+/* Args: name - tag string, NULL for untagged */
+/* Returns: slot pointer; the untagged slot if the table is full */
+static struct _vector_tag* _vector_registry_tag_get(const char* name)
+{
+    if (!name)
+        return &_vector_registry_tags[0];
+    for (int locked = 0; locked < 2; ++locked)
+    {
+        /* First pass is lock-free; the second claims a slot under the mutex */
+        if (locked)
+            _vector_mutex_lock(&_vector_registry_tags_mutex);
+        struct _vector_tag* found = NULL;
+        for (size_t i = 1; i < VECTOR_REGISTRY_TAGS; ++i)
+        {
+            struct _vector_tag* slot = &_vector_registry_tags[i];
+            if (!__atomic_load_n(&slot->used, __ATOMIC_ACQUIRE))
+            {
+                if (locked)
+                {
+                    slot->name = name;
+                    __atomic_store_n(&slot->used, 1, __ATOMIC_RELEASE);
+                    found = slot;
+                }
+                break;
+            }
+            if (slot->name == name || strcmp(slot->name, name) == 0)
+            {
+                found = slot;
+                break;
+            }
+        }
+        if (locked)
+            _vector_mutex_unlock(&_vector_registry_tags_mutex);
+        if (found)
+            return found;
+    }
+    return &_vector_registry_tags[0];
+}
+#endif
+
+/* Links a new vector into the registry and charges its initial capacity */
+/* Args: vec - vector pointer */
+static void _vector_registry_add(vector* vec)
+{
+#if defined(VECTOR_REGISTRY)
+    vec->registry.tag = &_vector_registry_tags[0];
+    vec->registry.accounted_bytes = 0;
+    vec->registry.prev = NULL;
+    __atomic_fetch_add(&vec->registry.tag->live_vectors, 1, __ATOMIC_RELAXED);
+    _vector_mutex_lock(&_vector_registry_mutex);
+    vec->registry.next = _vector_registry_head;
+    if (_vector_registry_head)
+        _vector_registry_head->registry.prev = vec;
+    _vector_registry_head = vec;
+    _vector_mutex_unlock(&_vector_registry_mutex);
+    size_t live = __atomic_add_fetch(&_vector_registry_live, 1, __ATOMIC_RELAXED);
+    _vector_atomic_max_size(&_vector_registry_live_peak, live);
+    _vector_registry_charge(vec);
+#else
+    (void)vec;
+#endif
+}
+
+/* Unlinks a vector from the registry and releases its charged capacity */
+/* Args: vec - vector pointer */
+static void _vector_registry_remove(vector* vec)
 {
-    if (fwrite(&vec->length, sizeof(size_t), 1, fp) != 1 ||
-        fwrite(&vec->element_size, sizeof(size_t), 1, fp) != 1 ||
-        fwrite(vec->data, vec->element_size, vec->length, fp) != vec->length)
-        return -1;
-    return 0;
+#if defined(VECTOR_REGISTRY)
+    _vector_mutex_lock(&_vector_registry_mutex);
+    if (vec->registry.prev)
+        vec->registry.prev->registry.next = vec->registry.next;
+    else
+        _vector_registry_head = vec->registry.next;
+    if (vec->registry.next)
+        vec->registry.next->registry.prev = vec->registry.prev;
+    _vector_mutex_unlock(&_vector_registry_mutex);
+    size_t bytes = vec->registry.accounted_bytes;
+    __atomic_fetch_sub(&vec->registry.tag->capacity_bytes, bytes, __ATOMIC_RELAXED);
+    __atomic_fetch_sub(&vec->registry.tag->live_vectors, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_sub(&_vector_registry_capacity, bytes, __ATOMIC_RELAXED);
+    __atomic_fetch_sub(&_vector_registry_live, 1, __ATOMIC_RELAXED);
+    vec->registry.accounted_bytes = 0;
+#else
+    (void)vec;
+#endif
 }
 
-/* Deserializes vector from file */
-/* Args: fp - file pointer, element_size - size of each element */
-/* Returns: new vector pointer, NULL on failure */
-static vector* _vector_deserialize_internal(FILE* fp, size_t element_size)
+/* Brings the registry's view of a vector's capacity up to date */
+/* Args: vec - vector pointer (caller holds the write lock or owns it) */
+static void _vector_registry_charge(vector* vec)
 {
-    size_t length, read_element_size;
-    if (fread(&length, sizeof(size_t), 1, fp) != 1 ||
-        fread(&read_element_size, sizeof(size_t), 1, fp) != 1 ||
-        read_element_size != element_size)
-        return NULL;
-    vector* vec = _vector_create_base(element_size, length);
-    if (!vec || fread(vec->data, element_size, length, fp) != length)
+#if defined(VECTOR_REGISTRY)
+    size_t bytes = vec->capacity * vec->element_size;
+    size_t old_bytes = vec->registry.accounted_bytes;
+    struct _vector_tag* tag = vec->registry.tag;
+    if (bytes == old_bytes)
+        return;
+    vec->registry.accounted_bytes = bytes;
+    if (bytes > old_bytes)
     {
-        vector_free(vec);
-        return NULL;
+        size_t delta = bytes - old_bytes;
+        size_t total = __atomic_add_fetch(&_vector_registry_capacity, delta,
+                                          __ATOMIC_RELAXED);
+        _vector_atomic_max_size(&_vector_registry_capacity_peak, total);
+        size_t tagged = __atomic_add_fetch(&tag->capacity_bytes, delta,
+                                           __ATOMIC_RELAXED);
+        _vector_atomic_max_size(&tag->capacity_bytes_peak, tagged);
+        __atomic_fetch_add(&tag->grown_bytes, delta, __ATOMIC_RELAXED);
     }
-    return vec;
+    else
+    {
+        size_t delta = old_bytes - bytes;
+        __atomic_fetch_sub(&_vector_registry_capacity, delta, __ATOMIC_RELAXED);
+        __atomic_fetch_sub(&tag->capacity_bytes, delta, __ATOMIC_RELAXED);
+    }
+#else
+    (void)vec;
+#endif
 }
 
-/* Shrinks capacity to fit length */
-/* Args: vec - vector pointer */
-/* Returns: 0 on success, -1 on failure */
-static int _vector_shrink_to_fit_internal(vector* vec)
+#if defined(VECTOR_ALLOC_SITES)
+/* Finds or creates the slot for an allocation callsite */
+/* Args: file, line - callsite */
+/* Returns: slot pointer, the unattributed slot if the table is full */
+static struct _vector_alloc_site* _vector_alloc_site_get(const char* file, int line)
 {
-    if (vec->capacity == vec->length)
-        return 0;
-    size_t new_size;
-    if (_safe_mul(vec->length, vec->element_size, &new_size) == -1)
-        return -1;
-    void* new_data = vec->length ? vec->allocator.realloc(vec->data, new_size) : NULL;
-    if (vec->length && !new_data)
-        return -1;
-    if (!vec->length && vec->data)
-        vec->allocator.free(vec->data);
-    vec->data = new_data;
-    vec->capacity = vec->length;
-    return 0;
+    size_t hash = ((size_t)(uintptr_t)file >> 3) * 31u + (size_t)line;
+    hash *= 0x9E3779B97F4A7C15ull;
+    for (int locked = 0; locked < 2; ++locked)
+    {
+        /* First pass is lock-free; the second claims a slot under the mutex */
+        if (locked)
+            _vector_mutex_lock(&_vector_alloc_sites_mutex);
+        struct _vector_alloc_site* found = NULL;
+        for (size_t probe = 0; probe < VECTOR_ALLOC_SITES_MAX; ++probe)
+        {
+            struct _vector_alloc_site* site =
+                &_vector_alloc_sites[(hash + probe) % VECTOR_ALLOC_SITES_MAX];
+            if (!__atomic_load_n(&site->used, __ATOMIC_ACQUIRE))
+            {
+                if (locked)
+                {
+                    site->file = file;
+                    site->line = line;
+                    __atomic_store_n(&site->used, 1, __ATOMIC_RELEASE);
+                    found = site;
+                }
+                break;
+            }
+            if (site->line == line &&
+                (site->file == file || strcmp(site->file, file) == 0))
+            {
+                found = site;
+                break;
+            }
+        }
+        if (locked)
+            _vector_mutex_unlock(&_vector_alloc_sites_mutex);
+        if (found)
+            return found;
+    }
+    return &_vector_alloc_site_unknown;
 }
 
-/* Swaps two elements in vector */
-/* Args: vec - vector pointer, idx1 - first index, idx2 - second index */
-/* Returns: 0 on success, -1 on failure */
-static int _vector_swap_internal(vector* vec, size_t idx1, size_t idx2)
+/* Snapshots a callsite slot */
+static void _vector_alloc_site_copy(vector_alloc_site_stats* dst,
+                                    const struct _vector_alloc_site* src)
 {
-    if (idx1 >= vec->length || idx2 >= vec->length)
-        return -1;
-    if (idx1 == idx2)
-        return 0;
-    char temp[vec->element_size];
-    void* ptr1 = (char*)vec->data + idx1 * vec->element_size;
-    void* ptr2 = (char*)vec->data + idx2 * vec->element_size;
-    memcpy(temp, ptr1, vec->element_size);
-    memcpy(ptr1, ptr2, vec->element_size);
-    memcpy(ptr2, temp, vec->element_size);
-    return 0;
+    dst->file = src->file;
+    dst->line = src->line;
+    dst->live_vectors = __atomic_load_n(&src->live_vectors, __ATOMIC_RELAXED);
+    dst->live_bytes = __atomic_load_n(&src->live_bytes, __ATOMIC_RELAXED);
+    dst->live_bytes_peak = __atomic_load_n(&src->live_bytes_peak, __ATOMIC_RELAXED);
+    dst->allocations = __atomic_load_n(&src->allocations, __ATOMIC_RELAXED);
+    dst->reallocations = __atomic_load_n(&src->reallocations, __ATOMIC_RELAXED);
+    dst->realloc_bytes = __atomic_load_n(&src->realloc_bytes, __ATOMIC_RELAXED);
 }
+#endif
 
-/* Default allocator: allocates aligned memory */
-/* Args: size - bytes to allocate */
-/* Returns: pointer to allocated memory, NULL on failure */
-static void* default_alloc(size_t size)
+/* Charges a vector's buffer to the callsite of the public call in progress */
+/* Args: vec - vector pointer (caller holds the write lock or owns it), */
+/*       created - 1 for the initial allocation, 0 for a reallocation */
+/* Note: without a callsite the vector's creating callsite is charged */
+static void _vector_alloc_site_charge(vector* vec, int created)
 {
-#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
-    return aligned_alloc(VECTOR_DEFAULT_ALIGNMENT, size); /* C11 */
+#if defined(VECTOR_ALLOC_SITES)
+    struct _vector_alloc_site* site = _vector_alloc_site_file ?
+        _vector_alloc_site_get(_vector_alloc_site_file, _vector_alloc_site_line) :
+        NULL;
+    if (created)
+    {
+        vec->alloc_site.created = site ? site : &_vector_alloc_site_unknown;
+        vec->alloc_site.charged = NULL;
+        vec->alloc_site.charged_bytes = 0;
+    }
+    if (!site)
+        site = vec->alloc_site.created;
+    _vector_alloc_site_release(vec);
+    size_t bytes = vec->capacity * vec->element_size;
+    size_t live = __atomic_add_fetch(&site->live_bytes, bytes, __ATOMIC_RELAXED);
+    _vector_atomic_max_size(&site->live_bytes_peak, live);
+    __atomic_fetch_add(&site->live_vectors, 1, __ATOMIC_RELAXED);
+    if (created)
+        __atomic_fetch_add(&site->allocations, 1, __ATOMIC_RELAXED);
+    else
+    {
+        __atomic_fetch_add(&site->reallocations, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&site->realloc_bytes, bytes, __ATOMIC_RELAXED);
+    }
+    vec->alloc_site.charged = site;
+    vec->alloc_site.charged_bytes = bytes;
 #else
-    return malloc(size); /* C99 */
+    (void)vec;
+    (void)created;
 #endif
 }
 
-/* Default realloc: resizes memory */
-/* Args: ptr - pointer to resize, size - new size */
-/* Returns: pointer to reallocated memory, NULL on failure */
-static void* default_realloc(void* ptr, size_t size)
+/* Releases a vector's buffer from the callsite it is charged to */
+/* Args: vec - vector pointer */
+static void _vector_alloc_site_release(vector* vec)
 {
-    return realloc(ptr, size);
+#if defined(VECTOR_ALLOC_SITES)
+    struct _vector_alloc_site* site = vec->alloc_site.charged;
+    if (!site)
+        return;
+    __atomic_fetch_sub(&site->live_bytes, vec->alloc_site.charged_bytes,
+                       __ATOMIC_RELAXED);
+    __atomic_fetch_sub(&site->live_vectors, 1, __ATOMIC_RELAXED);
+    vec->alloc_site.charged = NULL;
+    vec->alloc_site.charged_bytes = 0;
+#else
+    (void)vec;
+#endif
 }
 
-/* Default free: deallocates memory */
-/* Args: ptr - pointer to free */
-static void default_free(void* ptr)
+#if defined(VECTOR_TRACE)
+/* Writes buffered trace records; caller holds _vector_trace_mutex */
+static void _vector_trace_flush_locked(void)
 {
-    free(ptr);
+    size_t used = _vector_trace_state.used;
+    if (used && fwrite(_vector_trace_state.buffer, sizeof(vector_trace_record),
+                       used, _vector_trace_state.fp) != used)
+        _vector_trace_state.failed = 1;
+    _vector_trace_state.used = 0;
 }
 
-/* Default error callback: prints to stderr */
-/* Args: message - error message to print */
-static void default_error_callback(const char* message)
+/* Appends one record to the active trace; no-op when tracing is stopped */
+/* Args: op - operation, vec - vector, index/count - see vector_trace_op */
+/* Note: called with the vector's lock held, so records of one vector */
+/*       appear in the order its operations took effect */
+VECTOR_API void _vector_trace_record(vector_trace_op op, const vector* vec,
+                                     uint64_t index, uint64_t count)
 {
-    fprintf(stderr, "%s\n", message);
+    if (!__atomic_load_n(&_vector_trace_state.active, __ATOMIC_RELAXED))
+        return;
+    if (!_vector_trace_thread)
+        _vector_trace_thread = __atomic_add_fetch(&_vector_trace_next_thread, 1,
+                                                  __ATOMIC_RELAXED);
+    uint64_t now = _vector_now_ns();
+    _vector_mutex_lock(&_vector_trace_mutex);
+    if (_vector_trace_state.active)
+    {
+        vector_trace_record* rec =
+            &_vector_trace_state.buffer[_vector_trace_state.used++];
+        rec->timestamp_ns = now > _vector_trace_state.start_ns ?
+                            now - _vector_trace_state.start_ns : 0;
+        rec->index = index;
+        rec->count = count;
+        rec->vector_id = vec->trace_id;
+        rec->op = (uint16_t)op;
+        rec->thread_id = _vector_trace_thread;
+        if (_vector_trace_state.used == VECTOR_TRACE_BUFFER)
+            _vector_trace_flush_locked();
+    }
+    _vector_mutex_unlock(&_vector_trace_mutex);
 }
+#endif
 
-/* Static error callback variable */
-static vector_error_callback error_callback = default_error_callback;
-
-/* Sets error callback function */
-/* Args: callback - function to handle errors */
-void vector_set_error_callback(vector_error_callback callback)
+/* Records a reallocation of vec->data in the statistics counters */
+/* Args: vec - vector pointer (already updated), old_data - previous buffer, */
+/*       old_capacity - previous capacity in elements */
+static void _vector_note_realloc(vector* vec, const void* old_data,
+                                 size_t old_capacity)
 {
-    error_callback = callback ? callback : default_error_callback;
+    _VECTOR_PROBE4(realloc, vec, old_capacity, vec->capacity, vec->element_size);
+#if defined(VECTOR_STATS)
+    _VECTOR_STAT_ADD(vec, reallocations, 1);
+    if (old_data && vec->data && vec->data != old_data)
+    {
+        size_t kept = old_capacity < vec->capacity ? old_capacity : vec->capacity;
+        _VECTOR_STAT_ADD(vec, growth_bytes_copied, kept * vec->element_size);
+    }
+    if (vec->capacity > vec->stats.peak_capacity)
+        __atomic_store_n(&vec->stats.peak_capacity, vec->capacity,
+                         __ATOMIC_RELAXED);
+#else
+    (void)old_data;
+    (void)old_capacity;
+#endif
+    _vector_registry_charge(vec);
+    _vector_alloc_site_charge(vec, 0);
 }
 
-/* Formats and dispatches error messages */
-/* Args: format - format string, ... - variable arguments */
-static void _vector_error(const char* format, ...)
+#if defined(_VECTOR_LOCK_TIMED)
+/* Records a lock acquisition that had to wait */
+/* Args: vec - vector pointer, write - lock mode, ns - wait time, */
+/*       file, line - callsite (NULL/0 when unknown) */
+static void _vector_note_lock_wait(vector* vec, int write, uint64_t ns,
+                                   const char* file, int line)
 {
-    if (error_callback)
+    _VECTOR_STAT_ADD(vec, lock_contentions, 1);
+    _VECTOR_STAT_ADD(vec, lock_wait_ns, ns);
+#if defined(VECTOR_LOCK_PROFILE)
+    _vector_lock_hist_record(&vec->lock_wait[write], ns);
+    if (file)
     {
-        char msg[256];
-        va_list args;
-        va_start(args, format);
-        vsnprintf(msg, sizeof(msg), format, args);
-        va_end(args);
-        error_callback(msg);
+        struct _vector_lock_site* site = _vector_lock_site_get(file, line, write);
+        if (site)
+            _vector_lock_hist_record(&site->hist, ns);
+        else
+            __atomic_fetch_add(&_vector_lock_sites_dropped, 1, __ATOMIC_RELAXED);
     }
+#else
+    (void)write;
+    (void)file;
+    (void)line;
+#endif
 }
+#endif
 
-/* Locks vector for reading */
-/* Args: vec - vector pointer */
-static void vector_rdlock(vector* vec)
+/* Locks vector for reading, attributing contention to a callsite */
+/* Args: vec - vector pointer, file, line - callsite (NULL/0 when unknown) */
+VECTOR_API void _vector_rdlock_at(vector* vec, const char* file, int line)
 {
     if (!vec)
         return;
+#if defined(VECTOR_LOCK_PROFILE)
+    /* Locks taken inside a public call are charged to its caller */
+    if (_vector_lock_site_file)
+    {
+        file = _vector_lock_site_file;
+        line = _vector_lock_site_line;
+    }
+#endif
+#if defined(_VECTOR_LOCK_TRY)
+    /* Only observe the acquisition when the uncontended attempt fails */
+    _VECTOR_STAT_ADD(vec, lock_acquisitions, 1);
+#if defined(_WIN32)
+    if (TryAcquireSRWLockShared(&vec->rwlock))
+        return;
+#elif defined(__linux__)
+    if (pthread_rwlock_tryrdlock(&vec->rwlock) == 0)
+        return;
+#endif
+    _VECTOR_PROBE2(lock__wait__start, vec, 0);
+#endif
+#if defined(_VECTOR_LOCK_TIMED)
+    uint64_t wait_start = _vector_now_ns();
+#else
+    (void)file;
+    (void)line;
+#endif
 #if defined(_WIN32)
     AcquireSRWLockShared(&vec->rwlock);
 #elif defined(__linux__)
     pthread_rwlock_rdlock(&vec->rwlock);
 #endif
+#if defined(_VECTOR_LOCK_TIMED)
+    _vector_note_lock_wait(vec, 0, _vector_now_ns() - wait_start, file, line);
+#endif
+#if defined(_VECTOR_LOCK_TRY)
+    _VECTOR_PROBE2(lock__wait__done, vec, 0);
+#endif
 }
 
-/* Locks vector for writing */
-/* Args: vec - vector pointer */
-static void vector_wrlock(vector* vec)
+/* Locks vector for writing, attributing contention to a callsite */
+/* Args: vec - vector pointer, file, line - callsite (NULL/0 when unknown) */
+VECTOR_API void _vector_wrlock_at(vector* vec, const char* file, int line)
 {
     if (!vec)
         return;
+#if defined(VECTOR_LOCK_PROFILE)
+    /* Locks taken inside a public call are charged to its caller */
+    if (_vector_lock_site_file)
+    {
+        file = _vector_lock_site_file;
+        line = _vector_lock_site_line;
+    }
+#endif
+#if defined(_VECTOR_LOCK_TRY)
+    /* Only observe the acquisition when the uncontended attempt fails */
+    _VECTOR_STAT_ADD(vec, lock_acquisitions, 1);
+#if defined(_WIN32)
+    if (TryAcquireSRWLockExclusive(&vec->rwlock))
+        return;
+#elif defined(__linux__)
+    if (pthread_rwlock_trywrlock(&vec->rwlock) == 0)
+        return;
+#endif
+    _VECTOR_PROBE2(lock__wait__start, vec, 1);
+#endif
+#if defined(_VECTOR_LOCK_TIMED)
+    uint64_t wait_start = _vector_now_ns();
+#else
+    (void)file;
+    (void)line;
+#endif
 #if defined(_WIN32)
     AcquireSRWLockExclusive(&vec->rwlock);
 #elif defined(__linux__)
     pthread_rwlock_wrlock(&vec->rwlock);
 #endif
+#if defined(_VECTOR_LOCK_TIMED)
+    _vector_note_lock_wait(vec, 1, _vector_now_ns() - wait_start, file, line);
+#endif
+#if defined(_VECTOR_LOCK_TRY)
+    _VECTOR_PROBE2(lock__wait__done, vec, 1);
+#endif
+}
+
+/* Locks vector for reading */
+/* Args: vec - vector pointer */
+/* Note: name is parenthesized so the VECTOR_LOCK_PROFILE macro does not apply */
+VECTOR_API void (vector_rdlock)(vector* vec)
+{
+    _vector_rdlock_at(vec, NULL, 0);
+}
+
+/* Locks vector for writing */
+/* Args: vec - vector pointer */
+/* Note: name is parenthesized so the VECTOR_LOCK_PROFILE macro does not apply */
+VECTOR_API void (vector_wrlock)(vector* vec)
+{
+    _vector_wrlock_at(vec, NULL, 0);
+}
+
+/* Tries to lock vector for reading without blocking */
+/* Args: vec - vector pointer */
+/* Returns: 1 if the read lock was taken, 0 if it is held for writing or */
+/*          vec is NULL */
+VECTOR_API int vector_tryrdlock(vector* vec)
+{
+    if (!vec)
+        return 0;
+#if defined(_WIN32)
+    if (!TryAcquireSRWLockShared(&vec->rwlock))
+        return 0;
+#elif defined(__linux__)
+    if (pthread_rwlock_tryrdlock(&vec->rwlock) != 0)
+        return 0;
+#endif
+    _VECTOR_STAT_ADD(vec, lock_acquisitions, 1);
+    return 1;
+}
+
+/* Tries to lock vector for writing without blocking */
+/* Args: vec - vector pointer */
+/* Returns: 1 if the write lock was taken, 0 if it is held or vec is NULL */
+VECTOR_API int vector_trywrlock(vector* vec)
+{
+    if (!vec)
+        return 0;
+#if defined(_WIN32)
+    if (!TryAcquireSRWLockExclusive(&vec->rwlock))
+        return 0;
+#elif defined(__linux__)
+    if (pthread_rwlock_trywrlock(&vec->rwlock) != 0)
+        return 0;
+#endif
+    _VECTOR_STAT_ADD(vec, lock_acquisitions, 1);
+    return 1;
 }
 
 /* Unlocks vector */
 /* Args: vec - vector pointer */
-static void vector_unlock(vector* vec)
+VECTOR_API void vector_unlock(vector* vec)
 {
     if (!vec)
         return;
@@ -971,6 +5353,346 @@ static void vector_unlock(vector* vec)
 #endif
 }
 
+/* Exchanges buffers, sizes, allocators and their accounting between two */
+/* vectors; caller holds both write locks */
+/* Args: a, b - distinct vectors with the same element size */
+static void _vector_exchange_buffers(vector* a, vector* b)
+{
+    void* data = a->data;
+    size_t length = a->length, capacity = a->capacity;
+    vector_allocator allocator = a->allocator;
+    a->data = b->data;
+    a->length = b->length;
+    a->capacity = b->capacity;
+    a->allocator = b->allocator;
+    b->data = data;
+    b->length = length;
+    b->capacity = capacity;
+    b->allocator = allocator;
+#if defined(VECTOR_STATS)
+    _vector_atomic_max_size(&a->stats.peak_capacity, a->capacity);
+    _vector_atomic_max_size(&b->stats.peak_capacity, b->capacity);
+#endif
+    _vector_registry_charge(a);
+    _vector_registry_charge(b);
+#if defined(VECTOR_ALLOC_SITES)
+    /* Each buffer stays charged to the callsite that allocated it */
+    struct _vector_alloc_site* site = a->alloc_site.charged;
+    size_t bytes = a->alloc_site.charged_bytes;
+    a->alloc_site.charged = b->alloc_site.charged;
+    a->alloc_site.charged_bytes = b->alloc_site.charged_bytes;
+    b->alloc_site.charged = site;
+    b->alloc_site.charged_bytes = bytes;
+#endif
+}
+
+/* Locks two vectors in a global (address) order so that concurrent callers */
+/* locking the same pair cannot deadlock */
+/* Args: a, b - vectors (may be equal), a_write/b_write - 1 for a write lock */
+/* Note: if a == b it is locked once, for writing if either side writes */
+static void _vector_lock_ordered(vector* a, int a_write, vector* b, int b_write)
+{
+    if (a == b)
+    {
+        if (a_write || b_write)
+            vector_wrlock(a);
+        else
+            vector_rdlock(a);
+        return;
+    }
+    if ((uintptr_t)b < (uintptr_t)a)
+    {
+        vector* v = a; a = b; b = v;
+        int w = a_write; a_write = b_write; b_write = w;
+    }
+    if (a_write)
+        vector_wrlock(a);
+    else
+        vector_rdlock(a);
+    if (b_write)
+        vector_wrlock(b);
+    else
+        vector_rdlock(b);
+}
+
+/* Counts the threads a parallel call made from this thread can use */
+/* Returns: pool workers plus the caller, 1 if the call must run inline */
+/*          (always 1 outside Linux) */
+static size_t _vector_parallel_threads(void)
+{
+#if defined(__linux__)
+    if (_vector_pool_inside)
+        return 1;
+    pthread_once(&_vector_pool_once, _vector_pool_start);
+    return _vector_pool_size + 1;
+#else
+    return 1;
+#endif
+}
+
+/* Chooses the number of elements per task of a parallel job */
+/* Args: length - elements, element_size - bytes per element, grain - */
+/*       minimum elements per task (0 for the default) */
+/* Returns: task size, length when the job should run as one task */
+static size_t _vector_parallel_task(size_t length, size_t element_size, size_t grain)
+{
+    size_t es = element_size ? element_size : 1;
+    if (grain == 0)
+        grain = VECTOR_PARALLEL_GRAIN_BYTES / es;
+    if (grain == 0)
+        grain = 1;
+    if (length <= grain)
+        return length;
+    size_t threads = _vector_parallel_threads();
+    if (threads < 2)
+        return length;
+    /* Tasks hold a multiple of line / gcd(es, line) elements, so their */
+    /* bytes are a whole number of cache lines */
+    size_t a = es, b = VECTOR_CACHE_LINE;
+    while (b)
+    {
+        size_t t = a % b;
+        a = b;
+        b = t;
+    }
+    size_t align = VECTOR_CACHE_LINE / a;
+    /* About four tasks per thread evens out uneven ranges */
+    size_t task = length / (threads * 4);
+    if (task < grain)
+        task = grain;
+    return (task + align - 1) / align * align;
+}
+
+/* Splits a job into tasks: sets task (unless preset), head and tasks */
+/* Args: job - job with length and base set, element_size - bytes per */
+/*       element, grain - minimum elements per task (0 for the default) */
+/* Note: heap buffers are only 16-byte aligned, so the first task is */
+/* shortened until base + head elements is the start of a cache line; */
+/* neighbouring tasks then never write the same line. Element sizes for */
+/* which no element starts on a line boundary keep whole tasks. */
+static void _vector_parallel_plan(_vector_parallel_job* job, size_t element_size,
+                                  size_t grain)
+{
+    if (job->task == 0)
+        job->task = _vector_parallel_task(job->length, element_size, grain);
+    job->head = job->task;
+    if (job->base && job->task < job->length && element_size)
+    {
+        size_t lead = (size_t)(-(uintptr_t)job->base) % VECTOR_CACHE_LINE;
+        for (size_t h = 1; lead && h < job->task; ++h)
+        {
+            if (h * element_size % VECTOR_CACHE_LINE == lead)
+            {
+                job->head = h;
+                break;
+            }
+            /* Offsets repeat after one line's worth of elements */
+            if (h >= VECTOR_CACHE_LINE)
+                break;
+        }
+    }
+    if (job->length == 0)
+        job->tasks = 0;
+    else if (job->length <= job->head)
+        job->tasks = 1;
+    else
+        job->tasks = 1 + (job->length - job->head + job->task - 1) / job->task;
+}
+
+/* Returns the index of the task that starts at element begin */
+/* Args: job - planned job, begin - first element of a task */
+static size_t _vector_parallel_task_index(const _vector_parallel_job* job,
+                                          size_t begin)
+{
+    return begin < job->head ? 0 : 1 + (begin - job->head) / job->task;
+}
+
+/* Runs a parallel job on the worker pool and the calling thread */
+/* Args: job - job with run, arg and length set, and task set or 0 to */
+/*       choose it, element_size - bytes per element, grain - minimum */
+/*       elements per task (0 for the default) */
+/* Note: returns when every task has run. Tasks run on the calling thread, */
+/* in order, outside Linux or when the pool is busy with another caller. */
+static void _vector_parallel_run(_vector_parallel_job* job, size_t element_size,
+                                 size_t grain)
+{
+    if (job->tasks == 0)
+        _vector_parallel_plan(job, element_size, grain);
+    job->next = 0;
+    job->workers = 0;
+#if defined(__linux__)
+    size_t tasks = job->tasks;
+    if (tasks > 1 && !_vector_pool_inside && _vector_pool_size &&
+        pthread_mutex_trylock(&_vector_pool_busy) == 0)
+    {
+        job->workers = tasks - 1 < _vector_pool_size ? tasks - 1 : _vector_pool_size;
+        _vector_pool_inside = 1;
+        pthread_mutex_lock(&_vector_pool_mutex);
+        _vector_pool_job = job;
+        _vector_pool_pending = job->workers;
+        _vector_pool_generation++;
+        pthread_cond_broadcast(&_vector_pool_wake);
+        pthread_mutex_unlock(&_vector_pool_mutex);
+
+        _vector_parallel_work(job);
+
+        pthread_mutex_lock(&_vector_pool_mutex);
+        while (_vector_pool_pending)
+            pthread_cond_wait(&_vector_pool_done, &_vector_pool_mutex);
+        _vector_pool_job = NULL;
+        pthread_mutex_unlock(&_vector_pool_mutex);
+        _vector_pool_inside = 0;
+        pthread_mutex_unlock(&_vector_pool_busy);
+        return;
+    }
+#endif
+    _vector_parallel_work(job);
+}
+
+/* Claims and runs tasks of a job until none are left */
+/* Args: job - running job */
+static void _vector_parallel_work(_vector_parallel_job* job)
+{
+    for (;;)
+    {
+        size_t index = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED);
+        if (index >= job->tasks)
+            break;
+        size_t begin = index ? job->head + (index - 1) * job->task : 0;
+        size_t end = index ? begin + job->task : job->head;
+        job->run(job, begin, end < job->length ? end : job->length);
+    }
+}
+
+#if defined(__linux__)
+/* Starts the worker pool; runs once per process */
+static void _vector_pool_start(void)
+{
+    size_t threads = VECTOR_PARALLEL_THREADS;
+    if (threads == 0)
+    {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (size_t)cpus : 1;
+    }
+    if (threads > VECTOR_PARALLEL_MAX_THREADS)
+        threads = VECTOR_PARALLEL_MAX_THREADS;
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    for (size_t i = 0; i + 1 < threads; ++i)
+    {
+        pthread_t thread;
+        if (pthread_create(&thread, &attr, _vector_pool_worker,
+                           (void*)(uintptr_t)i) != 0)
+            break;
+        _vector_pool_size++;
+    }
+    pthread_attr_destroy(&attr);
+    pthread_atfork(NULL, NULL, _vector_pool_after_fork);
+}
+
+/* Forked children have no workers; their parallel calls run inline */
+static void _vector_pool_after_fork(void)
+{
+    _vector_pool_size = 0;
+    _vector_pool_job = NULL;
+    _vector_pool_pending = 0;
+    pthread_mutex_init(&_vector_pool_busy, NULL);
+    pthread_mutex_init(&_vector_pool_mutex, NULL);
+}
+
+/* Worker thread: joins every job whose worker count covers its index */
+/* Args: arg - worker index */
+static void* _vector_pool_worker(void* arg)
+{
+    size_t index = (size_t)(uintptr_t)arg;
+    uint64_t seen = 0;
+    _vector_pool_inside = 1;
+    pthread_mutex_lock(&_vector_pool_mutex);
+    for (;;)
+    {
+        while (_vector_pool_generation == seen)
+            pthread_cond_wait(&_vector_pool_wake, &_vector_pool_mutex);
+        seen = _vector_pool_generation;
+        _vector_parallel_job* job = _vector_pool_job;
+        if (!job || index >= job->workers)
+            continue;
+        pthread_mutex_unlock(&_vector_pool_mutex);
+        _vector_parallel_work(job);
+        pthread_mutex_lock(&_vector_pool_mutex);
+        if (--_vector_pool_pending == 0)
+            pthread_cond_signal(&_vector_pool_done);
+    }
+    return NULL;
+}
+#endif
+
+/* Releases locks taken by _vector_lock_ordered */
+/* Args: a, b - the same vectors */
+static void _vector_unlock_ordered(vector* a, vector* b)
+{
+    if (a != b)
+        vector_unlock(b);
+    vector_unlock(a);
+}
+
+/* Sorts three vectors by address and merges repeats */
+/* Args: vecs - vectors, write - per vector, 1 for a write lock; both are */
+/*       rewritten in lock order with repeats removed */
+/* Returns: number of distinct vectors */
+static size_t _vector_sort_locks(vector* vecs[3], int write[3])
+{
+    for (size_t i = 1; i < 3; ++i)
+        for (size_t j = i; j > 0 && (uintptr_t)vecs[j] < (uintptr_t)vecs[j - 1]; --j)
+        {
+            vector* v = vecs[j]; vecs[j] = vecs[j - 1]; vecs[j - 1] = v;
+            int w = write[j]; write[j] = write[j - 1]; write[j - 1] = w;
+        }
+    size_t n = 1;
+    for (size_t i = 1; i < 3; ++i)
+    {
+        if (vecs[i] == vecs[n - 1])
+            write[n - 1] |= write[i];
+        else
+        {
+            vecs[n] = vecs[i];
+            write[n] = write[i];
+            ++n;
+        }
+    }
+    return n;
+}
+
+/* Locks three vectors in address order, each vector once */
+/* Args: a, b, c - vectors (may repeat), a_write/b_write/c_write - 1 for a */
+/*       write lock; a repeated vector is write-locked if any use writes */
+static void _vector_lock_ordered3(vector* a, int a_write, vector* b, int b_write,
+                                  vector* c, int c_write)
+{
+    vector* vecs[3] = { a, b, c };
+    int write[3] = { a_write, b_write, c_write };
+    size_t n = _vector_sort_locks(vecs, write);
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (write[i])
+            vector_wrlock(vecs[i]);
+        else
+            vector_rdlock(vecs[i]);
+    }
+}
+
+/* Releases locks taken by _vector_lock_ordered3 */
+/* Args: a, b, c - the same vectors */
+static void _vector_unlock_ordered3(vector* a, vector* b, vector* c)
+{
+    vector* vecs[3] = { a, b, c };
+    int write[3] = { 0, 0, 0 };
+    size_t n = _vector_sort_locks(vecs, write);
+    while (n > 0)
+        vector_unlock(vecs[--n]);
+}
+
 /* Safe addition */
 /* Args: a - first number, b - second number, result - sum */
 /* Returns: 0 on success, -1 on overflow */
@@ -993,5 +5715,7 @@ static int _safe_mul(size_t a, size_t b, size_t* result)
     return 0;
 }
 
+#endif /* VECTOR_IMPLEMENTATION */
+
 #endif /* __VECTOR_H__ */
 
@@ -0,0 +1,334 @@
+/*
+ * vector.hpp - Typed C++ wrapper for vector.h
+ * Copyright (C) 2025 Stefan Froberg <stefan.froberg@protonmail.com>
+ *
+ * Overview:
+ * vec::vector<T> owns a C vector with element_size == sizeof(T) and exposes
+ * it with std::vector-style members. Elements are reached through T*, so
+ * indexing, iteration and the loads and stores in push_back compile to
+ * typed accesses with a constant element size, and std::sort or
+ * std::lower_bound inline their comparators. Moves steal the C vector or its
+ * buffer in O(1). Failures throw (std::bad_alloc, std::out_of_range,
+ * std::length_error, std::invalid_argument or std::runtime_error).
+ *
+ * Builds on the compiled library: link libvector (see Makefile), built with
+ * the same VECTOR_* feature macros as the C++ code.
+ *
+ * Thread Safety:
+ *   Members that change the vector (push_back, insert, erase, reserve,
+ *   resize, ...) call the C API, which takes the vector's write lock for the
+ *   length of the call. Element access, iteration and size() do not lock.
+ *   Code that shares a vector across threads needs its own synchronization
+ *   around element access, and must not hold the C vector's lock (see
+ *   handle()) across a member call, since the member locks it again.
+ *
+ * Usage Example:
+ *   vec::vector<int> v{3, 1, 2};
+ *   v.push_back(4);
+ *   std::sort(v.begin(), v.end());
+ *   bool has_two = std::binary_search(v.begin(), v.end(), 2);
+ *
+ * Notes:
+ * - T must be trivially copyable: the C library moves elements with memcpy.
+ * - A moved-from vector is empty and allocates again when it next grows.
+ */
+#ifndef __VECTOR_HPP__
+#define __VECTOR_HPP__
+
+#ifndef VECTOR_LIB
+#define VECTOR_LIB
+#endif
+#include "vector.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#if __cplusplus >= 202002L && defined(__has_include)
+#if __has_include(<span>)
+#include <span>
+#define VECTOR_HPP_HAVE_SPAN
+#endif
+#endif
+
+namespace vec {
+
+namespace detail {
+
+/* Throws the exception matching the calling thread's last vector error */
+[[noreturn]] inline void throw_last_error(const char* what)
+{
+    switch (vector_last_error())
+    {
+    case VECTOR_ERR_NOMEM:    throw std::bad_alloc();
+    case VECTOR_ERR_BOUNDS:   throw std::out_of_range(what);
+    case VECTOR_ERR_OVERFLOW: throw std::length_error(what);
+    case VECTOR_ERR_ARGS:     throw std::invalid_argument(what);
+    default:                  throw std::runtime_error(what);
+    }
+}
+
+/* Creates a C vector of count zeroed or copied elements */
+inline ::vector* create(std::size_t element_size, std::size_t count,
+                        std::size_t num_values, const void* values)
+{
+    ::vector* v = _vector_create_with_values(element_size, count, num_values, values);
+    if (!v)
+        throw_last_error("vec::vector: create failed");
+    return v;
+}
+
+} /* namespace detail */
+
+template <typename T>
+class vector
+{
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "vec::vector<T> requires a trivially copyable T");
+
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = T&;
+    using const_reference = const T&;
+    using pointer = T*;
+    using const_pointer = const T*;
+    using iterator = T*;
+    using const_iterator = const T*;
+
+    /* Empty vector */
+    vector() : v_(detail::create(sizeof(T), 0, 0, nullptr)) {}
+
+    /* count value-initialized (zeroed) elements */
+    explicit vector(size_type count) : v_(detail::create(sizeof(T), count, 0, nullptr)) {}
+
+    /* count copies of value */
+    vector(size_type count, const T& value)
+        : v_(detail::create(sizeof(T), count, 1, &value)) {}
+
+    /* Copies of the listed values */
+    vector(std::initializer_list<T> values)
+        : v_(detail::create(sizeof(T), values.size(), values.size(), values.begin())) {}
+
+    /* Takes ownership of a C vector whose element size is sizeof(T) */
+    explicit vector(::vector* adopt) : v_(adopt)
+    {
+        if (!v_ || v_->element_size != sizeof(T))
+            throw std::invalid_argument("vec::vector: element size mismatch");
+    }
+
+    vector(const vector& other) : v_(nullptr)
+    {
+        if (other.v_)
+        {
+            v_ = vector_copy(other.v_);
+            if (!v_)
+                detail::throw_last_error("vec::vector: copy failed");
+        }
+    }
+
+    /* Steals the C vector; other is left empty */
+    vector(vector&& other) noexcept : v_(other.v_) { other.v_ = nullptr; }
+
+    ~vector() { vector_free(v_); }
+
+    vector& operator=(const vector& other)
+    {
+        if (this != &other)
+        {
+            vector copy(other);
+            swap(copy);
+        }
+        return *this;
+    }
+
+    /* Steals other's buffer in O(1); other is left empty */
+    vector& operator=(vector&& other) noexcept
+    {
+        if (this == &other)
+            return *this;
+        if (!other.v_)
+            clear();
+        else if (!v_)
+            std::swap(v_, other.v_);
+        else
+            vector_move(v_, other.v_);
+        return *this;
+    }
+
+    /* Element access; no locking, bounds asserted only in debug builds */
+    T& operator[](size_type i) { return *vector_get_unchecked(T, v_, i); }
+    const T& operator[](size_type i) const { return *vector_get_unchecked(T, v_, i); }
+
+    /* Bounds-checked element access */
+    T& at(size_type i)
+    {
+        if (i >= size())
+            throw std::out_of_range("vec::vector::at");
+        return data()[i];
+    }
+    const T& at(size_type i) const
+    {
+        if (i >= size())
+            throw std::out_of_range("vec::vector::at");
+        return data()[i];
+    }
+
+    T& front() { return data()[0]; }
+    const T& front() const { return data()[0]; }
+    T& back() { return data()[size() - 1]; }
+    const T& back() const { return data()[size() - 1]; }
+
+    T* data() noexcept { return v_ ? static_cast<T*>(v_->data) : nullptr; }
+    const T* data() const noexcept { return v_ ? static_cast<const T*>(v_->data) : nullptr; }
+
+    iterator begin() noexcept { return data(); }
+    iterator end() noexcept { return data() + size(); }
+    const_iterator begin() const noexcept { return data(); }
+    const_iterator end() const noexcept { return data() + size(); }
+    const_iterator cbegin() const noexcept { return begin(); }
+    const_iterator cend() const noexcept { return end(); }
+
+#if defined(VECTOR_HPP_HAVE_SPAN)
+    std::span<T> span() noexcept { return std::span<T>(data(), size()); }
+    std::span<const T> span() const noexcept { return std::span<const T>(data(), size()); }
+    operator std::span<T>() noexcept { return span(); }
+    operator std::span<const T>() const noexcept { return span(); }
+#endif
+
+    bool empty() const noexcept { return size() == 0; }
+    size_type size() const noexcept { return vector_length(v_); }
+    size_type capacity() const noexcept { return vector_capacity(v_); }
+
+    void reserve(size_type count)
+    {
+        if (vector_reserve(handle(), count) != 0)
+            detail::throw_last_error("vec::vector::reserve");
+    }
+
+    /* Grows with zeroed elements or truncates */
+    void resize(size_type count)
+    {
+        if (vector_resize(handle(), count) != 0)
+            detail::throw_last_error("vec::vector::resize");
+    }
+
+    void shrink_to_fit()
+    {
+        if (v_ && vector_shrink_to_fit(v_) != 0)
+            detail::throw_last_error("vec::vector::shrink_to_fit");
+    }
+
+    void clear() noexcept
+    {
+        if (v_)
+            vector_clear(v_);
+    }
+
+    void push_back(const T& value) { emplace_back(value); }
+
+    /* Constructs the new element directly in the buffer; the length only */
+    /* grows once the constructor has returned */
+    template <typename... Args>
+    T& emplace_back(Args&&... args)
+    {
+        void* slot = vector_append_begin(handle(), 1);
+        if (!slot)
+            detail::throw_last_error("vec::vector::push_back");
+        T* element;
+        try
+        {
+            element = ::new (slot) T(std::forward<Args>(args)...);
+        }
+        catch (...)
+        {
+            vector_append_abort(v_);
+            throw;
+        }
+        vector_append_commit(v_, 1);
+        return *element;
+    }
+
+    /* Appends [first, last) with one growth and one copy */
+    void append(const T* first, const T* last)
+    {
+        if (vector_append_array(handle(), first, static_cast<size_type>(last - first)) != 0)
+            detail::throw_last_error("vec::vector::append");
+    }
+
+    void pop_back()
+    {
+        if (!empty())
+            resize(size() - 1);
+    }
+
+    /* Inserts a copy of value before pos; returns an iterator to it */
+    iterator insert(const_iterator pos, const T& value)
+    {
+        size_type index = static_cast<size_type>(pos - begin());
+        T copy = value; /* value may live in the buffer being shifted */
+        if (vector_insert_array(handle(), index, &copy, 1) != 0)
+            detail::throw_last_error("vec::vector::insert");
+        return begin() + index;
+    }
+
+    /* Removes [first, last); returns an iterator to the following element */
+    iterator erase(const_iterator first, const_iterator last)
+    {
+        size_type index = static_cast<size_type>(first - begin());
+        if (last != first &&
+            vector_remove(v_, index, static_cast<size_type>(last - first)) != 0)
+            detail::throw_last_error("vec::vector::erase");
+        return begin() + index;
+    }
+    iterator erase(const_iterator pos) { return erase(pos, pos + 1); }
+
+    /* Exchanges the C vectors in O(1) */
+    void swap(vector& other) noexcept { std::swap(v_, other.v_); }
+
+    /* The underlying C vector, created if this vector was moved from */
+    ::vector* handle()
+    {
+        if (!v_)
+            v_ = detail::create(sizeof(T), 0, 0, nullptr);
+        return v_;
+    }
+
+    /* Gives up ownership of the C vector; the caller frees it with vector_free */
+    ::vector* release() noexcept
+    {
+        ::vector* v = v_;
+        v_ = nullptr;
+        return v;
+    }
+
+private:
+    ::vector* v_;
+};
+
+template <typename T>
+inline void swap(vector<T>& a, vector<T>& b) noexcept
+{
+    a.swap(b);
+}
+
+template <typename T>
+inline bool operator==(const vector<T>& a, const vector<T>& b)
+{
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+}
+
+template <typename T>
+inline bool operator!=(const vector<T>& a, const vector<T>& b)
+{
+    return !(a == b);
+}
+
+} /* namespace vec */
+
+#endif /* __VECTOR_HPP__ */
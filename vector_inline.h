@@ -0,0 +1,86 @@
+/*
+ * vector_inline.h - Hot accessors for vector.h
+ * Copyright (C) 2025 Stefan Froberg <stefan.froberg@protonmail.com>
+ *
+ * Overview:
+ * The element accessors behind vector_at, vector_at_ptr, vector_get_unchecked,
+ * vector_data and vector_view_at. They are static inline in every build mode,
+ * so programs linked against libvector still inline them instead of calling
+ * into the library for each element. Included by vector.h; do not include
+ * this file directly.
+ */
+#ifndef __VECTOR_INLINE_H__
+#define __VECTOR_INLINE_H__
+
+#if !defined(__VECTOR_H__)
+#error "Include vector.h instead of vector_inline.h."
+#endif
+
+/* Gets pointer to element at index */
+/* Args: vec - vector pointer, index - element index */
+/* Returns: pointer to element, NULL if invalid */
+static inline void* _vector_at(vector* vec, size_t index)
+{
+    if (!vec || index >= vec->length)
+        return NULL;
+    return (char*)vec->data + index * vec->element_size;
+}
+
+/* Gets pointer to element at index, checking only in debug builds */
+/* Args: vec - vector pointer, index - element index */
+/* Returns: pointer to element */
+static inline void* _vector_at_unchecked(vector* vec, size_t index)
+{
+    assert(vec && index < vec->length);
+    return (char*)vec->data + index * vec->element_size;
+}
+
+/* Returns the data pointer after asserting the vector and element size */
+/* Args: vec - vector pointer, element_size - sizeof the accessing type */
+/* Returns: data pointer */
+static inline void* _vector_data_checked(const vector* vec, size_t element_size)
+{
+    assert(vec && "NULL vector");
+    assert(element_size == vec->element_size && "type does not match element size");
+    (void)element_size;
+    return vec->data;
+}
+
+/* Gets pointer to element at index after asserting the vector, element */
+/* size and bounds; each argument is evaluated once */
+/* Args: vec - vector pointer, index - element index, element_size - sizeof */
+/*       the accessing type */
+/* Returns: pointer to element */
+static inline void* _vector_get_checked(const vector* vec, size_t index,
+                                        size_t element_size)
+{
+    assert(vec && "NULL vector");
+    assert(element_size == vec->element_size && "type does not match element size");
+    assert(index < vec->length && "index out of bounds");
+    return (char*)vec->data + index * element_size;
+}
+
+/* Gets pointer to element of a view */
+/* Args: view - vector_view, index - element index */
+/* Returns: pointer to element, NULL if out of bounds */
+static inline const void* _vector_view_at(vector_view view, size_t index)
+{
+    if (index >= view.length)
+    {
+        _vector_error(VECTOR_ERR_BOUNDS, "Index %zu out of bounds (length: %zu)",
+                      index, view.length);
+        return NULL;
+    }
+    return (const char*)view.data + index * view.element_size;
+}
+
+/* Gets pointer to element of a view, checking only in debug builds */
+/* Args: view - vector_view, index - element index */
+/* Returns: pointer to element */
+static inline const void* _vector_view_at_unchecked(vector_view view, size_t index)
+{
+    assert(index < view.length);
+    return (const char*)view.data + index * view.element_size;
+}
+
+#endif /* __VECTOR_INLINE_H__ */